@@ -517,6 +517,7 @@ static void ffmpeg_cleanup(int ret)
     hw_device_free_all();
 
     av_freep(&filter_nbthreads);
+    av_freep(&filter_complex_thread_type);
 
     av_freep(&input_files);
     av_freep(&output_files);
@@ -738,8 +738,10 @@ extern float max_error_rate;
 
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern char *filter_complex_thread_type;
 extern int vstats_version;
 extern int auto_conversion_filters;
+extern int fuse_filters;
 
 extern const AVIOInterruptCB int_cb;
 
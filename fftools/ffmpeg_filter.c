@@ -241,6 +241,13 @@ void fg_free(FilterGraph **pfg)
         return;
     fgp = fgp_from_fg(fg);
 
+    if (fg->graph && av_log_get_level() >= AV_LOG_VERBOSE) {
+        char *pools = avfilter_graph_dump_frame_pools(fg->graph);
+        if (pools && *pools)
+            av_log(NULL, AV_LOG_VERBOSE, "Frame pools of filtergraph %d:\n%s",
+                   fg->index, pools);
+        av_free(pools);
+    }
     avfilter_graph_free(&fg->graph);
     for (int j = 0; j < fg->nb_inputs; j++) {
         InputFilter *ifilter = fg->inputs[j];
@@ -1252,6 +1259,11 @@ int configure_filtergraph(FilterGraph *fg)
         }
     } else {
         fg->graph->nb_threads = filter_complex_nbthreads;
+        if (filter_complex_thread_type) {
+            ret = av_opt_set(fg->graph, "thread_type", filter_complex_thread_type, 0);
+            if (ret < 0)
+                goto fail;
+        }
     }
 
     hw_device = hw_device_for_filter();
@@ -1299,6 +1311,8 @@ int configure_filtergraph(FilterGraph *fg)
 
     if (!auto_conversion_filters)
         avfilter_graph_set_auto_convert(fg->graph, AVFILTER_AUTO_CONVERT_NONE);
+    if (fuse_filters)
+        av_opt_set_int(fg->graph, "fuse_filters", 1, 0);
     if ((ret = avfilter_graph_config(fg->graph, NULL)) < 0)
         goto fail;
 
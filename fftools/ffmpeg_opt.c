@@ -84,8 +84,10 @@ int stdin_interaction = 1;
 float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
+char *filter_complex_thread_type;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
+int fuse_filters = 0;
 int64_t stats_period = 500000;
 
 
@@ -297,6 +299,15 @@ static int opt_filter_threads(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_filter_complex_thread_type(void *optctx, const char *opt, const char *arg)
+{
+    av_free(filter_complex_thread_type);
+    filter_complex_thread_type = av_strdup(arg);
+    if (!filter_complex_thread_type)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
 static int opt_abort_on(void *optctx, const char *opt, const char *arg)
 {
     static const AVOption opts[] = {
@@ -1520,10 +1531,14 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_complex_thread_type", HAS_ARG | OPT_EXPERT,            { .func_arg = opt_filter_complex_thread_type },
+        "threading types allowed for -filter_complex", "flags" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
         "read complex filtergraph description from a file", "filename" },
+    { "fuse_filters", OPT_BOOL | OPT_EXPERT,                         { &fuse_filters },
+        "merge pad, format and setsar filters into the preceding scale filter" },
     { "auto_conversion_filters", OPT_BOOL | OPT_EXPERT,              { &auto_conversion_filters },
         "enable automatic conversion filters globally" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
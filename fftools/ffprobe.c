@@ -155,6 +155,9 @@ typedef struct ReadInterval {
 static ReadInterval *read_intervals;
 static int read_intervals_nb = 0;
 
+static int64_t *frames_at;  ///< sorted, in AV_TIME_BASE units
+static int frames_at_nb = 0;
+
 static int find_stream_info  = 1;
 
 /* section structure definition */
@@ -2960,13 +2963,97 @@ end:
     return ret;
 }
 
+typedef struct FramesAtContext {
+    WriterContext *w;
+    InputFile *ifile;
+    AVStream *st;
+    int pkt_idx;
+} FramesAtContext;
+
+static int frames_at_packet(void *opaque, AVPacket *pkt)
+{
+    FramesAtContext *c = opaque;
+    FrameData *fd;
+
+    if (do_read_packets) {
+        if (do_show_packets)
+            show_packet(c->w, c->ifile, pkt, c->pkt_idx++);
+        nb_streams_packets[pkt->stream_index]++;
+    }
+
+    pkt->opaque_ref = av_buffer_allocz(sizeof(*fd));
+    if (!pkt->opaque_ref)
+        return AVERROR(ENOMEM);
+    fd = (FrameData*)pkt->opaque_ref->data;
+    fd->pkt_pos  = pkt->pos;
+    fd->pkt_size = pkt->size;
+    return 0;
+}
+
+static int frames_at_frame(void *opaque, AVFrame *frame)
+{
+    FramesAtContext *c = opaque;
+
+    nb_streams_frames[c->st->index]++;
+    if (do_show_frames)
+        show_frame(c->w, frame, c->st, c->ifile->fmt_ctx);
+    return 0;
+}
+
+/**
+ * Read the first frame at or after each of the frames_at timestamps in the
+ * first selected video stream.
+ */
+static int read_frames_at(WriterContext *w, InputFile *ifile)
+{
+    FramesAtContext c = { .w = w, .ifile = ifile };
+    InputStream *ist = NULL;
+    int64_t *ts;
+    int ret, i;
+
+    for (i = 0; i < ifile->nb_streams; i++) {
+        if (selected_streams[i] && ifile->streams[i].dec_ctx &&
+            ifile->streams[i].st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            ist = &ifile->streams[i];
+            break;
+        }
+    }
+    if (!ist) {
+        av_log(NULL, AV_LOG_ERROR, "No decodable video stream selected for frames_at\n");
+        return AVERROR(EINVAL);
+    }
+    c.st = ist->st;
+
+    ts = av_malloc_array(frames_at_nb, sizeof(*ts));
+    if (!ts)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < frames_at_nb; i++)
+        ts[i] = av_rescale_q(frames_at[i], AV_TIME_BASE_Q, ist->st->time_base);
+
+    ret = avformat_read_frames_at(ifile->fmt_ctx, ist->st->index, ist->dec_ctx,
+                                  ts, frames_at_nb,
+                                  frames_at_packet, frames_at_frame, &c);
+    if (ret >= 0 && ret < frames_at_nb)
+        av_log(NULL, AV_LOG_WARNING, "No frame at or after %s\n",
+               av_ts2timestr(ts[ret], &ist->st->time_base));
+
+    av_free(ts);
+    return FFMIN(ret, 0);
+}
+
 static int read_packets(WriterContext *w, InputFile *ifile)
 {
     AVFormatContext *fmt_ctx = ifile->fmt_ctx;
     int i, ret = 0;
     int64_t cur_ts = fmt_ctx->start_time;
 
-    if (read_intervals_nb == 0) {
+    if (frames_at_nb) {
+        if (read_intervals_nb) {
+            av_log(NULL, AV_LOG_ERROR, "frames_at cannot be combined with read_intervals\n");
+            return AVERROR(EINVAL);
+        }
+        ret = read_frames_at(w, ifile);
+    } else if (read_intervals_nb == 0) {
         ReadInterval interval = (ReadInterval) { .has_start = 0, .has_end = 0 };
         ret = read_interval_packets(w, ifile, &interval, &cur_ts);
     } else {
@@ -3948,6 +4035,50 @@ static int opt_read_intervals(void *optctx, const char *opt, const char *arg)
     return parse_read_intervals(arg);
 }
 
+static int compare_int64(const void *a, const void *b)
+{
+    return FFDIFFSIGN(*(const int64_t *)a, *(const int64_t *)b);
+}
+
+static int opt_frames_at(void *optctx, const char *opt, const char *arg)
+{
+    int ret = 0, n;
+    char *p, *spec = av_strdup(arg);
+    if (!spec)
+        return AVERROR(ENOMEM);
+
+    for (n = 1, p = spec; *p; p++)
+        if (*p == ',')
+            n++;
+
+    av_freep(&frames_at);
+    frames_at_nb = 0;
+    frames_at = av_malloc_array(n, sizeof(*frames_at));
+    if (!frames_at) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (p = spec; p;) {
+        char *next = strchr(p, ',');
+        if (next)
+            *next++ = 0;
+
+        ret = av_parse_time(&frames_at[frames_at_nb], p, 1);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Invalid frames_at timestamp '%s'\n", p);
+            goto end;
+        }
+        frames_at_nb++;
+        p = next;
+    }
+    qsort(frames_at, frames_at_nb, sizeof(*frames_at), compare_int64);
+
+end:
+    av_free(spec);
+    return ret;
+}
+
 static int opt_pretty(void *optctx, const char *opt, const char *arg)
 {
     show_value_unit              = 1;
@@ -4052,6 +4183,7 @@ static const OptionDef real_options[] = {
     { "private",           OPT_BOOL, { &show_private_data }, "same as show_private_data" },
     { "bitexact", OPT_BOOL, {&do_bitexact}, "force bitexact output" },
     { "read_intervals", HAS_ARG, {.func_arg = opt_read_intervals}, "set read intervals", "read_intervals" },
+    { "frames_at", HAS_ARG, {.func_arg = opt_frames_at}, "read the frames at the given timestamps", "timestamps" },
     { "i", HAS_ARG, {.func_arg = opt_input_file_i}, "read specified file", "input_file"},
     { "o", HAS_ARG, {.func_arg = opt_output_file_o}, "write to specified output", "output_file"},
     { "print_filename", HAS_ARG, {.func_arg = opt_print_filename}, "override the printed input filename", "print_file"},
@@ -4220,6 +4352,7 @@ int main(int argc, char **argv)
 end:
     av_freep(&print_format);
     av_freep(&read_intervals);
+    av_freep(&frames_at);
     av_hash_freep(&hash);
 
     uninit_opts();
@@ -225,6 +225,10 @@ static int raw_decode(AVCodecContext *avctx, AVFrame *frame,
         return context->frame_size;
 
     need_copy = !avpkt->buf || context->is_1_2_4_8_bpp || context->is_yuv2 || context->is_lt_16bpp;
+    /* b64a is converted in place, which needs a buffer we may write to */
+    if (avctx->codec_tag == AV_RL32("b64a") && avctx->pix_fmt == AV_PIX_FMT_RGBA64BE &&
+        !need_copy && !av_buffer_is_writable(avpkt->buf))
+        need_copy = 1;
 
     frame->pict_type        = AV_PICTURE_TYPE_I;
     frame->flags |= AV_FRAME_FLAG_KEY;
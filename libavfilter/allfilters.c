@@ -360,6 +360,7 @@ extern const AVFilter ff_vf_minterpolate;
 extern const AVFilter ff_vf_mix;
 extern const AVFilter ff_vf_monochrome;
 extern const AVFilter ff_vf_morpho;
+extern const AVFilter ff_vf_mosaic;
 extern const AVFilter ff_vf_mpdecimate;
 extern const AVFilter ff_vf_msad;
 extern const AVFilter ff_vf_multiply;
@@ -426,6 +427,7 @@ extern const AVFilter ff_vf_scale_vaapi;
 extern const AVFilter ff_vf_scale_vulkan;
 extern const AVFilter ff_vf_scale2ref;
 extern const AVFilter ff_vf_scale2ref_npp;
+extern const AVFilter ff_vf_scale_multi;
 extern const AVFilter ff_vf_scdet;
 extern const AVFilter ff_vf_scharr;
 extern const AVFilter ff_vf_scroll;
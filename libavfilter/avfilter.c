@@ -43,6 +43,7 @@
 #include "formats.h"
 #include "framepool.h"
 #include "internal.h"
+#include "thread.h"
 
 static void tlog_ref(void *ctx, AVFrame *ref, int end)
 {
@@ -201,9 +202,81 @@ void avfilter_link_free(AVFilterLink **link)
     av_freep(link);
 }
 
+/**
+ * Lock the state shared with the other filters of the graph if filters are
+ * being activated concurrently.
+ * @return whether graph_unlock() must be called
+ */
+static int graph_lock(AVFilterGraph *graph)
+{
+    if (!graph || !graph->internal->concurrent)
+        return 0;
+    ff_graph_lock(graph);
+    return 1;
+}
+
+static void graph_unlock(AVFilterGraph *graph, int locked)
+{
+    if (locked)
+        ff_graph_unlock(graph);
+}
+
+static int ready_queue_index(unsigned priority)
+{
+    return FFMIN(priority / 100, FF_FILTER_READY_QUEUES - 1);
+}
+
+static void ready_queue_remove(AVFilterContext *filter)
+{
+    AVFilterInternal *fi = filter->internal;
+    AVFilterGraphInternal *gi;
+    int q = fi->ready_queue;
+
+    if (q < 0)
+        return;
+    gi = filter->graph->internal;
+    if (fi->ready_prev)
+        fi->ready_prev->internal->ready_next = fi->ready_next;
+    else
+        gi->ready_head[q] = fi->ready_next;
+    if (fi->ready_next)
+        fi->ready_next->internal->ready_prev = fi->ready_prev;
+    else
+        gi->ready_tail[q] = fi->ready_prev;
+    if (!gi->ready_head[q])
+        gi->ready_mask &= ~(1U << q);
+    fi->ready_prev  = fi->ready_next = NULL;
+    fi->ready_queue = -1;
+}
+
+static void ready_queue_add(AVFilterContext *filter, int q)
+{
+    AVFilterGraphInternal *gi = filter->graph->internal;
+    AVFilterInternal *fi = filter->internal;
+
+    fi->ready_queue = q;
+    fi->ready_prev  = gi->ready_tail[q];
+    fi->ready_next  = NULL;
+    if (gi->ready_tail[q])
+        gi->ready_tail[q]->internal->ready_next = filter;
+    else
+        gi->ready_head[q] = filter;
+    gi->ready_tail[q] = filter;
+    gi->ready_mask |= 1U << q;
+}
+
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
-    filter->ready = FFMAX(filter->ready, priority);
+    int locked = graph_lock(filter->graph);
+    unsigned ready = FFMAX(filter->ready, priority);
+
+    if (filter->graph && ready &&
+        ready_queue_index(ready) != filter->internal->ready_queue) {
+        ready_queue_remove(filter);
+        ready_queue_add(filter, ready_queue_index(ready));
+    }
+    filter->ready = ready;
+    graph_unlock(filter->graph, locked);
 }
 
 /**
@@ -212,10 +285,12 @@ void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
  */
 static void filter_unblock(AVFilterContext *filter)
 {
+    int locked = graph_lock(filter->graph);
     unsigned i;
 
     for (i = 0; i < filter->nb_outputs; i++)
         filter->outputs[i]->frame_blocked_in = 0;
+    graph_unlock(filter->graph, locked);
 }
 
 
@@ -542,8 +617,11 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
     link->current_pts = pts;
     link->current_pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
+    if (link->graph && link->age_index >= 0) {
+        int locked = graph_lock(link->graph);
         ff_avfilter_graph_update_heap(link->graph, link);
+        graph_unlock(link->graph, locked);
+    }
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -602,8 +680,9 @@ static const AVClass *filter_child_class_iterate(void **iter)
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = TFLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -671,6 +750,7 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name)
     if (!ret->internal)
         goto err;
     ret->internal->execute = default_execute;
+    ret->internal->ready_queue = -1;
 
     ret->nb_inputs  = filter->nb_inputs;
     if (ret->nb_inputs ) {
@@ -737,8 +817,10 @@ void avfilter_free(AVFilterContext *filter)
     if (!filter)
         return;
 
-    if (filter->graph)
+    if (filter->graph) {
+        ready_queue_remove(filter);
         ff_filter_graph_remove_filter(filter->graph, filter);
+    }
 
     if (filter->filter->uninit)
         filter->filter->uninit(filter);
@@ -776,6 +858,27 @@ void avfilter_free(AVFilterContext *filter)
     av_free(filter);
 }
 
+void ff_filter_bypass(AVFilterContext *filter)
+{
+    AVFilterLink *in  = filter->inputs[0];
+    AVFilterLink *out = filter->outputs[0];
+    AVFilterContext *src = in->src;
+
+    av_log(filter, AV_LOG_VERBOSE, "removing filter '%s' "
+           "between the filter '%s' and the filter '%s'\n",
+           filter->name, src->name, out->dst->name);
+
+    /* re-hookup the output link to the source of the input link */
+    out->src    = src;
+    out->srcpad = in->srcpad;
+    src->outputs[in->srcpad - src->output_pads] = out;
+    filter->outputs[0] = NULL;
+
+    in->src = NULL;
+    free_link(in);
+    avfilter_free(filter);
+}
+
 int ff_filter_get_nb_threads(AVFilterContext *ctx)
 {
     if (ctx->nb_threads > 0)
@@ -856,7 +959,7 @@ int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
 
 int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
 {
-    int ret = 0;
+    int ret = 0, thread_type;
 
     if (ctx->internal->initialized) {
         av_log(ctx, AV_LOG_ERROR, "Filter already initialized\n");
@@ -869,14 +972,20 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
+    thread_type = 0;
     if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
-        ctx->thread_type       = AVFILTER_THREAD_SLICE;
+        thread_type           |= AVFILTER_THREAD_SLICE;
         ctx->internal->execute = ctx->graph->internal->thread_execute;
-    } else {
-        ctx->thread_type = 0;
     }
+    /* Filters acting on the rest of the graph, and filters using a hardware
+       device which may not be usable from several threads, run alone. */
+    if (!(ctx->filter->flags_internal & FF_FILTER_FLAG_GRAPH_EXCLUSIVE) &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME &&
+        ctx->graph->internal->sched && !ctx->hw_device_ctx)
+        thread_type |= AVFILTER_THREAD_FRAME;
+    ctx->thread_type = thread_type;
 
     if (ctx->filter->init)
         ret = ctx->filter->init(ctx);
@@ -1248,7 +1357,9 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      ff_avfilter_link_set_out_status().
 
    Filters are activated according to the ready field, set using the
-   ff_filter_set_ready(). Eventually, a priority queue will be used.
+   ff_filter_set_ready(), which also keeps the filter in the ready queue of
+   its priority class: the next filter to activate is the one that has been
+   ready the longest among the most urgent.
    ff_filter_set_ready() is called whenever anything could cause progress to
    be possible. Marking a filter ready when it is not is not a problem,
    except for the small overhead it causes.
@@ -1312,12 +1423,15 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
 int ff_filter_activate(AVFilterContext *filter)
 {
-    int ret;
+    int ret, locked;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
+    locked = graph_lock(filter->graph);
     filter->ready = 0;
+    ready_queue_remove(filter);
+    graph_unlock(filter->graph, locked);
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
     if (ret == FFERROR_NOT_READY)
@@ -1504,10 +1618,14 @@ void ff_inlink_request_frame(AVFilterLink *link)
 
 void ff_inlink_set_status(AVFilterLink *link, int status)
 {
+    int locked;
+
     if (link->status_out)
         return;
     link->frame_wanted_out = 0;
+    locked = graph_lock(link->graph);
     link->frame_blocked_in = 0;
+    graph_unlock(link->graph, locked);
     ff_avfilter_link_set_out_status(link, status, AV_NOPTS_VALUE);
     while (ff_framequeue_queued_frames(&link->fifo)) {
            AVFrame *frame = ff_framequeue_take(&link->fifo);
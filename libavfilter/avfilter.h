@@ -390,6 +390,12 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Activate filters of the graph that are not linked to each other
+ * concurrently. Only available with the built-in thread implementation,
+ * i.e. if AVFilterGraph.execute is not set.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -873,7 +879,9 @@ typedef struct AVFilterGraph {
      * of AVFILTER_THREAD_* flags.
      *
      * May be set by the caller at any point, the setting will apply to all
-     * filters initialized after that. The default is allowing everything.
+     * filters initialized after that. The default is AVFILTER_THREAD_SLICE;
+     * AVFILTER_THREAD_FRAME must be set before adding any filters to the
+     * filtergraph.
      *
      * When a filter in this graph is initialized, this field is combined using
      * bit AND with AVFilterContext.thread_type to get the final mask used for
@@ -917,6 +925,17 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If set, when the graph is configured, the filters that directly follow
+     * a scale filter and only forward, pad or set the aspect ratio of its
+     * output (format, null, pad, setsar, setdar) are merged into it and
+     * removed from the graph, so that the scaled frames are written directly
+     * into their padded output.
+     *
+     * Access ONLY through AVOptions ("fuse_filters").
+     */
+    int fuse_filters;
+
     /**
      * Private fields
      *
@@ -1473,6 +1492,17 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  */
 char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
 
+/**
+ * Dump the usage statistics of the video frame pools shared by the links of
+ * a graph, one line per frame size and format: the number of links using the
+ * pool, the number of frames requested from it and the number of frames it
+ * allocated, i.e. the peak number of frames in use at the same time.
+ *
+ * @return  a string, or NULL in case of memory allocation failure;
+ *          the string must be freed using av_free
+ */
+char *avfilter_graph_dump_frame_pools(AVFilterGraph *graph);
+
 /**
  * Request a frame on the oldest sink link.
  *
@@ -21,6 +21,7 @@
  */
 
 #include "config.h"
+#include "config_components.h"
 
 #include <string.h>
 
@@ -37,6 +38,7 @@
 #include "avfilter.h"
 #include "buffersink.h"
 #include "formats.h"
+#include "fuse.h"
 #include "internal.h"
 #include "thread.h"
 
@@ -48,6 +50,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -55,6 +58,8 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "fuse_filters", "merge filters that can run as one", OFFSET(fuse_filters), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, F|V },
     { NULL },
 };
 
@@ -77,6 +82,20 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+void ff_graph_lock(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_unlock(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_activate_filters(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters)
+{
+    return AVERROR(ENOSYS);
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -128,6 +147,10 @@ void avfilter_graph_free(AVFilterGraph **graph)
 
     av_freep(&(*graph)->sink_links);
 
+    for (int i = 0; i < (*graph)->internal->nb_frame_pools; i++)
+        ff_frame_pool_uninit(&(*graph)->internal->frame_pools[i]);
+    av_freep(&(*graph)->internal->frame_pools);
+
     av_opt_free(*graph);
 
     av_freep(&(*graph)->filters);
@@ -135,6 +158,60 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(graph);
 }
 
+static FFFramePool *find_video_frame_pool(AVFilterGraph *graph, int w, int h,
+                                          enum AVPixelFormat format, int align)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    FFFramePool *pool;
+    FFFramePoolStats stats;
+    int pool_w, pool_h, pool_align, i, j;
+    enum AVPixelFormat pool_format;
+
+    for (i = 0; i < gi->nb_frame_pools; i++) {
+        if (ff_frame_pool_get_video_config(gi->frame_pools[i], &pool_w, &pool_h,
+                                           &pool_format, &pool_align) >= 0 &&
+            pool_w == w && pool_h == h &&
+            pool_format == format && pool_align == align)
+            return ff_frame_pool_ref(gi->frame_pools[i]);
+    }
+
+    /* drop the pools no link uses anymore, e.g. after a resolution change */
+    for (i = j = 0; i < gi->nb_frame_pools; i++) {
+        ff_frame_pool_get_stats(gi->frame_pools[i], &stats);
+        if (stats.nb_refs == 1)
+            ff_frame_pool_uninit(&gi->frame_pools[i]);
+        else
+            gi->frame_pools[j++] = gi->frame_pools[i];
+    }
+    gi->nb_frame_pools = j;
+
+    pool = ff_frame_pool_video_init(av_buffer_allocz, w, h, format, align);
+    if (!pool)
+        return NULL;
+
+    if (av_dynarray_add_nofree(&gi->frame_pools, &gi->nb_frame_pools, pool) < 0) {
+        ff_frame_pool_uninit(&pool);
+        return NULL;
+    }
+
+    return ff_frame_pool_ref(pool);
+}
+
+FFFramePool *ff_graph_get_video_frame_pool(AVFilterGraph *graph, int w, int h,
+                                           enum AVPixelFormat format, int align)
+{
+    int locked = graph->internal->concurrent;
+    FFFramePool *pool;
+
+    if (locked)
+        ff_graph_lock(graph);
+    pool = find_video_frame_pool(graph, w, h, format, align);
+    if (locked)
+        ff_graph_unlock(graph);
+
+    return pool;
+}
+
 int avfilter_graph_create_filter(AVFilterContext **filt_ctx, const AVFilter *filt,
                                  const char *name, const char *args, void *opaque,
                                  AVFilterGraph *graph_ctx)
@@ -280,6 +357,42 @@ static int graph_check_links(AVFilterGraph *graph, void *log_ctx)
     return 0;
 }
 
+/**
+ * Merge into each scale filter the filters following it that it can do the
+ * work of: pass-through filters (format, null), setsar/setdar and pad. The
+ * scale filter then writes directly into the padded frame, and the merged
+ * filters are removed from the graph.
+ */
+static int graph_fuse_filters(AVFilterGraph *graph, void *log_ctx)
+{
+    unsigned i;
+
+    if (!CONFIG_SCALE_FILTER || !graph->fuse_filters)
+        return 0;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        int fused = 0;
+
+        if (strcmp(f->filter->name, "scale"))
+            continue;
+        for (;;) {
+            AVFilterContext *next = f->outputs[0]->dst;
+
+            if (next->nb_inputs != 1 || next->nb_outputs != 1 ||
+                next->command_queue || !ff_scale_fuse(f, next))
+                break;
+            ff_filter_bypass(next);
+            fused = 1;
+        }
+        /* removing filters reorders the array, start over */
+        if (fused)
+            i = -1;
+    }
+
+    return 0;
+}
+
 AVFilterContext *avfilter_graph_get_filter(AVFilterGraph *graph, const char *name)
 {
     int i;
@@ -1176,6 +1289,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_check_links(graphctx, log_ctx)))
         return ret;
+    if ((ret = graph_fuse_filters(graphctx, log_ctx)))
+        return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
@@ -1337,17 +1452,69 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static int filters_linked(const AVFilterContext *a, const AVFilterContext *b)
+{
+    unsigned i;
+
+    for (i = 0; i < a->nb_inputs; i++)
+        if (a->inputs[i] && a->inputs[i]->src == b)
+            return 1;
+    for (i = 0; i < a->nb_outputs; i++)
+        if (a->outputs[i] && a->outputs[i]->dst == b)
+            return 1;
+    return 0;
+}
+
+static int can_join_wave(AVFilterContext **wave, int nb_wave,
+                         const AVFilterContext *filter)
+{
+    int i;
+
+    if (!(filter->thread_type & AVFILTER_THREAD_FRAME))
+        return 0;
+    for (i = 0; i < nb_wave; i++)
+        if (wave[i] == filter || filters_linked(wave[i], filter))
+            return 0;
+    return 1;
+}
+
+/**
+ * Activate the given filter together with other ready filters not linked to
+ * any filter of the wave, most urgent first. Filters are never activated
+ * twice concurrently and never concurrently with one of their neighbours, so
+ * that the state of a link is only touched by one thread at a time.
+ */
+static int run_wave(AVFilterGraph *graph, AVFilterContext *first)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVFilterContext **wave = gi->wave;
+    int nb_wave = 1, q;
+
+    wave[0] = first;
+    for (q = FF_FILTER_READY_QUEUES - 1; q >= 0 && nb_wave < gi->max_wave; q--) {
+        AVFilterContext *filter = gi->ready_head[q];
+
+        for (; filter && nb_wave < gi->max_wave; filter = filter->internal->ready_next)
+            if (can_join_wave(wave, nb_wave, filter))
+                wave[nb_wave++] = filter;
+    }
+
+    if (nb_wave == 1)
+        return ff_filter_activate(first);
+    return ff_graph_activate_filters(graph, wave, nb_wave);
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
+    AVFilterGraphInternal *gi = graph->internal;
     AVFilterContext *filter;
-    unsigned i;
 
     av_assert0(graph->nb_filters);
-    filter = graph->filters[0];
-    for (i = 1; i < graph->nb_filters; i++)
-        if (graph->filters[i]->ready > filter->ready)
-            filter = graph->filters[i];
-    if (!filter->ready)
+    if (!gi->ready_mask)
         return AVERROR(EAGAIN);
+    filter = gi->ready_head[av_log2(gi->ready_mask)];
+    av_assert1(filter->ready);
+    if (graph->internal->sched && filter->thread_type & AVFILTER_THREAD_FRAME)
+        return run_wave(graph, filter);
     return ff_filter_activate(filter);
 }
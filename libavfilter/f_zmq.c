@@ -230,6 +230,7 @@ const AVFilter ff_vf_zmq = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(ZMQContext),
+    .flags_internal = FF_FILTER_FLAG_GRAPH_EXCLUSIVE,
     FILTER_INPUTS(zmq_inputs),
     FILTER_OUTPUTS(zmq_outputs),
     .priv_class  = &zmq_class,
@@ -261,6 +262,7 @@ const AVFilter ff_af_azmq = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(ZMQContext),
+    .flags_internal = FF_FILTER_FLAG_GRAPH_EXCLUSIVE,
     FILTER_INPUTS(azmq_inputs),
     FILTER_OUTPUTS(azmq_outputs),
 };
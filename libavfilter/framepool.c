@@ -18,6 +18,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "framepool.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
@@ -45,9 +47,39 @@ struct FFFramePool {
     int align;
     int linesize[4];
     AVBufferPool *pools[4];
+    int nb_planes;              ///< number of buffers of a frame
+    size_t size;                ///< size of all the buffers of a frame
 
+    AVBufferRef* (*alloc)(size_t size);
+    atomic_uint refcount;
+    atomic_uint nb_requests;    ///< frames returned by ff_frame_pool_get()
+    atomic_uint nb_buffers;     ///< buffers allocated by the pools
 };
 
+static AVBufferRef *pool_alloc(void *opaque, size_t size)
+{
+    FFFramePool *pool = opaque;
+    AVBufferRef *buf = pool->alloc(size);
+
+    if (buf)
+        atomic_fetch_add_explicit(&pool->nb_buffers, 1, memory_order_relaxed);
+    return buf;
+}
+
+static FFFramePool *pool_alloc_context(AVBufferRef* (*alloc)(size_t size))
+{
+    FFFramePool *pool = av_mallocz(sizeof(FFFramePool));
+
+    if (!pool)
+        return NULL;
+
+    pool->alloc = alloc ? alloc : av_buffer_alloc;
+    atomic_init(&pool->refcount,    1);
+    atomic_init(&pool->nb_requests, 0);
+    atomic_init(&pool->nb_buffers,  0);
+    return pool;
+}
+
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
                                       int width,
                                       int height,
@@ -59,7 +91,7 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
     ptrdiff_t linesizes[4];
     size_t sizes[4];
 
-    pool = av_mallocz(sizeof(FFFramePool));
+    pool = pool_alloc_context(alloc);
     if (!pool)
         return NULL;
 
@@ -99,10 +131,13 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
     for (i = 0; i < 4 && sizes[i]; i++) {
         if (sizes[i] > SIZE_MAX - align)
             goto fail;
-        pool->pools[i] = av_buffer_pool_init(sizes[i] + align, alloc);
+        pool->pools[i] = av_buffer_pool_init2(sizes[i] + align, pool,
+                                              pool_alloc, NULL);
         if (!pool->pools[i])
             goto fail;
+        pool->size += sizes[i] + align;
     }
+    pool->nb_planes = i;
 
     return pool;
 
@@ -120,7 +155,7 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(size_t size),
     int ret, planar;
     FFFramePool *pool;
 
-    pool = av_mallocz(sizeof(FFFramePool));
+    pool = pool_alloc_context(NULL);
     if (!pool)
         return NULL;
 
@@ -138,9 +173,12 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(size_t size),
     if (ret < 0)
         goto fail;
 
-    pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
+    pool->pools[0] = av_buffer_pool_init2(pool->linesize[0], pool,
+                                          pool_alloc, NULL);
     if (!pool->pools[0])
         goto fail;
+    pool->nb_planes = pool->planes;
+    pool->size      = (size_t)pool->linesize[0] * pool->planes;
 
     return pool;
 
@@ -187,6 +225,21 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
     return 0;
 }
 
+void ff_frame_pool_get_stats(FFFramePool *pool, FFFramePoolStats *stats)
+{
+    stats->nb_refs     = atomic_load_explicit(&pool->refcount, memory_order_relaxed);
+    stats->nb_requests = atomic_load_explicit(&pool->nb_requests, memory_order_relaxed);
+    stats->nb_frames   = atomic_load_explicit(&pool->nb_buffers, memory_order_relaxed) /
+                         FFMAX(pool->nb_planes, 1);
+    stats->frame_size  = pool->size;
+}
+
+FFFramePool *ff_frame_pool_ref(FFFramePool *pool)
+{
+    atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    return pool;
+}
+
 AVFrame *ff_frame_pool_get(FFFramePool *pool)
 {
     int i;
@@ -274,6 +327,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
         av_assert0(0);
     }
 
+    atomic_fetch_add_explicit(&pool->nb_requests, 1, memory_order_relaxed);
     return frame;
 fail:
     av_frame_free(&frame);
@@ -287,6 +341,12 @@ void ff_frame_pool_uninit(FFFramePool **pool)
     if (!pool || !*pool)
         return;
 
+    if (atomic_fetch_sub_explicit(&(*pool)->refcount, 1,
+                                  memory_order_acq_rel) > 1) {
+        *pool = NULL;
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         av_buffer_pool_uninit(&(*pool)->pools[i]);
     }
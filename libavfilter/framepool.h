@@ -32,6 +32,21 @@
  */
 typedef struct FFFramePool FFFramePool;
 
+/**
+ * Usage statistics of a frame pool.
+ */
+typedef struct FFFramePoolStats {
+    unsigned nb_refs;           ///< number of references to the pool
+    unsigned nb_requests;       ///< number of frames requested from the pool
+    /**
+     * Number of frames allocated by the pool. As buffers are only released
+     * when the pool is freed, this is also the peak number of frames in use
+     * at the same time.
+     */
+    unsigned nb_frames;
+    size_t   frame_size;        ///< size in bytes of the buffers of a frame
+} FFFramePoolStats;
+
 /**
  * Allocate and initialize a video frame pool.
  *
@@ -69,8 +84,17 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(size_t size),
                                       int align);
 
 /**
- * Deallocate the frame pool. It is safe to call this function while
- * some of the allocated frame are still in use.
+ * Create a new reference to a frame pool, which can then be shared, e.g.
+ * between several links.
+ *
+ * @return pool
+ */
+FFFramePool *ff_frame_pool_ref(FFFramePool *pool);
+
+/**
+ * Release a reference to the frame pool, and deallocate the pool if it was
+ * the last one. It is safe to call this function while some of the
+ * allocated frame are still in use.
  *
  * @param pool pointer to the frame pool to be freed. It will be set to NULL.
  */
@@ -107,6 +131,12 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
                                    int *align);
 
 
+/**
+ * Get the usage statistics of the pool. The values are only consistent with
+ * each other if no other thread uses the pool.
+ */
+void ff_frame_pool_get_stats(FFFramePool *pool, FFFramePoolStats *stats);
+
 /**
  * Allocate a new AVFrame, reussing old buffers from the pool when available.
  * This function may be called simultaneously from multiple threads.
@@ -18,8 +18,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <inttypes.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "framesync.h"
@@ -49,6 +52,17 @@ static const AVOption framesync_options[] = {
             0, AV_OPT_TYPE_CONST, { .i64 = TS_DEFAULT }, .flags = FLAGS, "ts_sync_mode" },
         { "nearest", "Frame from secondary input with the absolute nearest timestamp to the primary input frame",
             0, AV_OPT_TYPE_CONST, { .i64 = TS_NEAREST }, .flags = FLAGS, "ts_sync_mode" },
+    { "lookahead", "wait for the next frame of the secondary inputs before processing a frame",
+        OFFSET(opt_lookahead), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, FLAGS },
+    { "max_queue", "without lookahead, maximum number of frames queued on a secondary input",
+        OFFSET(opt_max_queue), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, INT_MAX, FLAGS },
+    { "timeout", "without lookahead, how long to wait for a late secondary input",
+        OFFSET(opt_timeout), AV_OPT_TYPE_DURATION, { .i64 = 0 }, 0, INT64_MAX, FLAGS },
+    { "late_action", "without lookahead, action to take when a secondary input is late",
+        OFFSET(opt_late_action), AV_OPT_TYPE_INT, { .i64 = LATE_ACTION_REPEAT },
+        LATE_ACTION_REPEAT, LATE_ACTION_SKIP, .flags = FLAGS, "late_action" },
+        { "repeat", "Use the previous frame of the input.", 0, AV_OPT_TYPE_CONST, { .i64 = LATE_ACTION_REPEAT }, .flags = FLAGS, "late_action" },
+        { "skip",   "Process the frame without the input.", 0, AV_OPT_TYPE_CONST, { .i64 = LATE_ACTION_SKIP },   .flags = FLAGS, "late_action" },
     { NULL }
 };
 static const AVClass framesync_class = {
@@ -75,6 +89,20 @@ enum {
 
 static int consume_from_fifos(FFFrameSync *fs);
 
+/**
+ * Without lookahead, the first input with the highest sync level generates
+ * all the events.
+ */
+static unsigned framesync_primary(FFFrameSync *fs)
+{
+    unsigned i;
+
+    for (i = 0; i < fs->nb_in; i++)
+        if (fs->in[i].sync == fs->sync_level)
+            return i;
+    return 0;
+}
+
 void ff_framesync_preinit(FFFrameSync *fs)
 {
     if (fs->class)
@@ -173,8 +201,10 @@ int ff_framesync_configure(FFFrameSync *fs)
                fs->time_base.num, fs->time_base.den);
     }
 
-    for (i = 0; i < fs->nb_in; i++)
+    for (i = 0; i < fs->nb_in; i++) {
         fs->in[i].pts = fs->in[i].pts_next = AV_NOPTS_VALUE;
+        fs->in[i].pts_end = fs->in[i].wait_start = AV_NOPTS_VALUE;
+    }
     fs->sync_level = UINT_MAX;
     framesync_sync_level_update(fs);
 
@@ -272,19 +302,24 @@ int ff_framesync_get_frame(FFFrameSync *fs, unsigned in, AVFrame **rframe,
     int64_t pts_next;
     int ret;
 
-    if (!fs->in[in].frame) {
+    if (!fs->in[in].frame || fs->in[in].skip) {
         *rframe = NULL;
         return 0;
     }
     frame = fs->in[in].frame;
     if (get) {
-        /* Find out if we need to copy the frame: is there another sync
-           stream, and do we know if its current frame will outlast this one? */
-        pts_next = fs->in[in].have_next ? fs->in[in].pts_next : INT64_MAX;
-        for (i = 0; i < fs->nb_in && !need_copy; i++)
-            if (i != in && fs->in[i].sync &&
-                (!fs->in[i].have_next || fs->in[i].pts_next < pts_next))
-                need_copy = 1;
+        if (!fs->opt_lookahead) {
+            /* only the frames of the primary input are used once */
+            need_copy = in != framesync_primary(fs);
+        } else {
+            /* Find out if we need to copy the frame: is there another sync
+               stream, and do we know if its current frame will outlast this one? */
+            pts_next = fs->in[in].have_next ? fs->in[in].pts_next : INT64_MAX;
+            for (i = 0; i < fs->nb_in && !need_copy; i++)
+                if (i != in && fs->in[i].sync &&
+                    (!fs->in[i].have_next || fs->in[i].pts_next < pts_next))
+                    need_copy = 1;
+        }
         if (need_copy) {
             if (!(frame = av_frame_clone(frame)))
                 return AVERROR(ENOMEM);
@@ -305,6 +340,13 @@ void ff_framesync_uninit(FFFrameSync *fs)
 {
     unsigned i;
 
+    if (fs->in && !fs->opt_lookahead) {
+        av_log(fs, AV_LOG_VERBOSE, "%"PRId64" stalls\n", fs->nb_stalls);
+        for (i = 0; i < fs->nb_in; i++)
+            av_log(fs, AV_LOG_VERBOSE, "input %u: %"PRId64" frames dropped, "
+                   "late %"PRId64" times\n", i, fs->in[i].nb_dropped, fs->in[i].nb_late);
+    }
+
     for (i = 0; i < fs->nb_in; i++) {
         av_frame_free(&fs->in[i].frame);
         av_frame_free(&fs->in[i].frame_next);
@@ -352,10 +394,228 @@ static int consume_from_fifos(FFFrameSync *fs)
     return 1;
 }
 
+/**
+ * Compute the end timestamp of a frame of an input, in the framesync time
+ * base, from the duration of the frame or else the frame rate of the input.
+ */
+static int64_t framesync_frame_end(FFFrameSync *fs, unsigned in,
+                                   const AVFrame *frame)
+{
+    AVFilterLink *inlink = fs->parent->inputs[in];
+    int64_t duration = frame->duration;
+
+    if (frame->pts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    if (duration <= 0 && inlink->frame_rate.num > 0 && inlink->frame_rate.den > 0)
+        duration = av_rescale_q(1, av_inv_q(inlink->frame_rate), fs->in[in].time_base);
+    if (duration <= 0)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(frame->pts + duration, fs->in[in].time_base, fs->time_base);
+}
+
+/**
+ * Without lookahead, take the frames of a secondary input up to the
+ * timestamp of the pending frame of the primary input.
+ *
+ * @param have_main  whether the primary input has a pending frame
+ * @param pts        timestamp of that frame, in the framesync time base
+ * @return 1 if the current frame of the input is the right one for the
+ *         pending frame, 0 if the input is late, a negative error code on
+ *         failure
+ */
+static int framesync_update_secondary(FFFrameSync *fs, unsigned in,
+                                      int have_main, int64_t pts)
+{
+    AVFilterLink *inlink = fs->parent->inputs[in];
+    FFFrameSyncIn *fsin = &fs->in[in];
+    AVFrame *frame;
+    int64_t status_pts;
+    int status, ret;
+
+    while (ff_inlink_queued_frames(inlink)) {
+        frame = ff_inlink_peek_frame(inlink, 0);
+        /* keep the frames following the pending one, within the bound */
+        if (ff_inlink_queued_frames(inlink) <= fs->opt_max_queue &&
+            (!have_main ||
+             (pts != AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE &&
+              av_compare_ts(frame->pts, fsin->time_base, pts, fs->time_base) > 0)))
+            return 1;
+
+        ret = ff_inlink_consume_frame(inlink, &frame);
+        if (ret < 0)
+            return ret;
+        if (fsin->frame && !fsin->used)
+            fsin->nb_dropped++;
+        av_frame_free(&fsin->frame);
+        fsin->pts_end = framesync_frame_end(fs, in, frame);
+        if (frame->pts != AV_NOPTS_VALUE)
+            frame->pts = av_rescale_q(frame->pts, fsin->time_base, fs->time_base);
+        fsin->frame = frame;
+        fsin->pts   = frame->pts;
+        fsin->used  = 0;
+        fsin->state = STATE_RUN;
+    }
+
+    if (fsin->state != STATE_EOF &&
+        ff_inlink_acknowledge_status(inlink, &status, &status_pts)) {
+        fsin->state = STATE_EOF;
+        if (fsin->after == EXT_STOP)
+            framesync_eof(fs);
+        else if (fsin->after == EXT_NULL)
+            av_frame_free(&fsin->frame);
+    }
+
+    /* the current frame is late if it ended before the pending frame */
+    return fsin->state == STATE_EOF ||
+           (fsin->frame && (pts == AV_NOPTS_VALUE || fsin->pts == AV_NOPTS_VALUE ||
+                            fsin->pts >= pts ||
+                            (fsin->pts_end != AV_NOPTS_VALUE && fsin->pts_end > pts)));
+}
+
+/**
+ * Generate an event for each frame of the primary input, with the frames
+ * of the other inputs received so far, instead of waiting for the frames
+ * following them.
+ */
+static int framesync_activate_no_lookahead(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    unsigned primary = framesync_primary(fs), i;
+    AVFilterLink *mainlink = ctx->inputs[primary];
+    FFFrameSyncIn *main = &fs->in[primary];
+    int have_main = 0, missing = 0, wait = 0, delay = 0;
+    int64_t pts = AV_NOPTS_VALUE, status_pts;
+    AVFrame *frame;
+    int status, ret;
+
+    if (fs->eof)
+        return 0;
+
+    if (ff_inlink_queued_frames(mainlink)) {
+        frame = ff_inlink_peek_frame(mainlink, 0);
+        if (frame->pts != AV_NOPTS_VALUE)
+            pts = av_rescale_q(frame->pts, main->time_base, fs->time_base);
+        have_main = 1;
+    }
+
+    for (i = 0; i < fs->nb_in; i++) {
+        FFFrameSyncIn *in = &fs->in[i];
+
+        if (i == primary)
+            continue;
+        ret = framesync_update_secondary(fs, i, have_main, pts);
+        if (ret < 0)
+            return ret;
+        if (fs->eof)
+            return 0;
+        in->skip = !ret;
+        if (!ret)
+            ff_inlink_request_frame(ctx->inputs[i]);
+        /* the filter cannot do without a frame on this input */
+        if (!in->frame && in->before == EXT_STOP) {
+            if (ret)
+                missing = 1;
+            else
+                wait = 1;
+        }
+    }
+
+    if (!have_main) {
+        if (ff_inlink_acknowledge_status(mainlink, &status, &status_pts))
+            framesync_eof(fs);
+        else if (ff_outlink_frame_wanted(ctx->outputs[0]))
+            ff_inlink_request_frame(mainlink);
+        return 0;
+    }
+
+    if (missing || (wait && ff_inlink_queued_frames(mainlink) > fs->opt_max_queue)) {
+        /* the frame cannot be processed */
+        ret = ff_inlink_consume_frame(mainlink, &frame);
+        if (ret < 0)
+            return ret;
+        av_frame_free(&frame);
+        main->nb_dropped++;
+        if (ff_inlink_queued_frames(mainlink))
+            ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+    if (wait)
+        return 0;
+
+    if (fs->opt_timeout > 0) {
+        int64_t now = av_gettime_relative();
+
+        for (i = 0; i < fs->nb_in; i++) {
+            FFFrameSyncIn *in = &fs->in[i];
+
+            if (i == primary)
+                continue;
+            if (!in->skip) {
+                in->wait_start = AV_NOPTS_VALUE;
+                in->timed_out  = 0;
+                continue;
+            }
+            if (in->timed_out)
+                continue;
+            if (in->wait_start == AV_NOPTS_VALUE) {
+                in->wait_start = now;
+                fs->nb_stalls++;
+            }
+            if (now - in->wait_start < fs->opt_timeout)
+                delay = 1;
+            else
+                in->timed_out = 1;
+        }
+        /* The deadline is checked again when the next frame arrives:
+         * waking up by itself would keep the caller from feeding the late
+         * input. */
+        if (delay)
+            return 0;
+    }
+
+    for (i = 0; i < fs->nb_in; i++) {
+        FFFrameSyncIn *in = &fs->in[i];
+
+        if (!in->skip)
+            continue;
+        in->nb_late++;
+        in->skip = fs->opt_late_action == LATE_ACTION_SKIP && in->before != EXT_STOP;
+    }
+
+    ret = ff_inlink_consume_frame(mainlink, &frame);
+    if (ret < 0)
+        return ret;
+    av_frame_free(&main->frame);
+    frame->pts  = pts;
+    main->frame = frame;
+    main->pts   = pts;
+    main->state = STATE_RUN;
+    fs->pts = pts;
+    fs->frame_ready = 1;
+
+    ret = fs->on_event(fs);
+    if (ret < 0)
+        return ret;
+    fs->frame_ready = 0;
+
+    for (i = 0; i < fs->nb_in; i++) {
+        if (fs->in[i].frame && !fs->in[i].skip)
+            fs->in[i].used = 1;
+        fs->in[i].skip = 0;
+    }
+    if (ff_inlink_queued_frames(mainlink))
+        ff_filter_set_ready(ctx, 100);
+
+    return 0;
+}
+
 int ff_framesync_activate(FFFrameSync *fs)
 {
     int ret;
 
+    if (!fs->opt_lookahead)
+        return framesync_activate_no_lookahead(fs);
+
     ret = framesync_advance(fs);
     if (ret < 0)
         return ret;
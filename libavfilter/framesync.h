@@ -29,6 +29,11 @@ enum EOFAction {
     EOF_ACTION_PASS
 };
 
+enum LateAction {
+    LATE_ACTION_REPEAT,
+    LATE_ACTION_SKIP
+};
+
 /*
  * TODO
  * Export convenient options.
@@ -160,6 +165,44 @@ typedef struct FFFrameSyncIn {
     unsigned sync;
 
     enum FFFrameTSSyncMode ts_mode;
+
+    /**
+     * Without lookahead: the frame is not used for the current event
+     */
+    uint8_t skip;
+
+    /**
+     * Without lookahead: the frame was used for an event
+     */
+    uint8_t used;
+
+    /**
+     * Without lookahead: the input was waited for longer than the timeout,
+     * it is not waited for again until it catches up with the primary input
+     */
+    uint8_t timed_out;
+
+    /**
+     * Without lookahead: end timestamp of the current frame, from its
+     * duration or the frame rate of the input, AV_NOPTS_VALUE if unknown
+     */
+    int64_t pts_end;
+
+    /**
+     * Without lookahead: wall-clock time at which the filter started waiting
+     * for the input, AV_NOPTS_VALUE if it is not waiting
+     */
+    int64_t wait_start;
+
+    /**
+     * Without lookahead: number of frames replaced before being used
+     */
+    int64_t nb_dropped;
+
+    /**
+     * Without lookahead: number of events for which the input was late
+     */
+    int64_t nb_late;
 } FFFrameSyncIn;
 
 /**
@@ -228,6 +271,15 @@ typedef struct FFFrameSync {
     int opt_shortest;
     int opt_eof_action;
     int opt_ts_sync_mode;
+    int opt_lookahead;
+    int opt_max_queue;
+    int64_t opt_timeout;
+    int opt_late_action;
+
+    /**
+     * Without lookahead: number of times the filter waited for a late input
+     */
+    int64_t nb_stalls;
 
 } FFFrameSync;
 
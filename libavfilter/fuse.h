@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Filter fusion: merging, when a graph is configured with the fuse_filters
+ * option, the filters that follow a filter into it.
+ */
+
+#ifndef AVFILTER_FUSE_H
+#define AVFILTER_FUSE_H
+
+#include "avfilter.h"
+#include "drawutils.h"
+
+/**
+ * Make a configured scale filter do the work of the filter following it.
+ *
+ * @param ctx  scale filter
+ * @param next filter connected to the only output of ctx; it must have a
+ *             single input and a single output and be configured
+ * @return 1 if the scale filter will now produce the frames next would
+ *         output, so that next can be removed from the graph, 0 otherwise
+ */
+int ff_scale_fuse(AVFilterContext *ctx, AVFilterContext *next);
+
+/**
+ * Get the position of the input picture and the color of the borders of a
+ * configured pad filter.
+ *
+ * @return 0 on success, a negative AVERROR code if the padding is not fixed
+ *         (i.e. the expressions are evaluated for each frame)
+ */
+int ff_pad_get_area(AVFilterContext *ctx, int *x, int *y,
+                    FFDrawContext *draw, FFDrawColor *color);
+
+#endif /* AVFILTER_FUSE_H */
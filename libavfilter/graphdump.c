@@ -168,3 +168,30 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
     avfilter_graph_dump_to_buf(&buf, graph);
     return dump;
 }
+
+char *avfilter_graph_dump_frame_pools(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVBPrint buf;
+    char *dump;
+
+    av_bprint_init(&buf, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (int i = 0; i < gi->nb_frame_pools; i++) {
+        FFFramePoolStats stats;
+        enum AVPixelFormat format;
+        int w, h, align;
+
+        if (ff_frame_pool_get_video_config(gi->frame_pools[i], &w, &h,
+                                           &format, &align) < 0)
+            continue;
+        ff_frame_pool_get_stats(gi->frame_pools[i], &stats);
+        av_bprintf(&buf, "%s %dx%d align %d: %u links, %u frames requested, "
+                   "%u allocated (%zu bytes)\n",
+                   av_get_pix_fmt_name(format), w, h, align, stats.nb_refs - 1,
+                   stats.nb_requests, stats.nb_frames,
+                   stats.nb_frames * stats.frame_size);
+    }
+    if (av_bprint_finalize(&buf, &dump) < 0)
+        return NULL;
+    return dump;
+}
@@ -27,6 +27,7 @@
 #include "libavutil/internal.h"
 #include "avfilter.h"
 #include "formats.h"
+#include "framepool.h"
 #include "framequeue.h"
 #include "video.h"
 
@@ -129,15 +130,58 @@ struct AVFilterPad {
     int (*config_props)(AVFilterLink *link);
 };
 
+/**
+ * Number of ready queues of a graph. The priorities given to
+ * ff_filter_set_ready() are grouped by hundreds, the last queue taking
+ * everything from 300 up.
+ */
+#define FF_FILTER_READY_QUEUES 4
+
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Frame threading scheduler, NULL if AVFILTER_THREAD_FRAME is not used.
+     */
+    void *sched;
+    /**
+     * Set while several filters are being activated concurrently; the
+     * state filters may touch on their neighbours (ready, frame_blocked_in,
+     * the sink links heap) must then be accessed under ff_graph_lock().
+     */
+    int concurrent;
+    /**
+     * Filters selected for concurrent activation, with room for max_wave.
+     */
+    AVFilterContext **wave;
+    int max_wave;
+
+    /**
+     * Filters with a non-0 ready field, in the order they became ready, one
+     * queue per priority class; bit n of ready_mask is set if queue n is not
+     * empty.
+     */
+    AVFilterContext *ready_head[FF_FILTER_READY_QUEUES];
+    AVFilterContext *ready_tail[FF_FILTER_READY_QUEUES];
+    unsigned ready_mask;
+
+    /**
+     * Video frame pools shared by the links of the graph, one per frame
+     * geometry; the graph holds one reference to each of them.
+     */
+    FFFramePool **frame_pools;
+    int nb_frame_pools;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
 
+    // links in the ready queue of the graph; ready_queue is -1 if not queued
+    AVFilterContext *ready_prev, *ready_next;
+    int ready_queue;
+
     // 1 when avfilter_init_*() was successfully called on this filter
     // 0 otherwise
     int initialized;
@@ -367,12 +411,38 @@ int ff_filter_activate(AVFilterContext *filter);
  */
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter);
 
+/**
+ * Remove a configured filter with one input and one output from its graph
+ * and free it, connecting the source of its input link directly to its
+ * output link. The properties of the output link are kept, so the caller
+ * must make the source filter produce what the removed filter did.
+ */
+void ff_filter_bypass(AVFilterContext *filter);
+
+/**
+ * Get a reference to the video frame pool of the graph for the given frame
+ * geometry, creating it if needed. All the links allocating frames of the
+ * same size and format share the same pool, so that a buffer released by a
+ * filter can be reused by any other one.
+ *
+ * @return a new reference to the pool, to be released with
+ *         ff_frame_pool_uninit(), or NULL on allocation failure
+ */
+FFFramePool *ff_graph_get_video_frame_pool(AVFilterGraph *graph, int w, int h,
+                                           enum AVPixelFormat format, int align);
+
 /**
  * The filter is aware of hardware frames, and any hardware frame context
  * should not be automatically propagated through it.
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter acts on other filters of the graph (e.g. sends them commands)
+ * and must never be activated concurrently with another filter.
+ */
+#define FF_FILTER_FLAG_GRAPH_EXCLUSIVE (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
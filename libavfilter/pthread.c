@@ -23,10 +23,12 @@
 
 #include <stddef.h>
 
+#include "libavutil/avassert.h"
 #include "libavutil/error.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -41,8 +43,23 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* serializes slice threading of concurrently activated filters */
+    pthread_mutex_t execute_lock;
 } ThreadContext;
 
+typedef struct SchedContext {
+    AVSliceThread *thread;
+    int nb_threads;
+
+    /* protects the state shared by concurrently activated filters */
+    pthread_mutex_t lock;
+
+    /* per-run parameters */
+    AVFilterContext **filters;
+    int              *rets;     ///< nb_threads entries
+} SchedContext;
+
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     ThreadContext *c = priv;
@@ -54,6 +71,7 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    pthread_mutex_destroy(&c->execute_lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -63,12 +81,14 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    pthread_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    pthread_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
@@ -80,6 +100,57 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
     return FFMAX(nb_threads, 1);
 }
 
+static void sched_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    SchedContext *s = priv;
+    s->rets[jobnr] = ff_filter_activate(s->filters[jobnr]);
+}
+
+static void sched_uninit(AVFilterGraph *graph)
+{
+    SchedContext *s = graph->internal->sched;
+
+    if (!s)
+        return;
+    avpriv_slicethread_free(&s->thread);
+    pthread_mutex_destroy(&s->lock);
+    av_freep(&s->rets);
+    av_freep(&graph->internal->wave);
+    av_freep(&graph->internal->sched);
+}
+
+static int sched_init(AVFilterGraph *graph)
+{
+    SchedContext *s;
+    int ret;
+
+    s = graph->internal->sched = av_mallocz(sizeof(*s));
+    if (!s)
+        return AVERROR(ENOMEM);
+
+    ret = avpriv_slicethread_create(&s->thread, s, sched_worker, NULL,
+                                    graph->nb_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&s->thread);
+        av_freep(&graph->internal->sched);
+        graph->thread_type &= ~AVFILTER_THREAD_FRAME;
+        return (ret < 0) ? ret : 0;
+    }
+    s->nb_threads = ret;
+
+    pthread_mutex_init(&s->lock, NULL);
+
+    s->rets               = av_calloc(s->nb_threads, sizeof(*s->rets));
+    graph->internal->wave = av_calloc(s->nb_threads, sizeof(*graph->internal->wave));
+    if (!s->rets || !graph->internal->wave) {
+        sched_uninit(graph);
+        return AVERROR(ENOMEM);
+    }
+    graph->internal->max_wave = s->nb_threads;
+
+    return 0;
+}
+
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
     int ret;
@@ -101,15 +172,54 @@ int ff_graph_thread_init(AVFilterGraph *graph)
         return (ret < 0) ? ret : 0;
     }
     graph->nb_threads = ret;
+    pthread_mutex_init(&((ThreadContext*)graph->internal->thread)->execute_lock, NULL);
 
     graph->internal->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_FRAME) {
+        ret = sched_init(graph);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
+    sched_uninit(graph);
     if (graph->internal->thread)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+void ff_graph_lock(AVFilterGraph *graph)
+{
+    SchedContext *s = graph->internal->sched;
+    pthread_mutex_lock(&s->lock);
+}
+
+void ff_graph_unlock(AVFilterGraph *graph)
+{
+    SchedContext *s = graph->internal->sched;
+    pthread_mutex_unlock(&s->lock);
+}
+
+int ff_graph_activate_filters(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters)
+{
+    SchedContext *s = graph->internal->sched;
+    int i;
+
+    av_assert1(nb_filters <= s->nb_threads);
+    s->filters = filters;
+
+    graph->internal->concurrent = 1;
+    avpriv_slicethread_execute(s->thread, nb_filters, 0);
+    graph->internal->concurrent = 0;
+
+    for (i = 0; i < nb_filters; i++)
+        if (s->rets[i] < 0)
+            return s->rets[i];
+    return 0;
+}
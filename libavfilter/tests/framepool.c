@@ -0,0 +1,125 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Run a filtergraph whose links share frame pools, resize the output of its
+ * scale filter between runs and print the frame pools of the graph after
+ * each run.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+static const char *graph_desc =
+    "testsrc2=s=64x48:r=25:d=1,split[a][b];"
+    "[a]scale=32:24,buffersink@a;"
+    "[b]hflip,scale@s=16:12,buffersink@b";
+
+static int run(AVFilterContext **sinks, AVFrame *frame, int nb_frames)
+{
+    int i, j, ret;
+
+    for (i = 0; i < nb_frames; i++) {
+        for (j = 0; j < 2; j++) {
+            ret = av_buffersink_get_frame(sinks[j], frame);
+            if (ret < 0)
+                return ret;
+            if (j && !i)
+                printf("output b: %dx%d\n", frame->width, frame->height);
+            av_frame_unref(frame);
+        }
+    }
+    return 0;
+}
+
+static int dump(AVFilterGraph *graph)
+{
+    char *pools = avfilter_graph_dump_frame_pools(graph);
+
+    if (!pools)
+        return AVERROR(ENOMEM);
+    printf("%s", pools);
+    av_free(pools);
+    return 0;
+}
+
+static int resize(AVFilterGraph *graph, const char *w, const char *h)
+{
+    int ret;
+
+    printf("resize to %sx%s\n", w, h);
+    ret = avfilter_graph_send_command(graph, "scale@s", "w", w, NULL, 0, 0);
+    if (ret < 0)
+        return ret;
+    return avfilter_graph_send_command(graph, "scale@s", "h", h, NULL, 0, 0);
+}
+
+int main(void)
+{
+    AVFilterGraph *graph = NULL;
+    AVFilterContext *sinks[2];
+    AVFrame *frame = NULL;
+    int ret;
+
+    /* the alignment of the pools depends on the CPU */
+    av_force_cpu_flags(0);
+
+    frame = av_frame_alloc();
+    graph = avfilter_graph_alloc();
+    if (!frame || !graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = 1;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    sinks[0] = avfilter_graph_get_filter(graph, "buffersink@a");
+    sinks[1] = avfilter_graph_get_filter(graph, "buffersink@b");
+    if (!sinks[0] || !sinks[1]) {
+        ret = AVERROR_BUG;
+        goto end;
+    }
+
+    /* once resized to 32x24, scale@s shares the pool of the other scale;
+     * the 16x12 pool is only dropped when the next new size is requested */
+    if ((ret = run(sinks, frame, 8))            < 0 ||
+        (ret = dump(graph))                     < 0 ||
+        (ret = resize(graph, "32", "24"))       < 0 ||
+        (ret = run(sinks, frame, 8))            < 0 ||
+        (ret = dump(graph))                     < 0 ||
+        (ret = resize(graph, "40", "30"))       < 0 ||
+        (ret = run(sinks, frame, 1))            < 0 ||
+        (ret = dump(graph))                     < 0)
+        goto end;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    return ret < 0;
+}
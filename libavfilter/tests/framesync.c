@@ -0,0 +1,184 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Feed an overlay filter without lookahead with a secondary input that
+ * stalls, and check that every frame of the primary input is output once
+ * the timeout expires, with the late action applied, and that a secondary
+ * frame arriving before the timeout expires is waited for.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES 20
+/* longer than the short timeout */
+#define SLEEP     30000
+
+static const char *graph_fmt =
+    "buffer@main=video_size=32x24:pix_fmt=yuv420p:time_base=1/25:frame_rate=25[main];"
+    "buffer@over=video_size=8x8:pix_fmt=yuva420p:time_base=1/25:frame_rate=25[over];"
+    "[main][over]overlay=lookahead=0:timeout=%s:late_action=%s,buffersink@out";
+
+static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
+{
+    AVClass *avc = ptr ? *(AVClass **)ptr : NULL;
+
+    /* only print the statistics of the frame sync */
+    if (level > AV_LOG_VERBOSE || !avc || strcmp(avc->class_name, "framesync"))
+        return;
+    vprintf(fmt, vl);
+}
+
+static int push(AVFilterContext *src, int64_t pts, int luma, int alpha)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret, i;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->format = alpha ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P;
+    frame->width  = alpha ? 8 : 32;
+    frame->height = alpha ? 8 : 24;
+    frame->pts    = pts;
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0)
+        goto end;
+    for (i = 0; i < frame->height; i++) {
+        memset(frame->data[0] + i * frame->linesize[0], luma, frame->width);
+        if (alpha)
+            memset(frame->data[3] + i * frame->linesize[3], 255, frame->width);
+    }
+    for (i = 0; i < frame->height / 2; i++) {
+        memset(frame->data[1] + i * frame->linesize[1], 128, frame->width / 2);
+        memset(frame->data[2] + i * frame->linesize[2], 128, frame->width / 2);
+    }
+    ret = av_buffersrc_add_frame(src, frame);
+end:
+    av_frame_free(&frame);
+    return ret;
+}
+
+/* Print the frames output so far, the filter never waits by itself. */
+static int pull(AVFilterContext *sink, AVFrame *frame)
+{
+    int ret;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        printf("frame %"PRId64": %s\n", frame->pts,
+               frame->data[0][0] == 235 ? "overlay" : "main");
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) ? 0 : ret;
+}
+
+/**
+ * @param in_time if set, the secondary input sends every frame after the
+ *                primary one, before the timeout expires; otherwise it sends
+ *                a frame at the start and at the middle, and stalls in between
+ */
+static int run(const char *late_action, int in_time)
+{
+    AVFilterGraph *graph = NULL;
+    AVFilterContext *main_src, *over_src, *sink;
+    AVFrame *frame = NULL;
+    char *graph_desc = NULL;
+    int ret, i;
+
+    printf("late_action=%s%s\n", late_action, in_time ? ", frames in time" : "");
+    graph_desc = av_asprintf(graph_fmt, in_time ? "10" : "0.02", late_action);
+    frame = av_frame_alloc();
+    graph = avfilter_graph_alloc();
+    if (!graph_desc || !frame || !graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = 1;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    main_src = avfilter_graph_get_filter(graph, "buffer@main");
+    over_src = avfilter_graph_get_filter(graph, "buffer@over");
+    sink     = avfilter_graph_get_filter(graph, "buffersink@out");
+    if (!main_src || !over_src || !sink) {
+        ret = AVERROR_BUG;
+        goto end;
+    }
+
+    for (i = 0; i < NB_FRAMES; i++) {
+        if (in_time) {
+            /* the frame of the primary input is output after this line */
+            if ((ret = push(main_src, i, 16, 0)) < 0 ||
+                (ret = pull(sink, frame)) < 0)
+                goto end;
+            printf("secondary frame %d\n", i);
+            if ((ret = push(over_src, i, 235, 1)) < 0 ||
+                (ret = pull(sink, frame)) < 0)
+                goto end;
+            continue;
+        }
+        if (!(i % (NB_FRAMES / 2)) && (ret = push(over_src, i, 235, 1)) < 0)
+            goto end;
+        /* the timeout is checked when the next frame arrives */
+        if ((ret = push(main_src, i, 16, 0)) < 0 ||
+            (ret = pull(sink, frame)) < 0)
+            goto end;
+        av_usleep(SLEEP);
+    }
+
+    if ((ret = av_buffersrc_add_frame(main_src, NULL)) < 0 ||
+        (ret = av_buffersrc_add_frame(over_src, NULL)) < 0)
+        goto end;
+    ret = pull(sink, frame);
+    if (ret == AVERROR_EOF)
+        ret = 0;
+    else if (!ret)
+        ret = AVERROR_BUG;
+
+end:
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    av_free(graph_desc);
+    return ret;
+}
+
+int main(void)
+{
+    int ret;
+
+    av_log_set_level(AV_LOG_VERBOSE);
+    av_log_set_callback(log_callback);
+
+    if ((ret = run("repeat", 0)) < 0 ||
+        (ret = run("skip",   0)) < 0 ||
+        (ret = run("repeat", 1)) < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    return ret < 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Run a wide filtergraph made of many short-lived null filters, so that the
+ * time spent is dominated by the scheduling of the graph; the run time is
+ * printed on stderr.
+ *
+ * Usage: graphsched [frames [chains [chain_length]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/bprint.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+int main(int argc, char **argv)
+{
+    int nb_frames = argc > 1 ? atoi(argv[1]) : 50;
+    int nb_chains = argc > 2 ? atoi(argv[2]) :  8;
+    int chain_len = argc > 3 ? atoi(argv[3]) : 64;
+    AVFilterGraph *graph = NULL;
+    AVFilterContext **sinks = NULL;
+    int *counts = NULL;
+    AVFrame *frame = NULL;
+    AVBPrint desc;
+    int64_t t0;
+    int i, j, ret, nb_eof = 0;
+
+    if (nb_frames <= 0 || nb_chains <= 0 || chain_len <= 0) {
+        fprintf(stderr, "Usage: %s [frames [chains [chain_length]]]\n", argv[0]);
+        return 1;
+    }
+
+    av_bprint_init(&desc, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&desc, "nullsrc=s=16x16:r=1:d=%d,split=%d",
+               nb_frames, nb_chains);
+    for (i = 0; i < nb_chains; i++)
+        av_bprintf(&desc, "[c%d]", i);
+    for (i = 0; i < nb_chains; i++) {
+        av_bprintf(&desc, ";[c%d]", i);
+        for (j = 0; j < chain_len; j++)
+            av_bprintf(&desc, "null,");
+        av_bprintf(&desc, "buffersink@sink%d", i);
+    }
+    sinks  = av_calloc(nb_chains, sizeof(*sinks));
+    counts = av_calloc(nb_chains, sizeof(*counts));
+    frame  = av_frame_alloc();
+    if (!av_bprint_is_complete(&desc) || !sinks || !counts || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    graph = avfilter_graph_alloc();
+    if (!graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = 1;
+    if ((ret = avfilter_graph_parse_ptr(graph, desc.str, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+    printf("filters: %u\n", graph->nb_filters);
+
+    for (i = 0; i < nb_chains; i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "buffersink@sink%d", i);
+        sinks[i] = avfilter_graph_get_filter(graph, name);
+        if (!sinks[i]) {
+            ret = AVERROR_BUG;
+            goto end;
+        }
+    }
+
+    t0 = av_gettime_relative();
+    while (nb_eof < nb_chains) {
+        for (i = 0; i < nb_chains; i++) {
+            if (!sinks[i])
+                continue;
+            ret = av_buffersink_get_frame(sinks[i], frame);
+            if (ret == AVERROR_EOF) {
+                sinks[i] = NULL;
+                nb_eof++;
+                continue;
+            } else if (ret < 0)
+                goto end;
+            counts[i]++;
+            av_frame_unref(frame);
+        }
+    }
+    fprintf(stderr, "%d frames through %u filters: %"PRId64" us\n",
+            nb_frames, graph->nb_filters, av_gettime_relative() - t0);
+
+    for (i = 0; i < nb_chains; i++)
+        printf("sink%d: %d frames\n", i, counts[i]);
+    ret = 0;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    av_freep(&sinks);
+    av_freep(&counts);
+    av_bprint_finalize(&desc, NULL);
+    return ret < 0;
+}
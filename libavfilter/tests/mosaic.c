@@ -0,0 +1,164 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Feed a mosaic filter in the default "latest" sync mode with a secondary
+ * input that stops sending frames and another one sending two frames per
+ * frame of the first input, and check that every frame of the first input
+ * is output at once, with the last frame of each input and the right
+ * repeated and dropped frame counts.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES  10
+#define NB_STALLED  3
+#define TILE_SIZE  32
+
+static const char *graph_desc =
+    "buffer@in0=video_size=32x32:pix_fmt=yuv420p:time_base=1/25:frame_rate=25[in0];"
+    "buffer@in1=video_size=32x32:pix_fmt=yuv420p:time_base=1/25:frame_rate=25[in1];"
+    "buffer@in2=video_size=32x32:pix_fmt=yuv420p:time_base=1/50:frame_rate=50[in2];"
+    "[in0][in1][in2]mosaic=inputs=3:grid=3x1:size=96x32,buffersink@out";
+
+static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
+{
+    AVClass *avc = ptr ? *(AVClass **)ptr : NULL;
+
+    /* only print the frame counts of the mosaic filter */
+    if (level > AV_LOG_VERBOSE || !avc || strcmp(avc->class_name, "AVFilter") ||
+        strcmp(((AVFilterContext *)ptr)->filter->name, "mosaic"))
+        return;
+    vprintf(fmt, vl);
+}
+
+static int push(AVFilterContext *src, int64_t pts, int luma)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width  = TILE_SIZE;
+    frame->height = TILE_SIZE;
+    frame->pts    = pts;
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0)
+        goto end;
+    for (int i = 0; i < TILE_SIZE; i++)
+        memset(frame->data[0] + i * frame->linesize[0], luma, TILE_SIZE);
+    for (int i = 0; i < TILE_SIZE / 2; i++) {
+        memset(frame->data[1] + i * frame->linesize[1], 128, TILE_SIZE / 2);
+        memset(frame->data[2] + i * frame->linesize[2], 128, TILE_SIZE / 2);
+    }
+    ret = av_buffersrc_add_frame(src, frame);
+end:
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int pull(AVFilterContext *sink, AVFrame *frame)
+{
+    /* the output must never wait for the secondary inputs */
+    int ret = av_buffersink_get_frame(sink, frame);
+
+    if (ret == AVERROR(EAGAIN)) {
+        printf("output stalled\n");
+        return AVERROR_BUG;
+    }
+    if (ret < 0)
+        return ret;
+    printf("frame %"PRId64":", frame->pts);
+    for (int i = 0; i < 3; i++)
+        printf(" %3d", frame->data[0][TILE_SIZE / 2 * frame->linesize[0] +
+                                      i * TILE_SIZE + TILE_SIZE / 2]);
+    printf("\n");
+    av_frame_unref(frame);
+    return 0;
+}
+
+int main(void)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *src[3], *sink;
+    AVFrame *frame;
+    int ret, i;
+
+    av_log_set_level(AV_LOG_VERBOSE);
+    av_log_set_callback(log_callback);
+
+    frame = av_frame_alloc();
+    graph = avfilter_graph_alloc();
+    if (!frame || !graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = 1;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    src[0] = avfilter_graph_get_filter(graph, "buffer@in0");
+    src[1] = avfilter_graph_get_filter(graph, "buffer@in1");
+    src[2] = avfilter_graph_get_filter(graph, "buffer@in2");
+    sink   = avfilter_graph_get_filter(graph, "buffersink@out");
+    if (!src[0] || !src[1] || !src[2] || !sink) {
+        ret = AVERROR_BUG;
+        goto end;
+    }
+
+    /* in1 stops sending frames without closing, in2 sends twice as many
+     * frames as in0, the first of each pair being dropped */
+    for (i = 0; i < NB_FRAMES; i++) {
+        if ((i < NB_STALLED && (ret = push(src[1], i, 64 + i)) < 0) ||
+            (ret = push(src[2], 2 * i,     128 + 2 * i)) < 0 ||
+            (ret = push(src[2], 2 * i + 1, 128 + 2 * i + 1)) < 0 ||
+            (ret = push(src[0], i, 16 + i)) < 0 ||
+            (ret = pull(sink, frame)) < 0)
+            goto end;
+    }
+
+    /* the end of in0 ends the output, whatever the other inputs do */
+    if ((ret = av_buffersrc_add_frame(src[0], NULL)) < 0)
+        goto end;
+    ret = av_buffersink_get_frame(sink, frame);
+    if (ret != AVERROR_EOF) {
+        printf("no end of output: %s\n", av_err2str(ret));
+        ret = AVERROR_BUG;
+        goto end;
+    }
+    ret = 0;
+
+end:
+    /* the counts are printed when the filter is freed */
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    return ret < 0;
+}
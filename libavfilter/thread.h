@@ -25,4 +25,21 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Lock/unlock the state shared between filters while
+ * AVFilterGraphInternal.concurrent is set.
+ */
+void ff_graph_lock(AVFilterGraph *graph);
+void ff_graph_unlock(AVFilterGraph *graph);
+
+/**
+ * Activate filters concurrently on the frame threads of the graph.
+ * No two of the filters may be linked to each other.
+ *
+ * @param nb_filters number of filters, at most the number of frame threads
+ * @return the first error returned by ff_filter_activate(), or 0
+ */
+int ff_graph_activate_filters(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters);
+
 #endif /* AVFILTER_THREAD_H */
@@ -49,10 +49,10 @@ static const uint16_t coef_hf[3] = { 5570, 3801, 1016 };
 static const uint16_t coef_sp[2] = { 5077, 981 };
 
 typedef struct ThreadData {
-    AVFrame *frame;
-    int plane;
-    int w, h;
-    int parity;
+    AVFrame *frame[2];
+    int parity[2];
+    int intra[2];
+    int nb_fields;
     int tff;
 } ThreadData;
 
@@ -212,47 +212,72 @@ static void filter_edge_16bit(void *dst1, void *prev1, void *cur1, void *next1,
     FILTER2()
 }
 
-static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void filter_plane(BWDIFContext *s, AVFrame *frame, int plane,
+                         int w, int h, int parity, int tff, int intra,
+                         int slice_start, int slice_end)
 {
-    BWDIFContext *s = ctx->priv;
     YADIFContext *yadif = &s->yadif;
-    ThreadData *td  = arg;
-    int linesize = yadif->cur->linesize[td->plane];
-    int clip_max = (1 << (yadif->csp->comp[td->plane].depth)) - 1;
-    int df = (yadif->csp->comp[td->plane].depth + 7) / 8;
+    int linesize = yadif->cur->linesize[plane];
+    int clip_max = (1 << (yadif->csp->comp[plane].depth)) - 1;
+    int df = (yadif->csp->comp[plane].depth + 7) / 8;
     int refs = linesize / df;
-    int slice_start = (td->h *  jobnr   ) / nb_jobs;
-    int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
     int y;
 
     for (y = slice_start; y < slice_end; y++) {
-        if ((y ^ td->parity) & 1) {
-            uint8_t *prev = &yadif->prev->data[td->plane][y * linesize];
-            uint8_t *cur  = &yadif->cur ->data[td->plane][y * linesize];
-            uint8_t *next = &yadif->next->data[td->plane][y * linesize];
-            uint8_t *dst  = &td->frame->data[td->plane][y * td->frame->linesize[td->plane]];
-            if (yadif->current_field == YADIF_FIELD_END) {
-                s->filter_intra(dst, cur, td->w, (y + df) < td->h ? refs : -refs,
+        if ((y ^ parity) & 1) {
+            uint8_t *prev = &yadif->prev->data[plane][y * linesize];
+            uint8_t *cur  = &yadif->cur ->data[plane][y * linesize];
+            uint8_t *next = &yadif->next->data[plane][y * linesize];
+            uint8_t *dst  = &frame->data[plane][y * frame->linesize[plane]];
+            if (intra) {
+                s->filter_intra(dst, cur, w, (y + df) < h ? refs : -refs,
                                 y > (df - 1) ? -refs : refs,
-                                (y + 3*df) < td->h ? 3 * refs : -refs,
+                                (y + 3*df) < h ? 3 * refs : -refs,
                                 y > (3*df - 1) ? -3 * refs : refs,
-                                td->parity ^ td->tff, clip_max);
-            } else if ((y < 4) || ((y + 5) > td->h)) {
-                s->filter_edge(dst, prev, cur, next, td->w,
-                               (y + df) < td->h ? refs : -refs,
+                                parity ^ tff, clip_max);
+            } else if ((y < 4) || ((y + 5) > h)) {
+                s->filter_edge(dst, prev, cur, next, w,
+                               (y + df) < h ? refs : -refs,
                                y > (df - 1) ? -refs : refs,
                                refs << 1, -(refs << 1),
-                               td->parity ^ td->tff, clip_max,
-                               (y < 2) || ((y + 3) > td->h) ? 0 : 1);
+                               parity ^ tff, clip_max,
+                               (y < 2) || ((y + 3) > h) ? 0 : 1);
             } else {
-                s->filter_line(dst, prev, cur, next, td->w,
+                s->filter_line(dst, prev, cur, next, w,
                                refs, -refs, refs << 1, -(refs << 1),
                                3 * refs, -3 * refs, refs << 2, -(refs << 2),
-                               td->parity ^ td->tff, clip_max);
+                               parity ^ tff, clip_max);
             }
         } else {
-            memcpy(&td->frame->data[td->plane][y * td->frame->linesize[td->plane]],
-                   &yadif->cur->data[td->plane][y * linesize], td->w * df);
+            memcpy(&frame->data[plane][y * frame->linesize[plane]],
+                   &yadif->cur->data[plane][y * linesize], w * df);
+        }
+    }
+}
+
+/* each job filters the same band of all the planes of all the fields */
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BWDIFContext *s = ctx->priv;
+    YADIFContext *yadif = &s->yadif;
+    ThreadData *td  = arg;
+    int f, i;
+
+    for (f = 0; f < td->nb_fields; f++) {
+        AVFrame *frame = td->frame[f];
+
+        for (i = 0; i < yadif->csp->nb_components; i++) {
+            int w = frame->width;
+            int h = frame->height;
+
+            if (i == 1 || i == 2) {
+                w = AV_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w);
+                h = AV_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h);
+            }
+
+            filter_plane(s, frame, i, w, h, td->parity[f], td->tff,
+                         td->intra[f], (h *  jobnr   ) / nb_jobs,
+                         (h * (jobnr+1)) / nb_jobs);
         }
     }
     return 0;
@@ -263,25 +288,13 @@ static void filter(AVFilterContext *ctx, AVFrame *dstpic,
 {
     BWDIFContext *bwdif = ctx->priv;
     YADIFContext *yadif = &bwdif->yadif;
-    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
-    int i;
-
-    for (i = 0; i < yadif->csp->nb_components; i++) {
-        int w = dstpic->width;
-        int h = dstpic->height;
-
-        if (i == 1 || i == 2) {
-            w = AV_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w);
-            h = AV_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h);
-        }
+    ThreadData td = { .frame = { dstpic }, .nb_fields = 1, .tff = tff };
 
-        td.w     = w;
-        td.h     = h;
-        td.plane = i;
+    td.parity[0] = parity;
+    td.intra[0]  = yadif->current_field == YADIF_FIELD_END;
 
-        ff_filter_execute(ctx, filter_slice, &td, NULL,
-                          FFMIN(h, ff_filter_get_nb_threads(ctx)));
-    }
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dstpic->height, ff_filter_get_nb_threads(ctx)));
     if (yadif->current_field == YADIF_FIELD_END) {
         yadif->current_field = YADIF_FIELD_NORMAL;
     }
@@ -289,6 +302,27 @@ static void filter(AVFilterContext *ctx, AVFrame *dstpic,
     emms_c();
 }
 
+static void filter_fields(AVFilterContext *ctx, AVFrame *dst1, AVFrame *dst2,
+                          int tff)
+{
+    BWDIFContext *bwdif = ctx->priv;
+    YADIFContext *yadif = &bwdif->yadif;
+    ThreadData td = { .frame = { dst1, dst2 }, .nb_fields = 2, .tff = tff };
+
+    td.parity[0] = tff ^ 1;
+    td.parity[1] = tff;
+    /* the first field of a sequence is only in the first frame, the last
+     * field of a sequence only in the second one */
+    td.intra[0]  = yadif->current_field == YADIF_FIELD_END;
+    td.intra[1]  = yadif->current_field == YADIF_FIELD_BACK_END;
+
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dst1->height, ff_filter_get_nb_threads(ctx)));
+    yadif->current_field = YADIF_FIELD_NORMAL;
+
+    emms_c();
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     BWDIFContext *bwdif = ctx->priv;
@@ -297,6 +331,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&yadif->prev);
     av_frame_free(&yadif->cur );
     av_frame_free(&yadif->next);
+    av_frame_free(&yadif->out_next);
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -340,6 +375,7 @@ static int config_props(AVFilterLink *link)
 
     yadif->csp = av_pix_fmt_desc_get(link->format);
     yadif->filter = filter;
+    yadif->filter_fields = filter_fields;
     ff_bwdif_init_filter_line(s, yadif->csp->comp[0].depth);
 
     return 0;
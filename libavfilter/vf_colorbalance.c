@@ -386,6 +386,16 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+static int is_noop(const ColorBalanceContext *s)
+{
+    const Range *r[3] = { &s->cyan_red, &s->magenta_green, &s->yellow_blue };
+
+    for (int i = 0; i < 3; i++)
+        if (r[i]->shadows || r[i]->midtones || r[i]->highlights)
+            return 0;
+    return !s->preserve_lightness;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -394,15 +404,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     ThreadData td;
     AVFrame *out;
 
-    if (av_frame_is_writable(in)) {
-        out = in;
-    } else {
-        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!out) {
-            av_frame_free(&in);
-            return AVERROR(ENOMEM);
-        }
-        av_frame_copy_props(out, in);
+    if (is_noop(s))
+        return ff_filter_frame(outlink, in);
+
+    out = ff_get_video_buffer_inplace(outlink, in);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
     }
 
     td.in = in;
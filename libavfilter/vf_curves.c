@@ -80,6 +80,7 @@ typedef struct CurvesContext {
     int depth;
     int parsed_psfile;
     int interp;
+    int is_identity;            ///< the curves do not change any pixel
 
     int (*filter_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } CurvesContext;
@@ -893,6 +894,12 @@ static int config_input(AVFilterLink *inlink)
                 curves->graph[i][j] = curves->graph[NB_COMP][curves->graph[i][j]];
     }
 
+    curves->is_identity = 1;
+    for (i = 0; i < NB_COMP; i++)
+        for (j = 0; j < curves->lut_size; j++)
+            if (curves->graph[i][j] != j)
+                curves->is_identity = 0;
+
     if (av_log_get_level() >= AV_LOG_VERBOSE) {
         for (i = 0; i < NB_COMP; i++) {
             const struct keypoint *point = comp_points[i];
@@ -929,15 +936,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFrame *out;
     ThreadData td;
 
-    if (av_frame_is_writable(in)) {
-        out = in;
-    } else {
-        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!out) {
-            av_frame_free(&in);
-            return AVERROR(ENOMEM);
-        }
-        av_frame_copy_props(out, in);
+    if (curves->is_identity)
+        return ff_filter_frame(outlink, in);
+
+    out = ff_get_video_buffer_inplace(outlink, in);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
     }
 
     td.in  = in;
@@ -221,18 +221,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterLink *outlink = inlink->dst->outputs[0];
     EQContext *eq = ctx->priv;
     AVFrame *out;
-    const AVPixFmtDescriptor *desc;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     int i;
 
-    out = ff_get_video_buffer(outlink, inlink->w, inlink->h);
-    if (!out) {
-        av_frame_free(&in);
-        return AVERROR(ENOMEM);
-    }
-
-    av_frame_copy_props(out, in);
-    desc = av_pix_fmt_desc_get(inlink->format);
-
     eq->var_values[VAR_N]   = inlink->frame_count_out;
 #if FF_API_FRAME_PKT
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -251,6 +242,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
         set_saturation(eq);
     }
 
+    if (!eq->param[0].adjust && !eq->param[1].adjust && !eq->param[2].adjust)
+        return ff_filter_frame(outlink, in);
+
+    out = ff_get_video_buffer_inplace(outlink, in);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+
     for (i = 0; i < desc->nb_components; i++) {
         int w = inlink->w;
         int h = inlink->h;
@@ -260,16 +260,17 @@ FF_ENABLE_DEPRECATION_WARNINGS
             h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
         }
 
-        if (i == 3 || !eq->param[i].adjust)
-            av_image_copy_plane(out->data[i], out->linesize[i],
-                                in->data[i], in->linesize[i], w, h);
-
-        else
+        if (i == 3 || !eq->param[i].adjust) {
+            if (out != in)
+                av_image_copy_plane(out->data[i], out->linesize[i],
+                                    in->data[i], in->linesize[i], w, h);
+        } else
             eq->param[i].adjust(&eq->param[i], out->data[i], out->linesize[i],
                                  in->data[i], in->linesize[i], w, h);
     }
 
-    av_frame_free(&in);
+    if (out != in)
+        av_frame_free(&in);
     return ff_filter_frame(outlink, out);
 }
 
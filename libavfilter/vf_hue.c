@@ -363,22 +363,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
     AVFrame *outpic;
     const int32_t old_hue_sin = hue->hue_sin, old_hue_cos = hue->hue_cos;
     const float old_brightness = hue->brightness;
-    int direct = 0;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     const int bps = desc->comp[0].depth > 8 ? 2 : 1;
 
-    if (av_frame_is_writable(inpic)) {
-        direct = 1;
-        outpic = inpic;
-    } else {
-        outpic = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!outpic) {
-            av_frame_free(&inpic);
-            return AVERROR(ENOMEM);
-        }
-        av_frame_copy_props(outpic, inpic);
-    }
-
     hue->var_values[VAR_N]   = inlink->frame_count_out;
     hue->var_values[VAR_T]   = TS2T(inpic->pts, inlink->time_base);
     hue->var_values[VAR_PTS] = TS2D(inpic->pts);
@@ -424,8 +411,19 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
 
     if (hue->is_first || (old_brightness != hue->brightness && hue->brightness))
         create_luma_lut(hue);
+    hue->is_first = 0;
+
+    /* no rotation, unit saturation and no brightness change */
+    if (!hue->hue_sin && hue->hue_cos == 1 << 16 && !hue->brightness)
+        return ff_filter_frame(outlink, inpic);
 
-    if (!direct) {
+    outpic = ff_get_video_buffer_inplace(outlink, inpic);
+    if (!outpic) {
+        av_frame_free(&inpic);
+        return AVERROR(ENOMEM);
+    }
+
+    if (outpic != inpic) {
         if (!hue->brightness)
             av_image_copy_plane(outpic->data[0], outpic->linesize[0],
                                 inpic->data[0],   inpic->linesize[0],
@@ -454,10 +452,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
                                 inpic->data[0],  inpic->linesize[0], inlink->w, inlink->h);
     }
 
-    if (!direct)
+    if (outpic != inpic)
         av_frame_free(&inpic);
 
-    hue->is_first = 0;
     return ff_filter_frame(outlink, outpic);
 }
 
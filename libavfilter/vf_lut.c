@@ -71,6 +71,7 @@ typedef struct LutContext {
     int is_planar;
     int is_16bit;
     int step;
+    int is_identity;             ///< the lut does not change any pixel
 } LutContext;
 
 #define Y 0
@@ -332,6 +333,12 @@ static int config_props(AVFilterLink *inlink)
         }
     }
 
+    s->is_identity = 1;
+    for (color = 0; color < (s->is_rgb && !s->is_planar ? s->step : desc->nb_components); color++)
+        for (val = 0; val < 1 << desc->comp[0].depth; val++)
+            if (s->lut[color][val] != val)
+                s->is_identity = 0;
+
     return 0;
 }
 
@@ -522,18 +529,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     LutContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out;
-    int direct = 0;
 
-    if (av_frame_is_writable(in)) {
-        direct = 1;
-        out = in;
-    } else {
-        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!out) {
-            av_frame_free(&in);
-            return AVERROR(ENOMEM);
-        }
-        av_frame_copy_props(out, in);
+    if (s->is_identity)
+        return ff_filter_frame(outlink, in);
+
+    out = ff_get_video_buffer_inplace(outlink, in);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
     }
 
     if (s->is_rgb && s->is_16bit && !s->is_planar) {
@@ -558,7 +561,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                           FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
     }
 
-    if (!direct)
+    if (out != in)
         av_frame_free(&in);
 
     return ff_filter_frame(outlink, out);
@@ -0,0 +1,480 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * compose many video streams into a grid, e.g. for multiviewers
+ *
+ * Each input is scaled directly into its tile of the output frame, the
+ * tiles being scaled in parallel. The output follows the first input; in
+ * the default "latest" sync mode the other inputs never hold it back, the
+ * last frame received on each of them being used.
+ */
+
+#include <inttypes.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "drawutils.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+enum MosaicSync {
+    SYNC_LATEST,
+    SYNC_PTS,
+    SYNC_NB
+};
+
+typedef struct MosaicTile {
+    int x, y, w, h;
+} MosaicTile;
+
+typedef struct MosaicInput {
+    AVFrame *frame;             ///< last frame received, NULL until the first one
+    int used;                   ///< frame was composited at least once
+    int eof;
+
+    struct SwsContext *sws;
+    int sws_w, sws_h;           ///< source properties sws was initialized for
+    enum AVPixelFormat sws_format;
+
+    int64_t nb_dropped;         ///< frames replaced before being composited
+    int64_t nb_repeated;        ///< frames composited more than once
+} MosaicInput;
+
+typedef struct MosaicContext {
+    const AVClass *class;
+    int nb_inputs;
+    int nb_columns, nb_rows;
+    int w, h;
+    uint8_t fillcolor[4];
+    int sync;
+    char *flags_str;
+
+    MosaicInput *inputs;
+    MosaicTile *tiles;
+    int nb_tiles;
+    int *rets;
+
+    int hsub, vsub;
+    int pixsteps[4];
+    FFDrawContext draw;
+    FFDrawColor color;
+} MosaicContext;
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MosaicContext *s = ctx->priv;
+    int ret;
+
+    s->nb_tiles = s->nb_columns * s->nb_rows;
+    if (!s->nb_inputs)
+        s->nb_inputs = s->nb_tiles;
+    if (s->nb_inputs > s->nb_tiles) {
+        av_log(ctx, AV_LOG_ERROR, "%d inputs do not fit in a %dx%d grid.\n",
+               s->nb_inputs, s->nb_columns, s->nb_rows);
+        return AVERROR(EINVAL);
+    }
+
+    s->inputs = av_calloc(s->nb_inputs, sizeof(*s->inputs));
+    s->tiles  = av_calloc(s->nb_tiles,  sizeof(*s->tiles));
+    s->rets   = av_calloc(s->nb_tiles,  sizeof(*s->rets));
+    if (!s->inputs || !s->tiles || !s->rets)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->nb_inputs; i++) {
+        AVFilterPad pad = { 0 };
+
+        pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.name = av_asprintf("input%d", i);
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+
+        if ((ret = ff_append_inpad_free_name(ctx, &pad)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MosaicContext *s = ctx->priv;
+
+    for (int i = 0; s->inputs && i < s->nb_inputs; i++) {
+        MosaicInput *in = &s->inputs[i];
+
+        if (in->nb_dropped || in->nb_repeated)
+            av_log(ctx, AV_LOG_VERBOSE, "input%d: %"PRId64" frames dropped, "
+                   "%"PRId64" frames repeated\n", i, in->nb_dropped, in->nb_repeated);
+        av_frame_free(&in->frame);
+        sws_freeContext(in->sws);
+    }
+    av_freep(&s->inputs);
+    av_freep(&s->tiles);
+    av_freep(&s->rets);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *draw_formats = ff_draw_supported_pixel_formats(0);
+    AVFilterFormats *formats = NULL;
+    int ret = 0;
+
+    if (!draw_formats)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < draw_formats->nb_formats; i++) {
+        enum AVPixelFormat pix_fmt = draw_formats->formats[i];
+
+        if (sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            break;
+    }
+    ff_formats_unref(&draw_formats);
+    if (ret < 0 || (ret = ff_formats_ref(formats, &ctx->outputs[0]->incfg.formats)) < 0) {
+        ff_formats_unref(&formats);
+        return ret;
+    }
+
+    /* each input is converted on its own, so they do not share a list */
+    for (int i = 0; i < ctx->nb_inputs; i++) {
+        const AVPixFmtDescriptor *desc = NULL;
+
+        formats = NULL;
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+            if (sws_isSupportedInput(pix_fmt) &&
+                (ret = ff_add_format(&formats, pix_fmt)) < 0)
+                return ret;
+        }
+        if ((ret = ff_formats_ref(formats, &ctx->inputs[i]->outcfg.formats)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MosaicContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(outlink->format);
+    int ret;
+
+    s->hsub = desc->log2_chroma_w;
+    s->vsub = desc->log2_chroma_h;
+    av_image_fill_max_pixsteps(s->pixsteps, NULL, desc);
+
+    ret = ff_draw_init(&s->draw, outlink->format, 0);
+    if (ret < 0)
+        return ret;
+    ff_draw_color(&s->draw, &s->color, s->fillcolor);
+
+    /* the tile edges are aligned on the chroma subsampling so that every
+     * tile starts on a chroma sample */
+    for (int i = 0; i < s->nb_tiles; i++) {
+        MosaicTile *t = &s->tiles[i];
+        int col = i % s->nb_columns, row = i / s->nb_columns;
+        int x1 = col + 1 == s->nb_columns ? s->w : (col + 1) * s->w / s->nb_columns;
+        int y1 = row + 1 == s->nb_rows    ? s->h : (row + 1) * s->h / s->nb_rows;
+
+        t->x = ff_draw_round_to_sub(&s->draw, 0, -1, col * s->w / s->nb_columns);
+        t->y = ff_draw_round_to_sub(&s->draw, 1, -1, row * s->h / s->nb_rows);
+        if (x1 < s->w)
+            x1 = ff_draw_round_to_sub(&s->draw, 0, -1, x1);
+        if (y1 < s->h)
+            y1 = ff_draw_round_to_sub(&s->draw, 1, -1, y1);
+        t->w = x1 - t->x;
+        t->h = y1 - t->y;
+        if (t->w <= 0 || t->h <= 0) {
+            av_log(ctx, AV_LOG_ERROR, "Output size %dx%d too small for a %dx%d grid.\n",
+                   s->w, s->h, s->nb_columns, s->nb_rows);
+            return AVERROR(EINVAL);
+        }
+    }
+
+    outlink->w = s->w;
+    outlink->h = s->h;
+    outlink->sample_aspect_ratio = (AVRational){ 1, 1 };
+    outlink->time_base  = ctx->inputs[0]->time_base;
+    outlink->frame_rate = ctx->inputs[0]->frame_rate;
+
+    return 0;
+}
+
+static int update_sws(AVFilterContext *ctx, MosaicInput *in, const MosaicTile *t)
+{
+    MosaicContext *s = ctx->priv;
+    const AVFrame *frame = in->frame;
+    enum AVPixelFormat format = ctx->outputs[0]->format;
+    struct SwsContext *sws;
+    int ret;
+
+    if (in->sws && in->sws_w == frame->width && in->sws_h == frame->height &&
+        in->sws_format == frame->format)
+        return 0;
+
+    sws_freeContext(in->sws);
+    in->sws = sws = sws_alloc_context();
+    if (!sws)
+        return AVERROR(ENOMEM);
+
+    if (s->flags_str && *s->flags_str) {
+        ret = av_opt_set(sws, "sws_flags", s->flags_str, 0);
+        if (ret < 0)
+            return ret;
+    }
+    /* the tiles are scaled in parallel already */
+    av_opt_set_int(sws, "threads",    1,             0);
+    av_opt_set_int(sws, "srcw",       frame->width,  0);
+    av_opt_set_int(sws, "srch",       frame->height, 0);
+    av_opt_set_int(sws, "src_format", frame->format, 0);
+    av_opt_set_int(sws, "dstw",       t->w,          0);
+    av_opt_set_int(sws, "dsth",       t->h,          0);
+    av_opt_set_int(sws, "dst_format", format,        0);
+
+    /* MPEG-2 chroma positions, as in the scale filter */
+    if (frame->format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "src_v_chr_pos", 128, 0);
+    if (format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "dst_v_chr_pos", 128, 0);
+
+    ret = sws_init_context(sws, NULL, NULL);
+    if (ret < 0)
+        return ret;
+
+    in->sws_w      = frame->width;
+    in->sws_h      = frame->height;
+    in->sws_format = frame->format;
+
+    return 0;
+}
+
+static int compose_tiles(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MosaicContext *s = ctx->priv;
+    AVFrame *out = arg;
+
+    for (int i = jobnr; i < s->nb_tiles; i += nb_jobs) {
+        const MosaicTile *t = &s->tiles[i];
+        const MosaicInput *in = i < s->nb_inputs ? &s->inputs[i] : NULL;
+        const AVFrame *frame = in ? in->frame : NULL;
+        uint8_t *dst[4] = { NULL };
+
+        s->rets[i] = 0;
+        if (!frame) {
+            ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
+                              t->x, t->y, t->w, t->h);
+            continue;
+        }
+
+        for (int p = 0; p < 4 && out->data[p]; p++) {
+            int hsub = p == 1 || p == 2 ? s->hsub : 0;
+            int vsub = p == 1 || p == 2 ? s->vsub : 0;
+
+            dst[p] = out->data[p] + (t->y >> vsub) * out->linesize[p] +
+                     (t->x >> hsub) * s->pixsteps[p];
+        }
+        s->rets[i] = sws_scale(in->sws, (const uint8_t * const *)frame->data,
+                               frame->linesize, 0, frame->height,
+                               dst, out->linesize);
+    }
+
+    return 0;
+}
+
+static int compose(AVFilterContext *ctx, AVFrame *main)
+{
+    MosaicContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *out;
+    int ret;
+
+    av_frame_free(&s->inputs[0].frame);
+    s->inputs[0].frame = main;
+    s->inputs[0].used  = 0;
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out)
+        return AVERROR(ENOMEM);
+    ret = av_frame_copy_props(out, main);
+    if (ret < 0)
+        goto fail;
+    out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+
+    /* the scalers are set up here rather than in the worker threads */
+    for (int i = 0; i < s->nb_inputs; i++) {
+        MosaicInput *in = &s->inputs[i];
+
+        if (!in->frame)
+            continue;
+        ret = update_sws(ctx, in, &s->tiles[i]);
+        if (ret < 0)
+            goto fail;
+        if (in->used)
+            in->nb_repeated++;
+        in->used = 1;
+    }
+
+    ff_filter_execute(ctx, compose_tiles, out, NULL,
+                      FFMIN(s->nb_tiles, ff_filter_get_nb_threads(ctx)));
+    for (int i = 0; i < s->nb_tiles; i++)
+        if (s->rets[i] < 0) {
+            ret = s->rets[i];
+            goto fail;
+        }
+
+    return ff_filter_frame(outlink, out);
+
+fail:
+    av_frame_free(&out);
+    return ret;
+}
+
+/**
+ * Take the new frames of a secondary input.
+ *
+ * @return 1 if the input is ready for compositing a frame at the time of
+ *         main, 0 if it has to be waited for, a negative error code on failure
+ */
+static int update_input(AVFilterContext *ctx, int idx, const AVFrame *main)
+{
+    MosaicContext *s = ctx->priv;
+    MosaicInput *in = &s->inputs[idx];
+    AVFilterLink *inlink = ctx->inputs[idx];
+    int64_t target = AV_NOPTS_VALUE, pts;
+    AVFrame *frame;
+    int status, ret;
+
+    if (main && main->pts != AV_NOPTS_VALUE)
+        target = av_rescale_q(main->pts, ctx->inputs[0]->time_base,
+                              inlink->time_base);
+
+    while (ff_inlink_queued_frames(inlink)) {
+        if (s->sync == SYNC_PTS) {
+            frame = ff_inlink_peek_frame(inlink, 0);
+            /* keep the frames following main for the next output */
+            if (!main || (target != AV_NOPTS_VALUE &&
+                          frame->pts != AV_NOPTS_VALUE && frame->pts > target))
+                return 1;
+        }
+        ret = ff_inlink_consume_frame(inlink, &frame);
+        if (ret < 0)
+            return ret;
+        if (in->frame && !in->used)
+            in->nb_dropped++;
+        av_frame_free(&in->frame);
+        in->frame = frame;
+        in->used  = 0;
+    }
+
+    if (!in->eof && ff_inlink_acknowledge_status(inlink, &status, &pts))
+        in->eof = 1;
+    if (in->eof)
+        return 1;
+
+    ff_inlink_request_frame(inlink);
+    return s->sync == SYNC_LATEST;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFilterLink *mainlink = ctx->inputs[0];
+    AVFrame *main = NULL;
+    int ready = 1, status, ret;
+    int64_t pts;
+
+    FF_FILTER_FORWARD_STATUS_BACK_ALL(outlink, ctx);
+
+    if (ff_inlink_queued_frames(mainlink))
+        main = ff_inlink_peek_frame(mainlink, 0);
+
+    for (int i = 1; i < ctx->nb_inputs; i++) {
+        ret = update_input(ctx, i, main);
+        if (ret < 0)
+            return ret;
+        ready &= ret;
+    }
+
+    if (main) {
+        if (!ready)
+            return 0;
+        ret = ff_inlink_consume_frame(mainlink, &main);
+        if (ret < 0)
+            return ret;
+        return compose(ctx, main);
+    }
+
+    if (ff_inlink_acknowledge_status(mainlink, &status, &pts)) {
+        ff_outlink_set_status(outlink, status, pts);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, mainlink);
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(MosaicContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption mosaic_options[] = {
+    { "inputs", "set the number of inputs, 0 for one per tile", OFFSET(nb_inputs), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "grid",   "set the number of columns and rows", OFFSET(nb_columns), AV_OPT_TYPE_IMAGE_SIZE, { .str = "2x2" }, 0, 0, FLAGS },
+    { "size",   "set the output size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, { .str = "hd720" }, 0, 0, FLAGS },
+    { "s",      "set the output size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, { .str = "hd720" }, 0, 0, FLAGS },
+    { "fill",   "set the color of the tiles without video", OFFSET(fillcolor), AV_OPT_TYPE_COLOR, { .str = "black" }, 0, 0, FLAGS },
+    { "sync",   "set how the inputs are synchronized with the first one", OFFSET(sync), AV_OPT_TYPE_INT, { .i64 = SYNC_LATEST }, 0, SYNC_NB - 1, FLAGS, "sync" },
+        { "latest", "use the last frame received, never wait", 0, AV_OPT_TYPE_CONST, { .i64 = SYNC_LATEST }, 0, 0, FLAGS, "sync" },
+        { "pts",    "use the last frame not later than the first input, wait for it", 0, AV_OPT_TYPE_CONST, { .i64 = SYNC_PTS }, 0, 0, FLAGS, "sync" },
+    { "flags",  "set libswscale scaling flags", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bilinear" }, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(mosaic);
+
+static const AVFilterPad mosaic_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+};
+
+const AVFilter ff_vf_mosaic = {
+    .name          = "mosaic",
+    .description   = NULL_IF_CONFIG_SMALL("Compose video streams into a grid."),
+    .priv_size     = sizeof(MosaicContext),
+    .priv_class    = &mosaic_class,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_OUTPUTS(mosaic_outputs),
+    FILTER_QUERY_FUNC(query_formats),
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
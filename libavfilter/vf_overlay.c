@@ -466,6 +466,8 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
     const uint##depth##_t max = (1 << nbits) - 1;                                                          \
     const uint##depth##_t mid = (1 << (nbits -1)) ;                                                        \
     int bytes = depth / 8;                                                                                 \
+    int alinesize = src->linesize[3] / bytes;                                                              \
+    int dalinesize = dst->linesize[3] / bytes;                                                             \
                                                                                                            \
     dst_step /= bytes;                                                                                     \
     j = FFMAX(-yp, 0);                                                                                     \
@@ -489,7 +491,7 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
         da = dap + ((xp+k) << hsub);                                                                       \
         kmax = FFMIN(-xp + dst_wp, src_wp);                                                                \
                                                                                                            \
-        if (nbits == 8 && ((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {                       \
+        if (((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {                                     \
             int c = octx->blend_row[i]((uint8_t*)d, (uint8_t*)da, (uint8_t*)s,                             \
                     (uint8_t*)a, kmax - k, src->linesize[3]);                                              \
                                                                                                            \
@@ -504,13 +506,13 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
                                                                                                            \
             /* average alpha for color components, improve quality */                                      \
             if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                            \
-                alpha = (a[0] + a[src->linesize[3]] +                                                      \
-                         a[1] + a[src->linesize[3]+1]) >> 2;                                               \
+                alpha = (a[0] + a[alinesize] +                                                             \
+                         a[1] + a[alinesize+1]) >> 2;                                                      \
             } else if (hsub || vsub) {                                                                     \
                 alpha_h = hsub && k+1 < src_wp ?                                                           \
                     (a[0] + a[1]) >> 1 : a[0];                                                             \
                 alpha_v = vsub && j+1 < src_hp ?                                                           \
-                    (a[0] + a[src->linesize[3]]) >> 1 : a[0];                                              \
+                    (a[0] + a[alinesize]) >> 1 : a[0];                                                     \
                 alpha = (alpha_v + alpha_h) >> 1;                                                          \
             } else                                                                                         \
                 alpha = a[0];                                                                              \
@@ -520,13 +522,13 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
                 /* average alpha for color components, improve quality */                                  \
                 uint8_t alpha_d;                                                                           \
                 if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                        \
-                    alpha_d = (da[0] + da[dst->linesize[3]] +                                              \
-                               da[1] + da[dst->linesize[3]+1]) >> 2;                                       \
+                    alpha_d = (da[0] + da[dalinesize] +                                                    \
+                               da[1] + da[dalinesize+1]) >> 2;                                             \
                 } else if (hsub || vsub) {                                                                 \
                     alpha_h = hsub && k+1 < src_wp ?                                                       \
                         (da[0] + da[1]) >> 1 : da[0];                                                      \
                     alpha_v = vsub && j+1 < src_hp ?                                                       \
-                        (da[0] + da[dst->linesize[3]]) >> 1 : da[0];                                       \
+                        (da[0] + da[dalinesize]) >> 1 : da[0];                                             \
                     alpha_d = (alpha_v + alpha_h) >> 1;                                                    \
                 } else                                                                                     \
                     alpha_d = da[0];                                                                       \
@@ -558,8 +560,8 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
         }                                                                                                  \
         dp += dst->linesize[dst_plane] / bytes;                                                            \
         sp += src->linesize[i] / bytes;                                                                    \
-        ap += (1 << vsub) * src->linesize[3] / bytes;                                                      \
-        dap += (1 << vsub) * dst->linesize[3] / bytes;                                                     \
+        ap += (1 << vsub) * alinesize;                                                                     \
+        dap += (1 << vsub) * dalinesize;                                                                   \
     }                                                                                                      \
 }
 DEFINE_BLEND_PLANE(8, 8)
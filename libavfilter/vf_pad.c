@@ -41,6 +41,7 @@
 #include "libavutil/opt.h"
 
 #include "drawutils.h"
+#include "fuse.h"
 
 static const char *const var_names[] = {
     "in_w",   "iw",
@@ -225,6 +226,21 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+int ff_pad_get_area(AVFilterContext *ctx, int *x, int *y,
+                    FFDrawContext *draw, FFDrawColor *color)
+{
+    PadContext *s = ctx->priv;
+
+    if (s->eval_mode != EVAL_MODE_INIT || s->inlink_w <= 0)
+        return AVERROR(EINVAL);
+
+    *x     = s->x;
+    *y     = s->y;
+    *draw  = s->draw;
+    *color = s->color;
+    return 0;
+}
+
 static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
 {
     PadContext *s = inlink->dst->priv;
@@ -27,8 +27,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "config_components.h"
+
 #include "avfilter.h"
+#include "drawutils.h"
 #include "formats.h"
+#include "fuse.h"
 #include "internal.h"
 #include "scale_eval.h"
 #include "video.h"
@@ -156,6 +160,15 @@ typedef struct ScaleContext {
 
     int eval_mode;              ///< expression evaluation mode
 
+    /* filters fused into this one, see ff_scale_fuse() */
+    int scaled_w, scaled_h;     ///< dimensions of the scaled picture
+    int fused_pad;              ///< the output is padded to pad_w x pad_h
+    int pad_w, pad_h;
+    int pad_x, pad_y;           ///< position of the scaled picture in the output
+    FFDrawContext draw;
+    FFDrawColor color;
+    int fused_sar;              ///< the output SAR is forced to sar
+    AVRational sar;
 } ScaleContext;
 
 const AVFilter ff_vf_scale2ref;
@@ -616,6 +629,22 @@ static int config_props(AVFilterLink *outlink)
     } else
         outlink->sample_aspect_ratio = inlink0->sample_aspect_ratio;
 
+    scale->scaled_w = outlink->w;
+    scale->scaled_h = outlink->h;
+    if (scale->fused_pad) {
+        if (scale->pad_x + outlink->w > scale->pad_w ||
+            scale->pad_y + outlink->h > scale->pad_h) {
+            av_log(ctx, AV_LOG_ERROR, "Scaled area %dx%d does not fit in the "
+                   "padded area %dx%d at %d:%d\n", outlink->w, outlink->h,
+                   scale->pad_w, scale->pad_h, scale->pad_x, scale->pad_y);
+            return AVERROR(EINVAL);
+        }
+        outlink->w = scale->pad_w;
+        outlink->h = scale->pad_h;
+    }
+    if (scale->fused_sar)
+        outlink->sample_aspect_ratio = scale->sar;
+
     if (scale->sws)
         av_opt_get(scale->sws, "sws_flags", 0, &flags_val);
 
@@ -706,6 +735,66 @@ static int scale_field(ScaleContext *scale, AVFrame *dst, AVFrame *src,
     return 0;
 }
 
+/* move the data pointers of a padded frame to the scaled picture and back */
+static void pad_offset(ScaleContext *scale, AVFrame *frame, int dir)
+{
+    for (int i = 0; i < 4 && frame->data[i] && frame->linesize[i]; i++) {
+        int hsub = scale->draw.hsub[i];
+        int vsub = scale->draw.vsub[i];
+
+        frame->data[i] += dir * ((scale->pad_x >> hsub) * scale->draw.pixelstep[i] +
+                                 (scale->pad_y >> vsub) * frame->linesize[i]);
+    }
+}
+
+/* fill the borders around the scaled picture like the pad filter does */
+static void pad_fill_borders(ScaleContext *scale, AVFrame *out)
+{
+    int in_w = ff_draw_round_to_sub(&scale->draw, 0, -1, scale->scaled_w);
+    int in_h = ff_draw_round_to_sub(&scale->draw, 1, -1, scale->scaled_h);
+
+    if (scale->pad_y)
+        ff_fill_rectangle(&scale->draw, &scale->color, out->data, out->linesize,
+                          0, 0, scale->pad_w, scale->pad_y);
+    if (scale->pad_h > scale->pad_y + in_h)
+        ff_fill_rectangle(&scale->draw, &scale->color, out->data, out->linesize,
+                          0, scale->pad_y + in_h,
+                          scale->pad_w, scale->pad_h - scale->pad_y - in_h);
+    ff_fill_rectangle(&scale->draw, &scale->color, out->data, out->linesize,
+                      0, scale->pad_y, scale->pad_x, scale->scaled_h);
+    ff_fill_rectangle(&scale->draw, &scale->color, out->data, out->linesize,
+                      scale->pad_x + in_w, scale->pad_y,
+                      scale->pad_w - scale->pad_x - in_w, scale->scaled_h);
+}
+
+/* frame to output when no scaling is needed */
+static int scale_passthrough(AVFilterLink *outlink, AVFrame *in, AVFrame **frame_out)
+{
+    ScaleContext *scale = outlink->src->priv;
+    AVFrame *out;
+
+    if (scale->fused_sar)
+        in->sample_aspect_ratio = scale->sar;
+    if (!scale->fused_pad) {
+        *frame_out = in;
+        return 0;
+    }
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+    av_frame_copy_props(out, in);
+    ff_copy_rectangle2(&scale->draw, out->data, out->linesize,
+                       in->data, in->linesize, scale->pad_x, scale->pad_y,
+                       0, 0, in->width, in->height);
+    pad_fill_borders(scale, out);
+    av_frame_free(&in);
+    *frame_out = out;
+    return 0;
+}
+
 static int scale_frame(AVFilterLink *link, AVFrame *in, AVFrame **frame_out)
 {
     AVFilterContext *ctx = link->dst;
@@ -802,10 +891,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
 scale:
-    if (!scale->sws) {
-        *frame_out = in;
-        return 0;
-    }
+    if (!scale->sws)
+        return scale_passthrough(outlink, in, frame_out);
 
     scale->hsub = desc->log2_chroma_w;
     scale->vsub = desc->log2_chroma_h;
@@ -879,10 +966,19 @@ scale:
         out->color_range = out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
     }
 
-    av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
-              (int64_t)in->sample_aspect_ratio.num * outlink->h * link->w,
-              (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
-              INT_MAX);
+    if (scale->fused_sar)
+        out->sample_aspect_ratio = scale->sar;
+    else
+        av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * scale->scaled_h * link->w,
+                  (int64_t)in->sample_aspect_ratio.den * scale->scaled_w * link->h,
+                  INT_MAX);
+
+    if (scale->fused_pad) {
+        pad_offset(scale, out, 1);
+        out->width  = scale->scaled_w;
+        out->height = scale->scaled_h;
+    }
 
     if (scale->interlaced>0 || (scale->interlaced<0 &&
         (in->flags & AV_FRAME_FLAG_INTERLACED))) {
@@ -893,6 +989,13 @@ scale:
         ret = sws_scale_frame(scale->sws, out, in);
     }
 
+    if (scale->fused_pad) {
+        pad_offset(scale, out, -1);
+        out->width  = outlink->w;
+        out->height = outlink->h;
+        pad_fill_borders(scale, out);
+    }
+
     av_frame_free(&in);
     if (ret < 0)
         av_frame_free(frame_out);
@@ -948,6 +1051,38 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return ff_filter_frame(outlink, in);
 }
 
+int ff_scale_fuse(AVFilterContext *ctx, AVFilterContext *next)
+{
+    ScaleContext *scale = ctx->priv;
+    AVFilterLink *outlink = next->outputs[0];
+    const char *name = next->filter->name;
+
+    if (ctx->filter == &ff_vf_scale2ref || scale->eval_mode != EVAL_MODE_INIT)
+        return 0;
+
+    if (!strcmp(name, "format") || !strcmp(name, "noformat") ||
+        !strcmp(name, "null"))
+        return 1;
+
+    if (!strcmp(name, "setsar") || !strcmp(name, "setdar")) {
+        scale->fused_sar = 1;
+        scale->sar       = outlink->sample_aspect_ratio;
+        return 1;
+    }
+
+    if (CONFIG_PAD_FILTER && !strcmp(name, "pad") && !scale->fused_pad) {
+        if (ff_pad_get_area(next, &scale->pad_x, &scale->pad_y,
+                            &scale->draw, &scale->color) < 0)
+            return 0;
+        scale->fused_pad = 1;
+        scale->pad_w     = outlink->w;
+        scale->pad_h     = outlink->h;
+        return 1;
+    }
+
+    return 0;
+}
+
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
                            char *res, int res_len, int flags)
 {
@@ -0,0 +1,564 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale video to several sizes in one pass, e.g. for adaptive streaming
+ * ladders
+ *
+ * The input is converted to the output pixel format only once, and each
+ * output is scaled from the smallest larger output which is big enough
+ * (see the cascade option) instead of from the input. The outputs that
+ * do not depend on each other are scaled in parallel.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "framepool.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct ScaleMultiOutput {
+    int w, h;
+    int src;                    ///< output this one is scaled from, -1 for the input
+    int level;                  ///< pass in which this output is scaled
+    struct SwsContext *sws;     ///< NULL if the source is passed through
+    AVFrame *frame;             ///< frame being produced
+} ScaleMultiOutput;
+
+typedef struct ScaleMultiContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    double cascade;
+    enum AVPixelFormat format;
+
+    ScaleMultiOutput *outputs;
+    int nb_outputs;
+    int nb_levels;
+    int *rets;
+
+    /* conversion of the input to the output format, shared by the outputs
+     * scaled from the input */
+    struct SwsContext *conv;
+    FFFramePool *conv_pool;
+    AVFrame *conv_frame;
+} ScaleMultiContext;
+
+typedef struct ThreadData {
+    const AVFrame *in;
+    int level;
+} ThreadData;
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ScaleMultiContext *s = ctx->priv;
+    const ScaleMultiOutput *o = &s->outputs[FF_OUTLINK_IDX(outlink)];
+
+    outlink->w = o->w;
+    outlink->h = o->h;
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+    char *sizes, *size, *saveptr = NULL;
+    int ret = 0;
+
+    if (!s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        return AVERROR(EINVAL);
+    }
+    if (s->format != AV_PIX_FMT_NONE && !sws_isSupportedOutput(s->format)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported output format %s.\n",
+               av_get_pix_fmt_name(s->format));
+        return AVERROR(EINVAL);
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (size = av_strtok(sizes, "|", &saveptr); size;
+         size = av_strtok(NULL, "|", &saveptr)) {
+        ScaleMultiOutput *o;
+        AVFilterPad pad = { 0 };
+
+        o = av_dynarray2_add((void **)&s->outputs, &s->nb_outputs,
+                             sizeof(*s->outputs), NULL);
+        if (!o) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        memset(o, 0, sizeof(*o));
+
+        ret = av_parse_video_size(&o->w, &o->h, size);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+            break;
+        }
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name = av_asprintf("output%d", s->nb_outputs - 1);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            break;
+    }
+    av_free(sizes);
+    if (ret < 0)
+        return ret;
+    if (!s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        return AVERROR(EINVAL);
+    }
+
+    /* scale each output from the smallest output at least cascade times
+     * larger in both dimensions; sources are always strictly larger, so
+     * there cannot be any cycle */
+    for (int i = 0; i < s->nb_outputs; i++) {
+        ScaleMultiOutput *o = &s->outputs[i];
+        int64_t area = (int64_t)o->w * o->h, best_area = INT64_MAX;
+
+        o->src = -1;
+        for (int j = 0; j < s->nb_outputs && s->cascade > 0; j++) {
+            const ScaleMultiOutput *c = &s->outputs[j];
+            int64_t c_area = (int64_t)c->w * c->h;
+
+            if (c_area > area && c_area < best_area &&
+                c->w >= s->cascade * o->w && c->h >= s->cascade * o->h) {
+                o->src    = j;
+                best_area = c_area;
+            }
+        }
+    }
+    for (int pass = 0; pass < s->nb_outputs; pass++)
+        for (int i = 0; i < s->nb_outputs; i++) {
+            ScaleMultiOutput *o = &s->outputs[i];
+            o->level = o->src < 0 ? 0 : s->outputs[o->src].level + 1;
+            s->nb_levels = FFMAX(s->nb_levels, o->level + 1);
+        }
+
+    s->rets = av_calloc(s->nb_outputs, sizeof(*s->rets));
+    if (!s->rets)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        sws_freeContext(s->outputs[i].sws);
+        av_frame_free(&s->outputs[i].frame);
+    }
+    av_freep(&s->outputs);
+    s->nb_outputs = 0;
+    av_freep(&s->rets);
+    sws_freeContext(s->conv);
+    s->conv = NULL;
+    av_frame_free(&s->conv_frame);
+    ff_frame_pool_uninit(&s->conv_pool);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = NULL;
+    AVFilterFormats *formats = NULL;
+    int ret;
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (sws_isSupportedInput(pix_fmt) &&
+            (s->format != AV_PIX_FMT_NONE || sws_isSupportedOutput(pix_fmt)) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    if (s->format == AV_PIX_FMT_NONE)
+        return ff_set_common_formats(ctx, formats);
+
+    if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->outcfg.formats)) < 0)
+        return ret;
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        formats = NULL;
+        if ((ret = ff_add_format(&formats, s->format)) < 0 ||
+            (ret = ff_formats_ref(formats, &ctx->outputs[i]->incfg.formats)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int alloc_sws(AVFilterContext *ctx, struct SwsContext **ps,
+                     int src_w, int src_h, enum AVPixelFormat src_format,
+                     int dst_w, int dst_h, enum AVPixelFormat dst_format,
+                     int threads)
+{
+    ScaleMultiContext *s = ctx->priv;
+    struct SwsContext *sws = sws_alloc_context();
+    int ret;
+
+    if (!sws)
+        return AVERROR(ENOMEM);
+    *ps = sws;
+
+    if (s->flags_str && *s->flags_str) {
+        ret = av_opt_set(sws, "sws_flags", s->flags_str, 0);
+        if (ret < 0)
+            return ret;
+    }
+    av_opt_set_int(sws, "threads",    threads,    0);
+    av_opt_set_int(sws, "srcw",       src_w,      0);
+    av_opt_set_int(sws, "srch",       src_h,      0);
+    av_opt_set_int(sws, "src_format", src_format, 0);
+    av_opt_set_int(sws, "dstw",       dst_w,      0);
+    av_opt_set_int(sws, "dsth",       dst_h,      0);
+    av_opt_set_int(sws, "dst_format", dst_format, 0);
+
+    /* MPEG-2 chroma positions, as in the scale filter */
+    if (src_format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "src_v_chr_pos", 128, 0);
+    if (dst_format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "dst_v_chr_pos", 128, 0);
+
+    return sws_init_context(sws, NULL, NULL);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    ScaleMultiContext *s = ctx->priv;
+    enum AVPixelFormat format = ctx->outputs[0]->format;
+    enum AVPixelFormat src_format = inlink->format;
+    int nb_threads = ff_filter_get_nb_threads(ctx);
+    int nb_direct = 0, ret;
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        sws_freeContext(s->outputs[i].sws);
+        s->outputs[i].sws = NULL;
+        nb_direct += s->outputs[i].src < 0;
+    }
+    sws_freeContext(s->conv);
+    s->conv = NULL;
+    ff_frame_pool_uninit(&s->conv_pool);
+
+    /* convert only once if several outputs are scaled from the input */
+    if (inlink->format != format && nb_direct > 1) {
+        ret = alloc_sws(ctx, &s->conv, inlink->w, inlink->h, inlink->format,
+                        inlink->w, inlink->h, format, nb_threads);
+        if (ret < 0)
+            return ret;
+        s->conv_pool = ff_graph_get_video_frame_pool(ctx->graph,
+                                                     inlink->w, inlink->h,
+                                                     format, av_cpu_max_align());
+        if (!s->conv_pool)
+            return AVERROR(ENOMEM);
+        src_format = format;
+    }
+
+    for (int level = 0; level < s->nb_levels; level++) {
+        int nb = 0, threads;
+
+        for (int i = 0; i < s->nb_outputs; i++)
+            nb += s->outputs[i].level == level;
+        /* split the threads between the outputs scaled in parallel */
+        threads = FFMAX(1, nb_threads / FFMAX(nb, 1));
+
+        for (int i = 0; i < s->nb_outputs; i++) {
+            ScaleMultiOutput *o = &s->outputs[i];
+            int src_w = o->src < 0 ? inlink->w : s->outputs[o->src].w;
+            int src_h = o->src < 0 ? inlink->h : s->outputs[o->src].h;
+            enum AVPixelFormat fmt = o->src < 0 ? src_format : format;
+
+            if (o->level != level ||
+                (src_w == o->w && src_h == o->h && fmt == format))
+                continue;
+            ret = alloc_sws(ctx, &o->sws, src_w, src_h, fmt,
+                            o->w, o->h, format, threads);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+/* use the colorspace and range of the source frame, as the scale filter
+ * does by default */
+static void set_colorspace(struct SwsContext *sws, const AVFrame *src, AVFrame *dst)
+{
+    int in_full, out_full, brightness, contrast, saturation;
+    const int *inv_table, *table;
+    enum AVColorSpace colorspace = src->colorspace;
+
+    if (av_pix_fmt_desc_get(dst->format)->flags & AV_PIX_FMT_FLAG_RGB)
+        dst->colorspace = AVCOL_SPC_RGB;
+    else if (dst->colorspace == AVCOL_SPC_RGB)
+        dst->colorspace = AVCOL_SPC_UNSPECIFIED;
+
+    sws_getColorspaceDetails(sws, (int **)&inv_table, &in_full,
+                             (int **)&table, &out_full,
+                             &brightness, &contrast, &saturation);
+
+    if (colorspace < 1 || colorspace > 10 || colorspace == 8)
+        colorspace = AVCOL_SPC_BT470BG;
+    inv_table = table = sws_getCoefficients(colorspace);
+    if (src->color_range != AVCOL_RANGE_UNSPECIFIED)
+        in_full = src->color_range == AVCOL_RANGE_JPEG;
+
+    sws_setColorspaceDetails(sws, inv_table, in_full, table, out_full,
+                             brightness, contrast, saturation);
+    dst->color_range = out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+}
+
+static int scale_outputs(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleMultiContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int n = 0, ret;
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        ScaleMultiOutput *o = &s->outputs[i];
+        const AVFrame *src;
+
+        if (o->level != td->level || !o->sws || n++ % nb_jobs != jobnr)
+            continue;
+        src = o->src >= 0 ? s->outputs[o->src].frame : td->in;
+        set_colorspace(o->sws, src, o->frame);
+        ret = sws_scale_frame(o->sws, o->frame, src);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/* rebuild the scalers for the new input parameters, as the scale filter does */
+static int reconfigure(AVFilterContext *ctx, const AVFrame *in)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    int ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "Input changed from %dx%d %s to %dx%d %s\n",
+           inlink->w, inlink->h, av_get_pix_fmt_name(inlink->format),
+           in->width, in->height, av_get_pix_fmt_name(in->format));
+
+    inlink->w      = in->width;
+    inlink->h      = in->height;
+    inlink->format = in->format;
+    inlink->sample_aspect_ratio = in->sample_aspect_ratio;
+
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        if ((ret = config_output(ctx->outputs[i])) < 0)
+            return ret;
+    return config_input(inlink);
+}
+
+static int filter_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    ScaleMultiContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData td = { .in = in };
+    int ret = 0;
+
+    if (in->width  != inlink->w || in->height != inlink->h ||
+        in->format != inlink->format ||
+        av_cmp_q(in->sample_aspect_ratio, inlink->sample_aspect_ratio)) {
+        ret = reconfigure(ctx, in);
+        if (ret < 0)
+            goto end;
+    }
+
+    if (s->conv) {
+        s->conv_frame = ff_frame_pool_get(s->conv_pool);
+        if (!s->conv_frame) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_frame_copy_props(s->conv_frame, in);
+        if (ret >= 0) {
+            set_colorspace(s->conv, in, s->conv_frame);
+            ret = sws_scale_frame(s->conv, s->conv_frame, in);
+        }
+        if (ret < 0)
+            goto end;
+        td.in = s->conv_frame;
+    }
+
+    /* the buffers are allocated here rather than in the worker threads */
+    for (int i = 0; i < s->nb_outputs; i++) {
+        ScaleMultiOutput *o = &s->outputs[i];
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        if (!o->sws) {
+            o->frame = av_frame_clone(td.in);
+            if (!o->frame) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            continue;
+        }
+        o->frame = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!o->frame) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_frame_copy_props(o->frame, td.in);
+        if (ret < 0)
+            goto end;
+        o->frame->sample_aspect_ratio = outlink->sample_aspect_ratio;
+    }
+
+    for (td.level = 0; td.level < s->nb_levels; td.level++) {
+        int nb_jobs = 0;
+
+        for (int i = 0; i < s->nb_outputs; i++)
+            nb_jobs += s->outputs[i].level == td.level && s->outputs[i].sws;
+        nb_jobs = FFMIN(nb_jobs, ff_filter_get_nb_threads(ctx));
+        if (!nb_jobs)
+            continue;
+
+        ff_filter_execute(ctx, scale_outputs, &td, s->rets, nb_jobs);
+        for (int j = 0; j < nb_jobs; j++)
+            if (s->rets[j] < 0) {
+                ret = s->rets[j];
+                goto end;
+            }
+    }
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        AVFrame *frame = s->outputs[i].frame;
+
+        s->outputs[i].frame = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&frame);
+            continue;
+        }
+        ret = ff_filter_frame(ctx->outputs[i], frame);
+        if (ret < 0)
+            break;
+    }
+
+end:
+    for (int i = 0; i < s->nb_outputs; i++)
+        av_frame_free(&s->outputs[i].frame);
+    av_frame_free(&s->conv_frame);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        FF_FILTER_FORWARD_STATUS_BACK_ALL(ctx->outputs[i], ctx);
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return filter_frame(ctx, in);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(ScaleMultiContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption scale_multi_options[] = {
+    { "sizes",   "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { "flags",   "set libswscale scaling flags", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" }, 0, 0, FLAGS },
+    { "cascade", "set the minimum ratio between the size of an output and the one it can be scaled from, 0 to scale all from the input", OFFSET(cascade), AV_OPT_TYPE_DOUBLE, { .dbl = 2 }, 0, 16, FLAGS },
+    { "format",  "set the output pixel format", OFFSET(format), AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE }, -1, INT_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scale_multi);
+
+static const AVFilterPad scale_multi_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+    },
+};
+
+const AVFilter ff_vf_scale_multi = {
+    .name          = "scale_multi",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes."),
+    .priv_size     = sizeof(ScaleMultiContext),
+    .priv_class    = &scale_multi_class,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(scale_multi_inputs),
+    .outputs       = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
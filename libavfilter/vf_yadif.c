@@ -29,10 +29,9 @@
 #include "yadif.h"
 
 typedef struct ThreadData {
-    AVFrame *frame;
-    int plane;
-    int w, h;
-    int parity;
+    AVFrame *frame[2];
+    int parity[2];
+    int nb_fields;
     int tff;
 } ThreadData;
 
@@ -189,15 +188,13 @@ static void filter_edges_16bit(void *dst1, void *prev1, void *cur1, void *next1,
     FILTER(offset, w, 0)
 }
 
-static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void filter_plane(YADIFContext *s, AVFrame *frame, int plane,
+                         int w, int h, int parity, int tff,
+                         int slice_start, int slice_end)
 {
-    YADIFContext *s = ctx->priv;
-    ThreadData *td  = arg;
-    int refs = s->cur->linesize[td->plane];
-    int df = (s->csp->comp[td->plane].depth + 7) / 8;
+    int refs = s->cur->linesize[plane];
+    int df = (s->csp->comp[plane].depth + 7) / 8;
     int pix_3 = 3 * df;
-    int slice_start = (td->h *  jobnr   ) / nb_jobs;
-    int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
     int y;
     int edge = 3 + MAX_ALIGN / df - 1;
 
@@ -205,53 +202,72 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
      * we need to call the c variant which avoids this for border pixels
      */
     for (y = slice_start; y < slice_end; y++) {
-        if ((y ^ td->parity) & 1) {
-            uint8_t *prev = &s->prev->data[td->plane][y * refs];
-            uint8_t *cur  = &s->cur ->data[td->plane][y * refs];
-            uint8_t *next = &s->next->data[td->plane][y * refs];
-            uint8_t *dst  = &td->frame->data[td->plane][y * td->frame->linesize[td->plane]];
-            int     mode  = y == 1 || y + 2 == td->h ? 2 : s->mode;
+        if ((y ^ parity) & 1) {
+            uint8_t *prev = &s->prev->data[plane][y * refs];
+            uint8_t *cur  = &s->cur ->data[plane][y * refs];
+            uint8_t *next = &s->next->data[plane][y * refs];
+            uint8_t *dst  = &frame->data[plane][y * frame->linesize[plane]];
+            int     mode  = y == 1 || y + 2 == h ? 2 : s->mode;
             s->filter_line(dst + pix_3, prev + pix_3, cur + pix_3,
-                           next + pix_3, td->w - edge,
-                           y + 1 < td->h ? refs : -refs,
+                           next + pix_3, w - edge,
+                           y + 1 < h ? refs : -refs,
                            y ? -refs : refs,
-                           td->parity ^ td->tff, mode);
-            s->filter_edges(dst, prev, cur, next, td->w,
-                            y + 1 < td->h ? refs : -refs,
+                           parity ^ tff, mode);
+            s->filter_edges(dst, prev, cur, next, w,
+                            y + 1 < h ? refs : -refs,
                             y ? -refs : refs,
-                            td->parity ^ td->tff, mode);
+                            parity ^ tff, mode);
         } else {
-            memcpy(&td->frame->data[td->plane][y * td->frame->linesize[td->plane]],
-                   &s->cur->data[td->plane][y * refs], td->w * df);
+            memcpy(&frame->data[plane][y * frame->linesize[plane]],
+                   &s->cur->data[plane][y * refs], w * df);
         }
     }
-    return 0;
 }
 
-static void filter(AVFilterContext *ctx, AVFrame *dstpic,
-                   int parity, int tff)
+/* each job filters the same band of all the planes of all the fields */
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    YADIFContext *yadif = ctx->priv;
-    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
-    int i;
+    YADIFContext *s = ctx->priv;
+    ThreadData *td  = arg;
+    int f, i;
+
+    for (f = 0; f < td->nb_fields; f++) {
+        AVFrame *frame = td->frame[f];
 
-    for (i = 0; i < yadif->csp->nb_components; i++) {
-        int w = dstpic->width;
-        int h = dstpic->height;
+        for (i = 0; i < s->csp->nb_components; i++) {
+            int w = frame->width;
+            int h = frame->height;
 
-        if (i == 1 || i == 2) {
-            w = AV_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w);
-            h = AV_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h);
+            if (i == 1 || i == 2) {
+                w = AV_CEIL_RSHIFT(w, s->csp->log2_chroma_w);
+                h = AV_CEIL_RSHIFT(h, s->csp->log2_chroma_h);
+            }
+
+            filter_plane(s, frame, i, w, h, td->parity[f], td->tff,
+                         (h *  jobnr   ) / nb_jobs, (h * (jobnr+1)) / nb_jobs);
         }
+    }
+    return 0;
+}
 
+static void filter(AVFilterContext *ctx, AVFrame *dstpic,
+                   int parity, int tff)
+{
+    ThreadData td = { .frame = { dstpic }, .parity = { parity },
+                      .nb_fields = 1, .tff = tff };
 
-        td.w       = w;
-        td.h       = h;
-        td.plane   = i;
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dstpic->height, ff_filter_get_nb_threads(ctx)));
+}
 
-        ff_filter_execute(ctx, filter_slice, &td, NULL,
-                          FFMIN(h, ff_filter_get_nb_threads(ctx)));
-    }
+static void filter_fields(AVFilterContext *ctx, AVFrame *dst1, AVFrame *dst2,
+                          int tff)
+{
+    ThreadData td = { .frame = { dst1, dst2 }, .parity = { tff ^ 1, tff },
+                      .nb_fields = 2, .tff = tff };
+
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dst1->height, ff_filter_get_nb_threads(ctx)));
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -261,6 +277,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&yadif->prev);
     av_frame_free(&yadif->cur );
     av_frame_free(&yadif->next);
+    av_frame_free(&yadif->out_next);
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -301,6 +318,7 @@ static int config_output(AVFilterLink *outlink)
 
     s->csp = av_pix_fmt_desc_get(outlink->format);
     s->filter = filter;
+    s->filter_fields = filter_fields;
     if (s->csp->comp[0].depth > 8) {
         s->filter_line  = filter_line_c_16bit;
         s->filter_edges = filter_edges_16bit;
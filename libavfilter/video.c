@@ -38,6 +38,14 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
+static FFFramePool *get_frame_pool(AVFilterLink *link, int w, int h, int align)
+{
+    if (link->graph)
+        return ff_graph_get_video_frame_pool(link->graph, w, h,
+                                             link->format, align);
+    return ff_frame_pool_video_init(av_buffer_allocz, w, h, link->format, align);
+}
+
 AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int align)
 {
     AVFrame *frame = NULL;
@@ -62,8 +70,7 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
     }
 
     if (!link->frame_pool) {
-        link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                    link->format, align);
+        link->frame_pool = get_frame_pool(link, w, h, align);
         if (!link->frame_pool)
             return NULL;
     } else {
@@ -77,8 +84,7 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
             pool_format != link->format || pool_align != align) {
 
             ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
-            link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                        link->format, align);
+            link->frame_pool = get_frame_pool(link, w, h, align);
             if (!link->frame_pool)
                 return NULL;
         }
@@ -112,3 +118,20 @@ AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
 
     return ret;
 }
+
+AVFrame *ff_get_video_buffer_inplace(AVFilterLink *link, AVFrame *in)
+{
+    AVFrame *out;
+
+    if (av_frame_is_writable(in))
+        return in;
+
+    out = ff_get_video_buffer(link, link->w, link->h);
+    if (!out)
+        return NULL;
+    if (av_frame_copy_props(out, in) < 0) {
+        av_frame_free(&out);
+        return NULL;
+    }
+    return out;
+}
@@ -38,4 +38,18 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h);
  */
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h);
 
+/**
+ * Get the frame a filter computing each output pixel from the input pixel
+ * at the same position writes its output to: the input frame itself if it
+ * is writable, otherwise a new buffer with the properties of the input
+ * frame. Making the input writable instead would copy it before processing
+ * it, i.e. read and write it twice.
+ *
+ * @param link  the output link of the filter, of the size and format of
+ *              the input
+ * @param in    the input frame
+ * @return      in, a new AVFrame owned by the caller, or NULL on error
+ */
+AVFrame *ff_get_video_buffer_inplace(AVFilterLink *link, AVFrame *in);
+
 #endif /* AVFILTER_VIDEO_H */
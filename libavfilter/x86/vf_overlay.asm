@@ -23,17 +23,98 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
-pb_1:     times 16 db 1
-pw_128:   times  8 dw 128
-pw_255:   times  8 dw 255
-pw_257:   times  8 dw 257
+pb_1:     times 32 db 1
+pw_1:     times 16 dw 1
+pw_16:    times 16 dw 16
+pw_128:   times 16 dw 128
+pw_m128:  times 16 dw -128
+pw_255:   times 16 dw 255
+pw_257:   times 16 dw 257
+pd_1:     times  8 dd 1
+pd_64:    times  8 dd 64
+pd_1023:  times  8 dd 1023
+pd_1024:  times  8 dd 1024
+pd_65535: times  8 dd 65535
 
 SECTION .text
 
-INIT_XMM sse4
-cglobal overlay_row_44, 5, 7, 6, 0, d, da, s, a, w, r, x
+; 8-bit blending, on words
+; m0 = overlay, m1 = main, m2 = alpha, result in m0
+; m3 = pw_255, m4 = pw_128, m5 = pw_257, m7 = per-mode constant
+
+; (d * (255 - a) + s * a) / 255
+%macro BLEND 0
+    pmullw      m0, m2
+    pxor        m2, m3
+    pmullw      m1, m2
+    paddw       m0, m4
+    paddw       m0, m1
+    pmulhuw     m0, m5
+%endmacro
+
+; premultiplied overlay: clip_uint8(d * (255 - a) / 255 + s - 16)
+%macro BLEND_PM 0
+    pxor        m2, m3
+    pmullw      m1, m2
+    paddw       m1, m4
+    pmulhuw     m1, m5
+    paddw       m0, m1
+    psubw       m0, m7
+%endmacro
+
+; premultiplied overlay, chroma:
+; clip((d - 128) * (255 - a) / 255 + s - 128, -128, 128) + 128, stored as uint8
+%macro BLEND_PMC 0
+    pxor        m2, m3
+    psubw       m1, m4
+    pmullw      m1, m2
+    paddw       m1, m4
+    pmulhw      m1, m5
+    paddw       m0, m1
+    psubw       m0, m4
+    pmaxsw      m0, m7
+    pminsw      m0, m4
+    paddw       m0, m4
+    pand        m0, m3
+%endmacro
+
+%macro LOAD_CONSTANTS 1 ; blend macro
+    mova         m3, [pw_255]
+    mova         m4, [pw_128]
+    mova         m5, [pw_257]
+%ifidn %1, BLEND_PM
+    mova         m7, [pw_16]
+%elifidn %1, BLEND_PMC
+    mova         m7, [pw_m128]
+%endif
+%endmacro
+
+; pack the words of m%2 to bytes and store them to %1
+%macro STORE_BYTES 2
+    packuswb   m%2, m%2
+%if mmsize == 32
+    vpermq     m%2, m%2, q3120
+    movu        %1, xm%2
+%else
+    movq        %1, m%2
+%endif
+%endmacro
+
+; pack the dwords of m%2 to words and store them to %1
+%macro STORE_WORDS 2
+    packusdw   m%2, m%2
+%if mmsize == 32
+    vpermq     m%2, m%2, q3120
+    movu        %1, xm%2
+%else
+    movq        %1, m%2
+%endif
+%endmacro
+
+%macro OVERLAY_ROW_44 2 ; suffix, blend macro
+cglobal overlay_row_44%1, 5, 7, 8, 0, d, da, s, a, w, r, x
     xor          xq, xq
     movsxdifnidn wq, wd
     mov          rq, wq
@@ -41,21 +122,13 @@ cglobal overlay_row_44, 5, 7, 6, 0, d, da, s, a, w, r, x
     cmp          wq, mmsize/2
     jl .end
     sub          wq, rq
-    mova         m3, [pw_255]
-    mova         m4, [pw_128]
-    mova         m5, [pw_257]
+    LOAD_CONSTANTS %2
     .loop:
         pmovzxbw    m0, [sq+xq]
         pmovzxbw    m2, [aq+xq]
         pmovzxbw    m1, [dq+xq]
-        pmullw      m0, m2
-        pxor        m2, m3
-        pmullw      m1, m2
-        paddw       m0, m4
-        paddw       m0, m1
-        pmulhuw     m0, m5
-        packuswb    m0, m0
-        movq   [dq+xq], m0
+        %2
+        STORE_BYTES [dq+xq], 0
         add         xq, mmsize/2
         cmp         xq, wq
         jl .loop
@@ -63,9 +136,10 @@ cglobal overlay_row_44, 5, 7, 6, 0, d, da, s, a, w, r, x
     .end:
     mov    eax, xd
     RET
+%endmacro
 
-INIT_XMM sse4
-cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
+%macro OVERLAY_ROW_22 2 ; suffix, blend macro
+cglobal overlay_row_22%1, 5, 7, 8, 0, d, da, s, a, w, r, x
     xor          xq, xq
     movsxdifnidn wq, wd
     sub          wq, 1
@@ -74,9 +148,7 @@ cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
     cmp          wq, mmsize/2
     jl .end
     sub          wq, rq
-    mova         m3, [pw_255]
-    mova         m4, [pw_128]
-    mova         m5, [pw_257]
+    LOAD_CONSTANTS %2
     .loop:
         pmovzxbw    m0, [sq+xq]
         movu        m1, [aq+2*xq]
@@ -86,14 +158,8 @@ cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
         pavgw       m2, m1
         psrlw       m2, 8
         pmovzxbw    m1, [dq+xq]
-        pmullw      m0, m2
-        pxor        m2, m3
-        pmullw      m1, m2
-        paddw       m0, m4
-        paddw       m0, m1
-        pmulhuw     m0, m5
-        packuswb    m0, m0
-        movq   [dq+xq], m0
+        %2
+        STORE_BYTES [dq+xq], 0
         add         xq, mmsize/2
         cmp         xq, wq
         jl .loop
@@ -101,9 +167,10 @@ cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
     .end:
     mov    eax, xd
     RET
+%endmacro
 
-INIT_XMM sse4
-cglobal overlay_row_20, 6, 7, 7, 0, d, da, s, a, w, r, x
+%macro OVERLAY_ROW_20 2 ; suffix, blend macro
+cglobal overlay_row_20%1, 6, 7, 8, 0, d, da, s, a, w, r, x
     mov         daq, aq
     add         daq, rmp
     xor          xq, xq
@@ -114,9 +181,7 @@ cglobal overlay_row_20, 6, 7, 7, 0, d, da, s, a, w, r, x
     cmp          wq, mmsize/2
     jl .end
     sub          wq, rq
-    mova         m3, [pw_255]
-    mova         m4, [pw_128]
-    mova         m5, [pw_257]
+    LOAD_CONSTANTS %2
     mova         m6, [pb_1]
     .loop:
         pmovzxbw    m0, [sq+xq]
@@ -127,14 +192,8 @@ cglobal overlay_row_20, 6, 7, 7, 0, d, da, s, a, w, r, x
         paddw       m2, m1
         psrlw       m2, 2
         pmovzxbw    m1, [dq+xq]
-        pmullw      m0, m2
-        pxor        m2, m3
-        pmullw      m1, m2
-        paddw       m0, m4
-        paddw       m0, m1
-        pmulhuw     m0, m5
-        packuswb    m0, m0
-        movq   [dq+xq], m0
+        %2
+        STORE_BYTES [dq+xq], 0
         add         xq, mmsize/2
         cmp         xq, wq
         jl .loop
@@ -142,3 +201,164 @@ cglobal overlay_row_20, 6, 7, 7, 0, d, da, s, a, w, r, x
     .end:
     mov    eax, xd
     RET
+%endmacro
+
+; 10-bit blending, on dwords: (d * (1023 - a) + s * a) / 1023
+; m0 = overlay, m1 = main, m2 = alpha, result in m0
+; m3 = pd_1023, m4 = pd_1
+; the division is exact for the whole range of the numerator
+%macro BLEND_10 0
+    pmulld      m0, m2
+    pxor        m2, m3
+    pmulld      m1, m2
+    paddd       m0, m1
+    psrld       m1, m0, 10
+    paddd       m0, m1
+    paddd       m0, m4
+    psrld       m0, 10
+%endmacro
+
+; premultiplied overlay, 10-bit:
+; clip_uintp2((d * (1023 - a) + s * a) / 1023 + s - 64, 10)
+; m7 = overlay; negative results are clipped when packing
+%macro BLEND_10_PM 0
+    BLEND_10
+    paddd       m0, m7
+    psubd       m0, [pd_64]
+    pminsd      m0, m3
+%endmacro
+
+; premultiplied overlay, 10-bit chroma:
+; clip((d * (1023 - a) + s * a) / 1023 + s - 512, -512, 512) + 512
+%macro BLEND_10_PMC 0
+    BLEND_10
+    paddd       m0, m7
+    pminsd      m0, [pd_1024]
+%endmacro
+
+; load the overlay to m0, and keep a copy in m7 for the premultiplied blends
+%macro LOAD_OVERLAY_10 2 ; address, blend macro
+    pmovzxwd    m0, %1
+%ifnidn %2, BLEND_10
+    mova        m7, m0
+%endif
+%endmacro
+
+%macro OVERLAY_ROW_44_10 2 ; suffix, blend macro
+cglobal overlay_row_44_10%1, 5, 7, 8, 0, d, da, s, a, w, r, x
+    xor          xq, xq
+    movsxdifnidn wq, wd
+    mov          rq, wq
+    and          rq, mmsize/4 - 1
+    cmp          wq, mmsize/4
+    jl .end
+    sub          wq, rq
+    mova         m3, [pd_1023]
+    mova         m4, [pd_1]
+    .loop:
+        LOAD_OVERLAY_10 [sq+2*xq], %2
+        pmovzxwd    m2, [aq+2*xq]
+        pmovzxwd    m1, [dq+2*xq]
+        %2
+        STORE_WORDS [dq+2*xq], 0
+        add         xq, mmsize/4
+        cmp         xq, wq
+        jl .loop
+
+    .end:
+    mov    eax, xd
+    RET
+%endmacro
+
+%macro OVERLAY_ROW_22_10 2 ; suffix, blend macro
+cglobal overlay_row_22_10%1, 5, 7, 8, 0, d, da, s, a, w, r, x
+    xor          xq, xq
+    movsxdifnidn wq, wd
+    sub          wq, 1
+    mov          rq, wq
+    and          rq, mmsize/4 - 1
+    cmp          wq, mmsize/4
+    jl .end
+    sub          wq, rq
+    mova         m3, [pd_1023]
+    mova         m4, [pd_1]
+    mova         m5, [pw_1]
+    mova         m6, [pd_65535]
+    .loop:
+        movu        m2, [aq+4*xq]
+        pmaddwd     m1, m2, m5
+        pand        m2, m6
+        psrld       m1, 1
+        paddd       m2, m1
+        psrld       m2, 1
+        LOAD_OVERLAY_10 [sq+2*xq], %2
+        pmovzxwd    m1, [dq+2*xq]
+        %2
+        STORE_WORDS [dq+2*xq], 0
+        add         xq, mmsize/4
+        cmp         xq, wq
+        jl .loop
+
+    .end:
+    mov    eax, xd
+    RET
+%endmacro
+
+%macro OVERLAY_ROW_20_10 2 ; suffix, blend macro
+cglobal overlay_row_20_10%1, 6, 7, 8, 0, d, da, s, a, w, r, x
+    mov         daq, aq
+    add         daq, rmp
+    xor          xq, xq
+    movsxdifnidn wq, wd
+    sub          wq, 1
+    mov          rq, wq
+    and          rq, mmsize/4 - 1
+    cmp          wq, mmsize/4
+    jl .end
+    sub          wq, rq
+    mova         m3, [pd_1023]
+    mova         m4, [pd_1]
+    mova         m5, [pw_1]
+    .loop:
+        movu        m2, [aq+4*xq]
+        movu        m1, [daq+4*xq]
+        pmaddwd     m2, m5
+        pmaddwd     m1, m5
+        paddd       m2, m1
+        psrld       m2, 2
+        LOAD_OVERLAY_10 [sq+2*xq], %2
+        pmovzxwd    m1, [dq+2*xq]
+        %2
+        STORE_WORDS [dq+2*xq], 0
+        add         xq, mmsize/4
+        cmp         xq, wq
+        jl .loop
+
+    .end:
+    mov    eax, xd
+    RET
+%endmacro
+
+%macro OVERLAY_ROWS 0
+OVERLAY_ROW_44 ,     BLEND
+OVERLAY_ROW_22 ,     BLEND
+OVERLAY_ROW_20 ,     BLEND
+OVERLAY_ROW_44 _pm,  BLEND_PM
+OVERLAY_ROW_44 _pmc, BLEND_PMC
+OVERLAY_ROW_22 _pmc, BLEND_PMC
+OVERLAY_ROW_20 _pmc, BLEND_PMC
+OVERLAY_ROW_44_10 ,     BLEND_10
+OVERLAY_ROW_22_10 ,     BLEND_10
+OVERLAY_ROW_20_10 ,     BLEND_10
+OVERLAY_ROW_44_10 _pm,  BLEND_10_PM
+OVERLAY_ROW_22_10 _pmc, BLEND_10_PMC
+OVERLAY_ROW_20_10 _pmc, BLEND_10_PMC
+%endmacro
+
+INIT_XMM sse4
+OVERLAY_ROWS
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+OVERLAY_ROWS
+%endif
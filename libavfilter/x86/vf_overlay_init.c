@@ -23,43 +23,83 @@
 #include "libavutil/x86/cpu.h"
 #include "libavfilter/vf_overlay.h"
 
-int ff_overlay_row_44_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
+#define DECLARE_OVERLAY_ROW(name, opt)                                         \
+int ff_overlay_row_##name##_##opt(uint8_t *d, uint8_t *da, uint8_t *s,        \
+                                  uint8_t *a, int w, ptrdiff_t alinesize);
 
-int ff_overlay_row_20_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
+#define DECLARE_OVERLAY_ROWS(opt)                                              \
+DECLARE_OVERLAY_ROW(44,        opt)                                            \
+DECLARE_OVERLAY_ROW(22,        opt)                                            \
+DECLARE_OVERLAY_ROW(20,        opt)                                            \
+DECLARE_OVERLAY_ROW(44_pm,     opt)                                            \
+DECLARE_OVERLAY_ROW(44_pmc,    opt)                                            \
+DECLARE_OVERLAY_ROW(22_pmc,    opt)                                            \
+DECLARE_OVERLAY_ROW(20_pmc,    opt)                                            \
+DECLARE_OVERLAY_ROW(44_10,     opt)                                            \
+DECLARE_OVERLAY_ROW(22_10,     opt)                                            \
+DECLARE_OVERLAY_ROW(20_10,     opt)                                            \
+DECLARE_OVERLAY_ROW(44_10_pm,  opt)                                            \
+DECLARE_OVERLAY_ROW(22_10_pmc, opt)                                            \
+DECLARE_OVERLAY_ROW(20_10_pmc, opt)
 
-int ff_overlay_row_22_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
+DECLARE_OVERLAY_ROWS(sse4)
+DECLARE_OVERLAY_ROWS(avx2)
+
+#define SET_ROWS(luma, chroma, opt)                                            \
+    do {                                                                       \
+        s->blend_row[0] = ff_overlay_row_##luma##_##opt;                       \
+        s->blend_row[1] = ff_overlay_row_##chroma##_##opt;                     \
+        s->blend_row[2] = ff_overlay_row_##chroma##_##opt;                     \
+    } while (0)
+
+/* The row functions only handle planar main formats without alpha: the
+ * blending with an alpha main needs a division per pixel and stays in C.
+ * Packed RGB mains are blended in C too; the ones without alpha (rgb24,
+ * bgr24) have 3-byte pixels while the overlay has 4-byte ones, with
+ * component orders depending on both formats. */
+#define INIT_ROWS(opt)                                                         \
+    do {                                                                       \
+        if (alpha_format) {                                                    \
+            if (format == OVERLAY_FORMAT_YUV444)                               \
+                SET_ROWS(44_pm, 44_pmc, opt);                                  \
+            else if (format == OVERLAY_FORMAT_GBRP)                            \
+                SET_ROWS(44_pm, 44_pm, opt);                                   \
+            else if (format == OVERLAY_FORMAT_YUV420 &&                        \
+                     pix_format == AV_PIX_FMT_YUV420P)                         \
+                SET_ROWS(44_pm, 20_pmc, opt);                                  \
+            else if (format == OVERLAY_FORMAT_YUV422)                          \
+                SET_ROWS(44_pm, 22_pmc, opt);                                  \
+            else if (format == OVERLAY_FORMAT_YUV420P10)                       \
+                SET_ROWS(44_10_pm, 20_10_pmc, opt);                            \
+            else if (format == OVERLAY_FORMAT_YUV422P10)                       \
+                SET_ROWS(44_10_pm, 22_10_pmc, opt);                            \
+        } else {                                                               \
+            if (format == OVERLAY_FORMAT_YUV444 ||                             \
+                format == OVERLAY_FORMAT_GBRP)                                 \
+                SET_ROWS(44, 44, opt);                                         \
+            else if (format == OVERLAY_FORMAT_YUV420 &&                        \
+                     pix_format == AV_PIX_FMT_YUV420P)                         \
+                SET_ROWS(44, 20, opt);                                         \
+            else if (format == OVERLAY_FORMAT_YUV422)                          \
+                SET_ROWS(44, 22, opt);                                         \
+            else if (format == OVERLAY_FORMAT_YUV420P10)                       \
+                SET_ROWS(44_10, 20_10, opt);                                   \
+            else if (format == OVERLAY_FORMAT_YUV422P10)                       \
+                SET_ROWS(44_10, 22_10, opt);                                   \
+        }                                                                      \
+    } while (0)
 
 av_cold void ff_overlay_init_x86(OverlayContext *s, int format, int pix_format,
                                  int alpha_format, int main_has_alpha)
 {
     int cpu_flags = av_get_cpu_flags();
 
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (format == OVERLAY_FORMAT_YUV444 ||
-         format == OVERLAY_FORMAT_GBRP) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_44_sse4;
-        s->blend_row[2] = ff_overlay_row_44_sse4;
-    }
+    if (main_has_alpha)
+        return;
 
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (pix_format == AV_PIX_FMT_YUV420P) &&
-        (format == OVERLAY_FORMAT_YUV420) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_20_sse4;
-        s->blend_row[2] = ff_overlay_row_20_sse4;
-    }
+    if (EXTERNAL_SSE4(cpu_flags))
+        INIT_ROWS(sse4);
 
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (format == OVERLAY_FORMAT_YUV422) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_22_sse4;
-        s->blend_row[2] = ff_overlay_row_22_sse4;
-    }
+    if (EXTERNAL_AVX2_FAST(cpu_flags))
+        INIT_ROWS(avx2);
 }
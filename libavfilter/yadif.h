@@ -60,9 +60,17 @@ typedef struct YADIFContext {
     AVFrame *next;
     AVFrame *prev;
     AVFrame *out;
+    AVFrame *out_next;  ///< second field, filtered along with the first one
 
     void (*filter)(AVFilterContext *ctx, AVFrame *dstpic, int parity, int tff);
 
+    /**
+     * Optional: filter both fields of the current frame at once in send_field
+     * mode, the first one into dst1 and the second one into dst2.
+     */
+    void (*filter_fields)(AVFilterContext *ctx, AVFrame *dst1, AVFrame *dst2,
+                          int tff);
+
     /**
      * Required alignment for filter_line
      */
@@ -24,10 +24,28 @@
 #include "internal.h"
 #include "yadif.h"
 
-static int return_frame(AVFilterContext *ctx, int is_second)
+static AVFrame *get_second_field(AVFilterContext *ctx)
 {
     YADIFContext *yadif = ctx->priv;
     AVFilterLink *link  = ctx->outputs[0];
+    AVFrame *out = ff_get_video_buffer(link, link->w, link->h);
+
+    if (!out)
+        return NULL;
+
+    av_frame_copy_props(out, yadif->cur);
+#if FF_API_INTERLACED_FRAME
+FF_DISABLE_DEPRECATION_WARNINGS
+    out->interlaced_frame = 0;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    out->flags &= ~AV_FRAME_FLAG_INTERLACED;
+    return out;
+}
+
+static int return_frame(AVFilterContext *ctx, int is_second)
+{
+    YADIFContext *yadif = ctx->priv;
     int tff, ret;
 
     if (yadif->parity == -1) {
@@ -37,23 +55,29 @@ static int return_frame(AVFilterContext *ctx, int is_second)
         tff = yadif->parity ^ 1;
     }
 
-    if (is_second) {
-        yadif->out = ff_get_video_buffer(link, link->w, link->h);
+    if (is_second && yadif->out_next) {
+        /* already filtered along with the first field */
+        yadif->out      = yadif->out_next;
+        yadif->out_next = NULL;
+    } else if (is_second) {
+        yadif->out = get_second_field(ctx);
         if (!yadif->out)
             return AVERROR(ENOMEM);
 
-        av_frame_copy_props(yadif->out, yadif->cur);
-#if FF_API_INTERLACED_FRAME
-FF_DISABLE_DEPRECATION_WARNINGS
-        yadif->out->interlaced_frame = 0;
-FF_ENABLE_DEPRECATION_WARNINGS
-#endif
-        yadif->out->flags &= ~AV_FRAME_FLAG_INTERLACED;
         if (yadif->current_field == YADIF_FIELD_BACK_END)
             yadif->current_field = YADIF_FIELD_END;
-    }
+        yadif->filter(ctx, yadif->out, tff, tff);
+    } else if ((yadif->mode & 1) && yadif->filter_fields) {
+        yadif->out_next = get_second_field(ctx);
+        if (!yadif->out_next) {
+            av_frame_free(&yadif->out);
+            return AVERROR(ENOMEM);
+        }
 
-    yadif->filter(ctx, yadif->out, tff ^ !is_second, tff);
+        yadif->filter_fields(ctx, yadif->out, yadif->out_next, tff);
+    } else {
+        yadif->filter(ctx, yadif->out, tff ^ 1, tff);
+    }
 
     if (is_second) {
         int64_t cur_pts  = yadif->cur->pts;
@@ -328,6 +328,7 @@
 #endif
 
 struct AVFormatContext;
+struct AVCodecContext;
 
 struct AVDeviceInfoList;
 
@@ -1243,6 +1244,12 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+/**
+ * In avformat_find_stream_info(), take stream parameters from container headers,
+ * parsers, codec tags and raw layouts, and only open and run decoders for the
+ * streams where this does not yield all required parameters.
+ */
+#define AVFMT_FLAG_HEADER_PROBE 0x400000
 
     /**
      * Maximum number of bytes read from input in order to determine stream
@@ -1713,6 +1720,28 @@ typedef struct AVFormatContext {
      * @return 0 on success, a negative AVERROR code on failure
      */
     int (*io_close2)(struct AVFormatContext *s, AVIOContext *pb);
+
+    /**
+     * Maximum size in bytes of the packets read ahead by a demuxing thread.
+     * If set, av_read_frame() returns packets read by a separate thread,
+     * which stops reading while the packets waiting to be returned total
+     * this size. 0 to read the packets in av_read_frame() itself.
+     *
+     * Changes of the stream parameters, start times, metadata and event
+     * flags found while reading ahead are applied when the packet they came
+     * with is returned. The thread is only used with demuxers that leave the
+     * public state alone while reading packets, currently raw PCM, raw
+     * video, WAV and W64, and only once the codec of every stream is
+     * known. Other demuxers read in av_read_frame() as usual, as do all of
+     * them after the end of the input until the next seek. While the thread
+     * runs, the caller must not access pb or the index entries of the
+     * streams. The limit does not apply to the packets buffered internally
+     * for probing and parsing.
+     *
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int64_t prefetch_size;
 } AVFormatContext;
 
 /**
@@ -2586,6 +2615,63 @@ const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx);
 const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
                                                             int64_t wanted_timestamp,
                                                             int flags);
+
+/**
+ * Group target timestamps by the keyframe decoding has to start from.
+ *
+ * For each timestamp in ts, find the last keyframe of the stream index at or
+ * before it. Consecutive targets sharing a keyframe lie in the same group of
+ * pictures and can all be reached with a single seek, decoding forward once.
+ *
+ * @param st     stream the timestamps belong to
+ * @param ts     target timestamps in the time base of st, in ascending order
+ * @param nb_ts  number of timestamps in ts
+ * @param key_ts where to store, for each target, the timestamp of its
+ *               keyframe, or AV_NOPTS_VALUE if the index has none before it;
+ *               must have room for nb_ts timestamps
+ * @return the number of groups, counting each target without a keyframe as
+ *         its own group, AVERROR(EINVAL) if ts is not sorted
+ *
+ * @note The index may be incomplete until the file has been read, for
+ *       demuxers building it while reading.
+ */
+int avformat_index_group_timestamps(AVStream *st, const int64_t *ts, int nb_ts,
+                                    int64_t *key_ts);
+
+/**
+ * Decode the first frame at or after each of the given timestamps.
+ *
+ * The timestamps are grouped with avformat_index_group_timestamps(), and each
+ * group of pictures is seeked to and decoded only once. When the first frame
+ * decoded after a seek is already past the target, for example because the
+ * index holds decoding timestamps or the demuxer seeks to any packet, the
+ * seek is retried at exponentially earlier positions, and from the start of
+ * the stream as a last resort.
+ *
+ * @param s            media file handle
+ * @param stream_index index of the stream to decode
+ * @param dec_ctx      opened decoder context for the stream, flushed before
+ *                     every seek
+ * @param ts           target timestamps in the time base of the stream, in
+ *                     ascending order
+ * @param nb_ts        number of timestamps in ts
+ * @param packet_cb    if not NULL, called with every packet of the stream
+ *                     before it is sent to the decoder; the callback may set
+ *                     the packet's opaque fields but must not unreference it
+ * @param frame_cb     called with each frame found; a frame is returned once
+ *                     when it is the first one at or after several targets
+ * @param opaque       opaque pointer passed to the callbacks
+ * @return the number of targets a frame was found for, which is smaller than
+ *         nb_ts when the stream ends before the remaining targets, or a
+ *         negative AVERROR code, including those returned by the callbacks
+ */
+int avformat_read_frames_at(AVFormatContext *s, int stream_index,
+                            struct AVCodecContext *dec_ctx,
+                            const int64_t *ts, int nb_ts,
+                            int (*packet_cb)(void *opaque, AVPacket *pkt),
+                            int (*frame_cb)(void *opaque, AVFrame *frame),
+                            void *opaque);
+
 /**
  * Add an index entry into a sorted list. Update the entry if the list
  * already contains it.
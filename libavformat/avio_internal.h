@@ -163,6 +163,19 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size);
 
 int ffio_limit(AVIOContext *s, int size);
 
+/**
+ * Reference the next size bytes of a memory mapped resource and skip
+ * over them, without copying them.
+ *
+ * @param buf     set to a new reference whose data and size describe
+ *                the requested bytes
+ * @param padding number of mapped bytes that must follow the requested
+ *                ones
+ * @return size on success, AVERROR(ENOSYS) if the data is not available
+ *         from a mapping, in which case nothing has been consumed
+ */
+int ffio_read_mapped(AVIOContext *s, AVBufferRef **buf, int size, int padding);
+
 void ffio_init_checksum(AVIOContext *s,
                         unsigned long (*update_checksum)(unsigned long c, const uint8_t *p, unsigned int len),
                         unsigned long checksum);
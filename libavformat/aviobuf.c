@@ -229,7 +229,21 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         return;
     }
     do {
-        int len = FFMIN(s->buf_end - s->buf_ptr, size);
+        int len;
+
+        /* Pass large writes, such as raw video frames, straight to the
+         * protocol once the buffer is empty instead of copying them through
+         * it. Packetized outputs need every write to fill the buffer, and
+         * user callbacks are never given more than buffer_size bytes. */
+        if (s->buf_ptr == s->buffer && s->buf_ptr_max == s->buffer &&
+            size >= s->buffer_size && s->write_flag &&
+            !s->update_checksum && !s->max_packet_size &&
+            !s->write_data_type && ffio_geturlcontext(s)) {
+            writeout(s, buf, size);
+            return;
+        }
+
+        len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
         s->buf_ptr += len;
 
@@ -341,6 +355,46 @@ int64_t avio_skip(AVIOContext *s, int64_t offset)
     return avio_seek(s, offset, SEEK_CUR);
 }
 
+int ffio_read_mapped(AVIOContext *s, AVBufferRef **buf, int size, int padding)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    URLContext *h = ffio_geturlcontext(s);
+    int64_t pos = avio_tell(s);
+    AVBufferRef *map;
+    int ret;
+
+    if (!h || s->write_flag || s->update_checksum || size <= 0 || pos < 0)
+        return AVERROR(ENOSYS);
+    if ((ret = ffurl_get_mapping(h, &map)) < 0)
+        return ret;
+    if (pos + size + padding > map->size) {
+        av_buffer_unref(&map);
+        return AVERROR(ENOSYS);
+    }
+
+    if (size <= s->buf_end - s->buf_ptr) {
+        s->buf_ptr += size;
+    } else {
+        /* Reposition the protocol rather than reading through the
+         * buffer as avio_skip() would for short distances. */
+        int64_t res = s->seek(s->opaque, pos + size, SEEK_SET);
+        if (res < 0) {
+            av_buffer_unref(&map);
+            return res;
+        }
+        ctx->seek_count++;
+        s->buf_end = s->buf_ptr = s->buf_ptr_max = s->buffer;
+        s->pos = pos + size;
+        s->eof_reached = 0;
+    }
+
+    map->data += pos;
+    map->size  = size;
+    *buf = map;
+
+    return size;
+}
+
 int64_t avio_size(AVIOContext *s)
 {
     FFIOContext *const ctx = ffiocontext(s);
@@ -18,13 +18,17 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
 #include "libavutil/bprint.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
+#include "libavcodec/avcodec.h"
 #include "libavcodec/codec_desc.h"
 #include "libavcodec/bsf.h"
 #include "avformat.h"
@@ -71,6 +75,21 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int prefetch;
+    int reuse_probe;
+
+    /* probe results of the first file, used with reuse_probe */
+    const AVInputFormat *probe_fmt;
+    AVCodecParameters **probe_par;
+    unsigned probe_nb_streams;
+
+#if HAVE_THREADS
+    pthread_t prefetch_thread;
+    int prefetch_running;
+    unsigned prefetch_fileno;
+    AVFormatContext *prefetch_avf;
+    int prefetch_ret;
+#endif
 } ConcatContext;
 
 static int concat_probe(const AVProbeData *probe)
@@ -332,35 +351,154 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+static int same_stream_layout(ConcatContext *cat, AVFormatContext *ic)
 {
-    ConcatContext *cat = avf->priv_data;
-    ConcatFile *file = &cat->files[fileno];
-    AVDictionary *options = NULL;
+    if (ic->nb_streams != cat->probe_nb_streams)
+        return 0;
+    for (unsigned i = 0; i < ic->nb_streams; i++)
+        if (ic->streams[i]->codecpar->codec_id != cat->probe_par[i]->codec_id)
+            return 0;
+    return 1;
+}
+
+static void free_probe_results(ConcatContext *cat)
+{
+    for (unsigned i = 0; i < cat->probe_nb_streams; i++)
+        avcodec_parameters_free(&cat->probe_par[i]);
+    av_freep(&cat->probe_par);
+    cat->probe_nb_streams = 0;
+}
+
+static int save_probe_results(ConcatContext *cat)
+{
+    AVFormatContext *ic = cat->avf;
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
+    cat->probe_par = av_calloc(ic->nb_streams, sizeof(*cat->probe_par));
+    if (!cat->probe_par)
+        return AVERROR(ENOMEM);
+    cat->probe_nb_streams = ic->nb_streams;
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        if (!(cat->probe_par[i] = avcodec_parameters_alloc()))
+            return AVERROR(ENOMEM);
+        if ((ret = avcodec_parameters_copy(cat->probe_par[i], ic->streams[i]->codecpar)) < 0)
+            return ret;
+    }
+    cat->probe_fmt = ic->iformat;
+    return 0;
+}
 
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+/* Copy the parameters which only the decoders could find for the first file
+ * to the streams of another file with the same layout, so that analyzing
+ * its headers is enough. */
+static void reuse_probe_results(ConcatContext *cat, AVFormatContext *ic)
+{
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        AVCodecParameters *par = ic->streams[i]->codecpar;
+        const AVCodecParameters *ref = cat->probe_par[i];
+
+        if (par->format < 0)
+            par->format = ref->format;
+        if (par->profile == FF_PROFILE_UNKNOWN)
+            par->profile = ref->profile;
+        if (par->level == FF_LEVEL_UNKNOWN)
+            par->level = ref->level;
+        if (!par->bits_per_raw_sample)
+            par->bits_per_raw_sample = ref->bits_per_raw_sample;
+
+        switch (par->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (!par->sample_aspect_ratio.num)
+                par->sample_aspect_ratio = ref->sample_aspect_ratio;
+            if (par->field_order == AV_FIELD_UNKNOWN)
+                par->field_order = ref->field_order;
+            if (par->color_range == AVCOL_RANGE_UNSPECIFIED)
+                par->color_range = ref->color_range;
+            if (par->color_primaries == AVCOL_PRI_UNSPECIFIED)
+                par->color_primaries = ref->color_primaries;
+            if (par->color_trc == AVCOL_TRC_UNSPECIFIED)
+                par->color_trc = ref->color_trc;
+            if (par->color_space == AVCOL_SPC_UNSPECIFIED)
+                par->color_space = ref->color_space;
+            if (par->chroma_location == AVCHROMA_LOC_UNSPECIFIED)
+                par->chroma_location = ref->chroma_location;
+            if (!par->video_delay)
+                par->video_delay = ref->video_delay;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            if (!par->frame_size)
+                par->frame_size = ref->frame_size;
+            if (!par->initial_padding)
+                par->initial_padding = ref->initial_padding;
+            break;
+        }
+    }
+}
+
+static int alloc_input(AVFormatContext *avf, ConcatFile *file,
+                       AVFormatContext **pic, AVDictionary **options)
+{
+    AVFormatContext *ic;
+    int ret;
+
+    ic = avformat_alloc_context();
+    if (!ic)
         return AVERROR(ENOMEM);
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
+    ic->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    ic->interrupt_callback = avf->interrupt_callback;
 
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
+    if ((ret = ff_copy_whiteblacklists(ic, avf)) < 0) {
+        avformat_free_context(ic);
         return ret;
+    }
 
-    ret = av_dict_copy(&options, file->options, 0);
-    if (ret < 0)
+    ret = av_dict_copy(options, file->options, 0);
+    if (ret < 0) {
+        av_dict_free(options);
+        avformat_free_context(ic);
         return ret;
+    }
+    *pic = ic;
+    return 0;
+}
+
+/* Open and probe a file; this may run in the prefetch thread, so it must
+ * only read the shared state. */
+static int open_input(AVFormatContext *avf, unsigned fileno, AVFormatContext **pic)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    AVDictionary *options = NULL;
+    AVFormatContext *ic;
+    int ret;
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, &options)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
+    if ((ret = alloc_input(avf, file, &ic, &options)) < 0)
+        return ret;
+
+    ret = avformat_open_input(&ic, file->url, cat->probe_fmt, &options);
+    if (ret < 0 && cat->probe_fmt) {
+        /* the file is not in the format of the first one */
+        av_log(avf, AV_LOG_VERBOSE, "Probing the format of '%s'\n", file->url);
+        av_dict_free(&options);
+        if ((ret = alloc_input(avf, file, &ic, &options)) < 0)
+            return ret;
+        ret = avformat_open_input(&ic, file->url, NULL, &options);
+    }
+    if (ret >= 0) {
+        /* The first file was analyzed completely, so the parameters only its
+         * decoders could find are known; headers are enough for the others. */
+        if (cat->probe_fmt && ic->iformat == cat->probe_fmt &&
+            same_stream_layout(cat, ic)) {
+            reuse_probe_results(cat, ic);
+            ic->flags |= AVFMT_FLAG_HEADER_PROBE;
+        }
+        ret = avformat_find_stream_info(ic, NULL);
+    }
+    if (ret < 0) {
         av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
         av_dict_free(&options);
-        avformat_close_input(&cat->avf);
+        avformat_close_input(&ic);
         return ret;
     }
     if (options) {
@@ -368,6 +506,73 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
         /* TODO log unused options once we have a proper string API */
         av_dict_free(&options);
     }
+    *pic = ic;
+    return 0;
+}
+
+#if HAVE_THREADS
+static void *prefetch_thread(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+
+    cat->prefetch_ret = open_input(avf, cat->prefetch_fileno, &cat->prefetch_avf);
+    return NULL;
+}
+
+static void prefetch_start(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    int ret;
+
+    cat->prefetch_fileno = fileno;
+    cat->prefetch_avf    = NULL;
+    if ((ret = pthread_create(&cat->prefetch_thread, NULL, prefetch_thread, avf))) {
+        av_log(avf, AV_LOG_WARNING, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+        return;
+    }
+    cat->prefetch_running = 1;
+}
+
+/* Wait for the prefetch thread, and return the opened file if it is the
+ * requested one. */
+static AVFormatContext *prefetch_get(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    AVFormatContext *ic;
+
+    if (!cat->prefetch_running)
+        return NULL;
+    pthread_join(cat->prefetch_thread, NULL);
+    cat->prefetch_running = 0;
+
+    ic = cat->prefetch_avf;
+    cat->prefetch_avf = NULL;
+    if (ic && cat->prefetch_fileno != fileno)
+        avformat_close_input(&ic);
+    return ic;
+}
+#endif
+
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret;
+
+    if (cat->avf)
+        avformat_close_input(&cat->avf);
+
+#if HAVE_THREADS
+    cat->avf = prefetch_get(avf, fileno);
+#endif
+    if (!cat->avf && (ret = open_input(avf, fileno, &cat->avf)) < 0)
+        return ret;
+
+    if (cat->reuse_probe && !cat->probe_fmt &&
+        (ret = save_probe_results(cat)) < 0)
+        return ret;
+
     cat->cur_file = file;
     file->start_time = !fileno ? 0 :
                        cat->files[fileno - 1].start_time +
@@ -388,6 +593,11 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
        if ((ret = avformat_seek_file(cat->avf, -1, INT64_MIN, file->inpoint, file->inpoint, 0)) < 0)
            return ret;
     }
+
+#if HAVE_THREADS
+    if (cat->prefetch && fileno + 1 < cat->nb_files)
+        prefetch_start(avf, fileno + 1);
+#endif
     return 0;
 }
 
@@ -396,6 +606,15 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+#if HAVE_THREADS
+    if (cat->prefetch_running) {
+        pthread_join(cat->prefetch_thread, NULL);
+        cat->prefetch_running = 0;
+        avformat_close_input(&cat->prefetch_avf);
+    }
+#endif
+    free_probe_results(cat);
+
     for (i = 0; i < cat->nb_files; i++) {
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
@@ -924,6 +1143,10 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "prefetch", "open the next file in a separate thread",
+      OFFSET(prefetch), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "reuse_probe", "reuse the format and stream analysis of the first file",
+      OFFSET(reuse_probe), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
     { NULL }
 };
 
@@ -21,16 +21,19 @@
 
 #include <stdint.h>
 
+#include "config.h"
 #include "config_components.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/dict.h"
+#include "libavutil/fifo.h"
 #include "libavutil/internal.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 
@@ -381,6 +384,8 @@ void avformat_close_input(AVFormatContext **ps)
     s  = *ps;
     pb = s->pb;
 
+    ff_demux_prefetch_stop(s);
+
     if ((s->iformat && strcmp(s->iformat->name, "image2") && s->iformat->flags & AVFMT_NOFILE) ||
         (s->flags & AVFMT_FLAG_CUSTOM_IO))
         pb = NULL;
@@ -820,6 +825,166 @@ static void update_dts_from_pts(AVFormatContext *s, int stream_index,
     }
 }
 
+/**
+ * A change of the public demuxer state made while reading a packet in the
+ * prefetch thread. It is applied by the caller of av_read_frame() when the
+ * packet is returned, so that the state never changes under its feet.
+ */
+typedef struct PrefetchUpdate {
+    int stream_index;           ///< -1 for the AVFormatContext itself
+    int event_flags;
+    int set_start_time;         ///< whether start_time is set
+    int64_t start_time;
+    int par;                    ///< whether the codecpar fields below are set
+    int sample_rate;
+    int64_t bit_rate;
+    enum AVCodecID codec_id;
+    AVChannelLayout ch_layout;
+} PrefetchUpdate;
+
+typedef struct PrefetchState {
+    PrefetchUpdate *updates;
+    int nb_updates;
+    AVDictionary *metadata;     ///< added to AVFormatContext.metadata
+} PrefetchState;
+
+#if HAVE_THREADS
+typedef struct DemuxPrefetch {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    AVPacket *pkt;
+    PacketList queue;           ///< packets read ahead, in demuxing order
+    AVFifo *states;             ///< PrefetchState of each packet in queue
+    int64_t queue_size;         ///< sum of the sizes of the packets in queue
+    int ret;                    ///< error that stopped the thread
+    int eagain;                 ///< the demuxer returned EAGAIN, wait for the caller
+    int done;                   ///< set by the thread when it stops
+    int exit;                   ///< set to ask the thread to stop
+    int joined;                 ///< the thread is gone, read synchronously
+
+    /* only accessed by the thread while it runs */
+    int deferring;
+    PrefetchState state;        ///< changes made since the last queued packet
+} DemuxPrefetch;
+#endif
+
+/**
+ * Get the pending update of the given stream if the state changes made by
+ * this thread must be deferred.
+ *
+ * @return 1 with *update set when deferring, 0 when the change can be
+ *         applied directly, a negative error code on failure
+ */
+static int get_deferred_update(AVFormatContext *s, int stream_index,
+                               PrefetchUpdate **update)
+{
+#if HAVE_THREADS
+    DemuxPrefetch *const p = ffformatcontext(s)->prefetch;
+    PrefetchState *state;
+    PrefetchUpdate *updates;
+
+    if (!p || !p->deferring)
+        return 0;
+    state = &p->state;
+    for (int i = 0; i < state->nb_updates; i++) {
+        if (state->updates[i].stream_index == stream_index) {
+            *update = &state->updates[i];
+            return 1;
+        }
+    }
+    updates = av_realloc_array(state->updates, state->nb_updates + 1,
+                               sizeof(*state->updates));
+    if (!updates)
+        return AVERROR(ENOMEM);
+    state->updates = updates;
+    *update = &updates[state->nb_updates++];
+    memset(*update, 0, sizeof(**update));
+    (*update)->stream_index = stream_index;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static int set_stream_event(AVFormatContext *s, AVStream *st, int flags)
+{
+    PrefetchUpdate *update;
+    int ret = get_deferred_update(s, st->index, &update);
+
+    if (ret < 0)
+        return ret;
+    if (ret)
+        update->event_flags |= flags;
+    else
+        st->event_flags |= flags;
+    return 0;
+}
+
+static void set_start_time(AVFormatContext *s, AVStream *st, int64_t start_time)
+{
+    PrefetchUpdate *update;
+    int ret = get_deferred_update(s, st->index, &update);
+
+    if (!ret) {
+        st->start_time = start_time;
+    } else if (ret > 0) {
+        update->set_start_time = 1;
+        update->start_time     = start_time;
+    }
+}
+
+static int update_metadata(AVFormatContext *s, const AVDictionary *metadata)
+{
+    PrefetchUpdate *update;
+    int ret = get_deferred_update(s, -1, &update);
+
+    if (ret < 0)
+        return ret;
+    if (ret) {
+        update->event_flags |= AVFMT_EVENT_FLAG_METADATA_UPDATED;
+        return av_dict_copy(&ffformatcontext(s)->prefetch->state.metadata, metadata, 0);
+    }
+    s->event_flags |= AVFMT_EVENT_FLAG_METADATA_UPDATED;
+    return av_dict_copy(&s->metadata, metadata, 0);
+}
+
+static int set_parsed_params(AVCodecParameters *par, int sample_rate, int64_t bit_rate,
+                             enum AVCodecID codec_id, const AVChannelLayout *ch_layout)
+{
+    par->sample_rate = sample_rate;
+    par->bit_rate    = bit_rate;
+#if FF_API_OLD_CHANNEL_LAYOUT
+FF_DISABLE_DEPRECATION_WARNINGS
+    par->channels       = ch_layout->nb_channels;
+    par->channel_layout = ch_layout->order == AV_CHANNEL_ORDER_NATIVE ?
+                          ch_layout->u.mask : 0;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    par->codec_id = codec_id;
+    return av_channel_layout_copy(&par->ch_layout, ch_layout);
+}
+
+/* Export the parameters found by the parser of the stream. */
+static int update_parsed_params(AVFormatContext *s, AVStream *st)
+{
+    const AVCodecContext *avctx = ffstream(st)->avctx;
+    PrefetchUpdate *update;
+    int ret = get_deferred_update(s, st->index, &update);
+
+    if (ret < 0)
+        return ret;
+    if (!ret)
+        return set_parsed_params(st->codecpar, avctx->sample_rate, avctx->bit_rate,
+                                 avctx->codec_id, &avctx->ch_layout);
+    update->par         = 1;
+    update->sample_rate = avctx->sample_rate;
+    update->bit_rate    = avctx->bit_rate;
+    update->codec_id    = avctx->codec_id;
+    return av_channel_layout_copy(&update->ch_layout, &avctx->ch_layout);
+}
+
 static void update_initial_timestamps(AVFormatContext *s, int stream_index,
                                       int64_t dts, int64_t pts, AVPacket *pkt)
 {
@@ -827,6 +992,7 @@ static void update_initial_timestamps(AVFormatContext *s, int stream_index,
     AVStream *const st  = s->streams[stream_index];
     FFStream *const sti = ffstream(st);
     PacketListEntry *pktl = si->packet_buffer.head ? si->packet_buffer.head : si->parse_queue.head;
+    int64_t start_time = st->start_time;
 
     uint64_t shift;
 
@@ -854,23 +1020,25 @@ static void update_initial_timestamps(AVFormatContext *s, int stream_index,
         if (is_relative(pktl_it->pkt.dts))
             pktl_it->pkt.dts += shift;
 
-        if (st->start_time == AV_NOPTS_VALUE && pktl_it->pkt.pts != AV_NOPTS_VALUE) {
-            st->start_time = pktl_it->pkt.pts;
+        if (start_time == AV_NOPTS_VALUE && pktl_it->pkt.pts != AV_NOPTS_VALUE) {
+            start_time = pktl_it->pkt.pts;
             if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && st->codecpar->sample_rate)
-                st->start_time = av_sat_add64(st->start_time, av_rescale_q(sti->skip_samples, (AVRational){1, st->codecpar->sample_rate}, st->time_base));
+                start_time = av_sat_add64(start_time, av_rescale_q(sti->skip_samples, (AVRational){1, st->codecpar->sample_rate}, st->time_base));
         }
     }
 
     if (has_decode_delay_been_guessed(st))
         update_dts_from_pts(s, stream_index, pktl);
 
-    if (st->start_time == AV_NOPTS_VALUE) {
+    if (start_time == AV_NOPTS_VALUE) {
         if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || !(pkt->flags & AV_PKT_FLAG_DISCARD)) {
-            st->start_time = pts;
+            start_time = pts;
         }
         if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && st->codecpar->sample_rate)
-            st->start_time = av_sat_add64(st->start_time, av_rescale_q(sti->skip_samples, (AVRational){1, st->codecpar->sample_rate}, st->time_base));
+            start_time = av_sat_add64(start_time, av_rescale_q(sti->skip_samples, (AVRational){1, st->codecpar->sample_rate}, st->time_base));
     }
+    if (start_time != st->start_time)
+        set_start_time(s, st, start_time);
 }
 
 static void update_initial_durations(AVFormatContext *s, AVStream *st,
@@ -1270,7 +1438,11 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         st  = s->streams[pkt->stream_index];
         sti = ffstream(st);
 
-        st->event_flags |= AVSTREAM_EVENT_FLAG_NEW_PACKETS;
+        ret = set_stream_event(s, st, AVSTREAM_EVENT_FLAG_NEW_PACKETS);
+        if (ret < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
 
         /* update context if required */
         if (sti->need_context_update) {
@@ -1342,19 +1514,9 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         } else if (st->discard < AVDISCARD_ALL) {
             if ((ret = parse_packet(s, pkt, pkt->stream_index, 0)) < 0)
                 return ret;
-            st->codecpar->sample_rate = sti->avctx->sample_rate;
-            st->codecpar->bit_rate = sti->avctx->bit_rate;
-#if FF_API_OLD_CHANNEL_LAYOUT
-FF_DISABLE_DEPRECATION_WARNINGS
-            st->codecpar->channels = sti->avctx->ch_layout.nb_channels;
-            st->codecpar->channel_layout = sti->avctx->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ?
-                                           sti->avctx->ch_layout.u.mask : 0;
-FF_ENABLE_DEPRECATION_WARNINGS
-#endif
-            ret = av_channel_layout_copy(&st->codecpar->ch_layout, &sti->avctx->ch_layout);
+            ret = update_parsed_params(s, st);
             if (ret < 0)
                 return ret;
-            st->codecpar->codec_id = sti->avctx->codec_id;
         } else {
             /* free packet */
             av_packet_unref(pkt);
@@ -1420,8 +1582,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (!si->metafree) {
         int metaret = av_opt_get_dict_val(s, "metadata", AV_OPT_SEARCH_CHILDREN, &metadata);
         if (metadata) {
-            s->event_flags |= AVFMT_EVENT_FLAG_METADATA_UPDATED;
-            av_dict_copy(&s->metadata, metadata, 0);
+            update_metadata(s, metadata);
             av_dict_free(&metadata);
             av_opt_set_dict_val(s, "metadata", NULL, AV_OPT_SEARCH_CHILDREN);
         }
@@ -1445,7 +1606,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return ret;
 }
 
-int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+static int read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     FFFormatContext *const si = ffformatcontext(s);
     const int genpts = s->flags & AVFMT_FLAG_GENPTS;
@@ -1540,6 +1701,254 @@ return_packet:
     return ret;
 }
 
+#if HAVE_THREADS
+static void prefetch_state_free(PrefetchState *state)
+{
+    for (int i = 0; i < state->nb_updates; i++)
+        av_channel_layout_uninit(&state->updates[i].ch_layout);
+    av_freep(&state->updates);
+    state->nb_updates = 0;
+    av_dict_free(&state->metadata);
+}
+
+/* Apply the changes made by the prefetch thread, in the caller's thread. */
+static int prefetch_state_apply(AVFormatContext *s, PrefetchState *state)
+{
+    int ret = 0;
+
+    for (int i = 0; i < state->nb_updates && ret >= 0; i++) {
+        const PrefetchUpdate *update = &state->updates[i];
+
+        if (update->stream_index < 0) {
+            s->event_flags |= update->event_flags;
+            continue;
+        }
+        s->streams[update->stream_index]->event_flags |= update->event_flags;
+        if (update->set_start_time)
+            s->streams[update->stream_index]->start_time = update->start_time;
+        if (update->par)
+            ret = set_parsed_params(s->streams[update->stream_index]->codecpar,
+                                    update->sample_rate, update->bit_rate,
+                                    update->codec_id, &update->ch_layout);
+    }
+    if (state->metadata && ret >= 0)
+        ret = av_dict_copy(&s->metadata, state->metadata, 0);
+    prefetch_state_free(state);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    DemuxPrefetch *p = ffformatcontext(s)->prefetch;
+
+    pthread_mutex_lock(&p->lock);
+    p->deferring = 1;
+    while (!p->exit) {
+        int ret, size;
+
+        /* always keep one packet ready, even larger than the limit */
+        if (p->eagain || (p->queue.head && p->queue_size >= s->prefetch_size)) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        ret = read_frame(s, p->pkt);
+        size = ret >= 0 ? p->pkt->size : 0;
+        /* A state left without its packet on failure is applied when the
+         * thread is stopped. */
+        if (ret >= 0 && (ret = av_fifo_write(p->states, &p->state, 1)) >= 0) {
+            memset(&p->state, 0, sizeof(p->state));
+            ret = avpriv_packet_list_put(&p->queue, p->pkt, NULL, 0);
+        }
+
+        pthread_mutex_lock(&p->lock);
+        if (ret == AVERROR(EAGAIN)) {
+            /* retry when the caller asks for a packet again */
+            p->eagain = 1;
+            pthread_cond_broadcast(&p->cond);
+            continue;
+        }
+        if (ret < 0) {
+            av_packet_unref(p->pkt);
+            p->ret = ret;
+            break;
+        }
+        p->queue_size += size;
+        pthread_cond_broadcast(&p->cond);
+    }
+    p->deferring = 0;
+    p->done = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+void ff_demux_prefetch_stop(AVFormatContext *s)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    DemuxPrefetch *p = si->prefetch;
+    PrefetchState state;
+
+    if (!p)
+        return;
+
+    if (!p->joined) {
+        pthread_mutex_lock(&p->lock);
+        p->exit = 1;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        pthread_join(p->thread, NULL);
+    }
+
+    while (av_fifo_read(p->states, &state, 1) >= 0)
+        prefetch_state_apply(s, &state);
+    prefetch_state_apply(s, &p->state);
+
+    /* The packets read ahead precede those buffered for genpts, give them
+     * back so that they are returned next or flushed by a seek. */
+    if (p->queue.head) {
+        p->queue.tail->next = si->packet_buffer.head;
+        if (!si->packet_buffer.head)
+            si->packet_buffer.tail = p->queue.tail;
+        si->packet_buffer.head = p->queue.head;
+    }
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_fifo_freep2(&p->states);
+    av_packet_free(&p->pkt);
+    av_freep(&si->prefetch);
+}
+
+/* Whether the demuxer state is settled enough to read in another thread. */
+static int prefetch_possible(AVFormatContext *s)
+{
+    if (!(s->iformat->flags_internal & FF_FMT_PREFETCH) ||
+        s->ctx_flags & AVFMTCTX_NOHEADER)
+        return 0;
+
+    /* The first packets of a stream may still set its codec and timestamp
+     * wrapping, read those synchronously. */
+    for (unsigned i = 0; i < s->nb_streams; i++) {
+        const AVStream *const st  = s->streams[i];
+        const FFStream *const sti = cffstream(st);
+
+        if (sti->request_probe > 0 ||
+            (sti->pts_wrap_reference == AV_NOPTS_VALUE &&
+             st->pts_wrap_bits < 63 && s->correct_ts_overflow))
+            return 0;
+    }
+    return 1;
+}
+
+static int prefetch_start(AVFormatContext *s)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    DemuxPrefetch *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->pkt    = av_packet_alloc();
+    p->states = av_fifo_alloc2(16, sizeof(PrefetchState), AV_FIFO_FLAG_AUTO_GROW);
+    if (!p->pkt || !p->states) {
+        av_fifo_freep2(&p->states);
+        av_packet_free(&p->pkt);
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    si->prefetch = p;
+    ret = pthread_create(&p->thread, NULL, prefetch_thread, s);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n",
+               av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->lock);
+        av_fifo_freep2(&p->states);
+        av_packet_free(&p->pkt);
+        av_freep(&si->prefetch);
+        return AVERROR(ret);
+    }
+    av_log(s, AV_LOG_DEBUG, "Reading packets ahead in a separate thread\n");
+    return 0;
+}
+
+static int prefetch_read_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    DemuxPrefetch *p = si->prefetch;
+    PrefetchState state;
+    int ret;
+
+    if (!p) {
+        if (!prefetch_possible(s))
+            return read_frame(s, pkt);
+        if ((ret = prefetch_start(s)) < 0)
+            return ret;
+        p = si->prefetch;
+    }
+    /* after the thread stopped, read like without it until the next seek */
+    if (p->joined)
+        return read_frame(s, pkt);
+
+    pthread_mutex_lock(&p->lock);
+    if (p->eagain) {
+        p->eagain = 0;
+        pthread_cond_broadcast(&p->cond);
+    }
+    while (!p->queue.head && !p->done && !p->eagain) {
+        if (s->flags & AVFMT_FLAG_NONBLOCK) {
+            pthread_mutex_unlock(&p->lock);
+            return AVERROR(EAGAIN);
+        }
+        pthread_cond_wait(&p->cond, &p->lock);
+    }
+    if (p->queue.head) {
+        p->queue_size -= p->queue.head->pkt.size;
+        ret = avpriv_packet_list_get(&p->queue, pkt);
+        av_fifo_read(p->states, &state, 1);
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        if ((ret = prefetch_state_apply(s, &state)) < 0)
+            av_packet_unref(pkt);
+        return ret;
+    }
+    if (!p->done) {
+        pthread_mutex_unlock(&p->lock);
+        return AVERROR(EAGAIN);
+    }
+    ret = p->ret;
+    pthread_mutex_unlock(&p->lock);
+
+    pthread_join(p->thread, NULL);
+    p->joined = 1;
+    while (av_fifo_read(p->states, &state, 1) >= 0)
+        prefetch_state_apply(s, &state);
+    prefetch_state_apply(s, &p->state);
+    return ret;
+}
+#else
+void ff_demux_prefetch_stop(AVFormatContext *s)
+{
+}
+#endif
+
+int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+{
+#if HAVE_THREADS
+    if (s->prefetch_size > 0)
+        return prefetch_read_frame(s, pkt);
+#endif
+    return read_frame(s, pkt);
+}
+
 /**
  * Return TRUE if the stream has accurate duration in any stream.
  *
@@ -1943,6 +2352,73 @@ static int determinable_frame_size(const AVCodecContext *avctx)
     return 0;
 }
 
+/**
+ * With header probing, fill in the parameters a decoder would set from what
+ * the parser found in the bitstream headers, the codec tag and the layout
+ * of raw formats, so that the decoder is not needed for them.
+ */
+static void header_probe_update(AVFormatContext *ic, AVStream *st)
+{
+    FFStream *const sti = ffstream(st);
+    AVCodecContext *const avctx = sti->avctx;
+    const AVCodecParserContext *const pc = sti->parser;
+    const AVCodec *codec;
+    int bits_per_sample;
+
+    switch (avctx->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (pc && !avctx->width && pc->width > 0 && pc->height > 0) {
+            avctx->width        = pc->width;
+            avctx->height       = pc->height;
+            avctx->coded_width  = pc->coded_width;
+            avctx->coded_height = pc->coded_height;
+        }
+        if (avctx->pix_fmt != AV_PIX_FMT_NONE)
+            break;
+        if (pc && pc->format >= 0) {
+            avctx->pix_fmt = pc->format;
+        } else if (avctx->codec_id == AV_CODEC_ID_RAWVIDEO) {
+            /* same selection as the rawvideo decoder */
+            if (avctx->codec_tag == MKTAG('r','a','w',' ') ||
+                avctx->codec_tag == MKTAG('N','O','1','6'))
+                avctx->pix_fmt = avpriv_pix_fmt_find(PIX_FMT_LIST_MOV,
+                                                     avctx->bits_per_coded_sample);
+            else if (avctx->codec_tag == MKTAG('W','R','A','W'))
+                avctx->pix_fmt = avpriv_pix_fmt_find(PIX_FMT_LIST_AVI,
+                                                     avctx->bits_per_coded_sample);
+            else if (avctx->codec_tag && (avctx->codec_tag & 0xFFFFFF) != MKTAG('B','I','T', 0))
+                avctx->pix_fmt = avpriv_pix_fmt_find(PIX_FMT_LIST_RAW, avctx->codec_tag);
+            else if (avctx->bits_per_coded_sample)
+                avctx->pix_fmt = avpriv_pix_fmt_find(PIX_FMT_LIST_AVI,
+                                                     avctx->bits_per_coded_sample);
+        }
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        /* as computed by avcodec_open2() for decoders */
+        bits_per_sample = av_get_bits_per_sample(avctx->codec_id);
+        if (!avctx->bit_rate && bits_per_sample && avctx->sample_rate > 0 &&
+            avctx->ch_layout.nb_channels > 0)
+            avctx->bit_rate = (int64_t)avctx->sample_rate *
+                              avctx->ch_layout.nb_channels * bits_per_sample;
+        if (avctx->sample_fmt != AV_SAMPLE_FMT_NONE)
+            break;
+        if (pc && pc->format >= 0) {
+            avctx->sample_fmt = pc->format;
+            break;
+        }
+        /* a decoder supporting a single sample format always outputs it */
+        codec = find_probe_decoder(ic, st, avctx->codec_id);
+        if (codec && codec->sample_fmts &&
+            codec->sample_fmts[0] != AV_SAMPLE_FMT_NONE &&
+            codec->sample_fmts[1] == AV_SAMPLE_FMT_NONE) {
+            avctx->sample_fmt = codec->sample_fmts[0];
+            if (avctx->sample_fmt == AV_SAMPLE_FMT_S32 && !avctx->bits_per_raw_sample)
+                avctx->bits_per_raw_sample = av_get_bits_per_sample(avctx->codec_id);
+        }
+        break;
+    }
+}
+
 static int has_codec_parameters(const AVStream *st, const char **errmsg_ptr)
 {
     const FFStream *const sti = cffstream(st);
@@ -2447,9 +2923,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    int header_probe = ic->flags & AVFMT_FLAG_HEADER_PROBE;
+    int64_t start_time = av_gettime_relative(), read_time = 0, timings_time = 0;
+    int64_t t;
 
     flush_codecs = probesize > 0;
 
+    ff_demux_prefetch_stop(ic);
+
     av_opt_set_int(ic, "skip_clear", 1, AV_OPT_SEARCH_CHILDREN);
 
     max_stream_analyze_duration = max_analyze_duration;
@@ -2515,12 +2996,16 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
         // Try to just open decoders, in case this is enough to get parameters.
         // Also ensure that subtitle_header is properly set.
-        if (!has_codec_parameters(st, NULL) && sti->request_probe <= 0 ||
+        // With header probing, parsers get the first chance to fill them in.
+        if (!has_codec_parameters(st, NULL) && sti->request_probe <= 0 && !header_probe ||
             st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
-            if (codec && !avctx->codec)
+            if (codec && !avctx->codec) {
+                t = av_gettime_relative();
                 if (avcodec_open2(avctx, codec, options ? &options[i] : &thread_opt) < 0)
                     av_log(ic, AV_LOG_WARNING,
                            "Failed to open codec in %s\n",__FUNCTION__);
+                sti->info->decode_time += av_gettime_relative() - t;
+            }
         }
         if (!options)
             av_dict_free(&thread_opt);
@@ -2547,6 +3032,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             int fps_analyze_framecount = 20;
             int count;
 
+            if (header_probe)
+                header_probe_update(ic, st);
             if (!has_codec_parameters(st, NULL))
                 break;
             /* If the timebase is coarse (like the usual millisecond precision
@@ -2619,7 +3106,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
         /* NOTE: A new stream can be added there if no header in file
          * (AVFMTCTX_NOHEADER). */
+        t = av_gettime_relative();
         ret = read_frame_internal(ic, pkt1);
+        read_time += av_gettime_relative() - t;
         if (ret == AVERROR(EAGAIN))
             continue;
 
@@ -2753,9 +3242,18 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * If AV_CODEC_CAP_CHANNEL_CONF is set this will force decoding of at
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
-         * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+         * the container.
+         *
+         * With header probing, the decoder is only used as a fallback for
+         * streams whose parameters could not be filled in otherwise. */
+        if (header_probe)
+            header_probe_update(ic, st);
+        if (!header_probe || !has_codec_parameters(st, NULL)) {
+            t = av_gettime_relative();
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
+            sti->info->decode_time += av_gettime_relative() - t;
+        }
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt1);
@@ -2800,9 +3298,11 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
             /* flush the decoders */
             if (sti->info->found_decoder == 1) {
+                t = av_gettime_relative();
                 err = try_decode_frame(ic, st, empty_pkt,
                                         (options && i < orig_nb_streams)
                                         ? &options[i] : NULL);
+                sti->info->decode_time += av_gettime_relative() - t;
 
                 if (err < 0) {
                     av_log(ic, AV_LOG_INFO,
@@ -2912,8 +3412,11 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         }
     }
 
-    if (probesize)
+    if (probesize) {
+        t = av_gettime_relative();
         estimate_timings(ic, old_offset);
+        timings_time = av_gettime_relative() - t;
+    }
 
     av_opt_set_int(ic, "skip_clear", 0, AV_OPT_SEARCH_CHILDREN);
 
@@ -2967,6 +3470,21 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         sti->avctx_inited = 0;
     }
 
+    if (av_log_get_level() >= AV_LOG_VERBOSE) {
+        int64_t decode_time = 0;
+
+        for (unsigned i = 0; i < ic->nb_streams; i++) {
+            const FFStream *const sti = cffstream(ic->streams[i]);
+            av_log(ic, AV_LOG_VERBOSE, "Stream #%u: probed %d packets, decoded %d frames in %"PRId64" us\n",
+                   i, sti->codec_info_nb_frames, sti->nb_decoded_frames, sti->info->decode_time);
+            decode_time += sti->info->decode_time;
+        }
+        av_log(ic, AV_LOG_VERBOSE, "Stream info found in %"PRId64" us: "
+               "reading and parsing %"PRId64" us, decoding %"PRId64" us, "
+               "duration estimation %"PRId64" us\n",
+               av_gettime_relative() - start_time, read_time, decode_time, timings_time);
+    }
+
 find_stream_info_err:
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         AVStream *const st  = ic->streams[i];
@@ -53,6 +53,11 @@ typedef struct FFStreamInfo {
     int     fps_first_dts_idx;
     int64_t fps_last_dts;
     int     fps_last_dts_idx;
+
+    /**
+     * Time spent opening and running the decoder, in microseconds.
+     */
+    int64_t decode_time;
 } FFStreamInfo;
 
 /**
@@ -88,6 +93,13 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 
 void ff_read_frame_flush(AVFormatContext *s);
 
+/**
+ * Stop the demuxing thread reading packets ahead, if any, giving back the
+ * packets it read to the generic packet buffer. Must be called before any
+ * public function other than av_read_frame() touches the demuxer state.
+ */
+void ff_demux_prefetch_stop(AVFormatContext *s);
+
 /**
  * Perform a binary search using av_index_search_timestamp() and
  * AVInputFormat.read_timestamp().
@@ -201,6 +201,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 int av_read_play(AVFormatContext *s)
 {
+    ff_demux_prefetch_stop(s);
     if (s->iformat->read_play)
         return s->iformat->read_play(s);
     if (s->pb)
@@ -210,6 +211,7 @@ int av_read_play(AVFormatContext *s)
 
 int av_read_pause(AVFormatContext *s)
 {
+    ff_demux_prefetch_stop(s);
     if (s->iformat->read_pause)
         return s->iformat->read_pause(s);
     if (s->pb)
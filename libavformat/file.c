@@ -24,7 +24,9 @@
 #include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avio.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -37,6 +39,9 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
@@ -88,6 +93,11 @@
 
 /* standard file protocol */
 
+typedef struct FileAsyncBlock {
+    uint8_t *data;
+    int size;
+} FileAsyncBlock;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -95,9 +105,34 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int async_blocks;
+    int async_block_size;
+    int use_mmap;
+    AVBufferRef *map;       ///< whole file mapped read-only, if use_mmap
+    int64_t map_pos;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if HAVE_THREADS
+    /* Read-ahead / write-behind state. Once the I/O thread runs, it owns
+     * the file descriptor; the caller only touches queued blocks. */
+    int async_active;
+    int async_write;
+    pthread_t async_thread;
+    pthread_mutex_t async_lock;
+    pthread_cond_t async_cond;
+    FileAsyncBlock *blocks;
+    int block_head;         ///< oldest queued block
+    int nb_queued;          ///< blocks read ahead, or waiting to be written
+    int block_offset;       ///< bytes of the head block already consumed
+    int64_t fill_pos;       ///< file position the thread reads next
+    int64_t logical_pos;    ///< position as seen by the caller
+    unsigned generation;    ///< bumped by every seek to drop stale reads
+    int seek_pending;
+    int async_eof;
+    int async_error;
+    int async_abort;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -105,6 +140,9 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "async_blocks", "number of blocks read ahead or written behind by an I/O thread", offsetof(FileContext, async_blocks), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 256, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "async_block_size", "size of each read-ahead or write-behind block", offsetof(FileContext, async_block_size), AV_OPT_TYPE_INT, { .i64 = 262144 }, 4096, 64 << 20, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "map the file into memory and let packets reference it", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -135,11 +173,344 @@ static const AVClass fd_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_THREADS
+static void *file_async_thread(void *arg)
+{
+    FileContext *c = arg;
+
+    pthread_mutex_lock(&c->async_lock);
+    while (1) {
+        FileAsyncBlock *block;
+        unsigned generation;
+        int64_t pos;
+        int seek, ret;
+
+        if (c->async_write) {
+            if (!c->nb_queued) {
+                if (c->async_abort)
+                    break;
+                pthread_cond_wait(&c->async_cond, &c->async_lock);
+                continue;
+            }
+            block = &c->blocks[c->block_head];
+            pthread_mutex_unlock(&c->async_lock);
+
+            for (ret = 0; ret < block->size; ) {
+                int n = write(c->fd, block->data + ret, block->size - ret);
+                if (n < 0) {
+                    ret = AVERROR(errno);
+                    break;
+                }
+                ret += n;
+            }
+
+            pthread_mutex_lock(&c->async_lock);
+            if (ret < 0 && !c->async_error)
+                c->async_error = ret;
+            c->block_head = (c->block_head + 1) % c->async_blocks;
+            c->nb_queued--;
+            pthread_cond_broadcast(&c->async_cond);
+            continue;
+        }
+
+        if (c->async_abort)
+            break;
+        if (c->async_eof || c->async_error || c->nb_queued == c->async_blocks) {
+            pthread_cond_wait(&c->async_cond, &c->async_lock);
+            continue;
+        }
+        block      = &c->blocks[(c->block_head + c->nb_queued) % c->async_blocks];
+        generation = c->generation;
+        pos        = c->fill_pos;
+        seek       = c->seek_pending;
+        c->seek_pending = 0;
+        pthread_mutex_unlock(&c->async_lock);
+
+        ret = 0;
+        if (seek && lseek(c->fd, pos, SEEK_SET) < 0)
+            ret = AVERROR(errno);
+        if (!ret) {
+            ret = read(c->fd, block->data, c->async_block_size);
+            if (ret < 0)
+                ret = AVERROR(errno);
+        }
+
+        pthread_mutex_lock(&c->async_lock);
+        if (generation != c->generation)
+            continue;
+        if (ret < 0) {
+            c->async_error = ret;
+        } else if (!ret) {
+            c->async_eof = 1;
+        } else {
+            block->size  = ret;
+            c->fill_pos += ret;
+            c->nb_queued++;
+        }
+        pthread_cond_broadcast(&c->async_cond);
+    }
+    pthread_mutex_unlock(&c->async_lock);
+
+    return NULL;
+}
+
+static int file_async_start(URLContext *h, int write)
+{
+    FileContext *c = h->priv_data;
+    int i, ret;
+
+    c->blocks = av_calloc(c->async_blocks, sizeof(*c->blocks));
+    if (!c->blocks)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < c->async_blocks; i++) {
+        c->blocks[i].data = av_malloc(c->async_block_size);
+        if (!c->blocks[i].data)
+            return AVERROR(ENOMEM);
+    }
+
+    c->async_write = write;
+    c->fill_pos    = c->logical_pos = lseek(c->fd, 0, SEEK_CUR);
+    if (c->fill_pos < 0)
+        c->fill_pos = c->logical_pos = 0;
+
+    if ((ret = pthread_mutex_init(&c->async_lock, NULL))) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed: %s\n", av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->async_cond, NULL))) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed: %s\n", av_err2str(AVERROR(ret)));
+        pthread_mutex_destroy(&c->async_lock);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&c->async_thread, NULL, file_async_thread, c))) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&c->async_cond);
+        pthread_mutex_destroy(&c->async_lock);
+        return AVERROR(ret);
+    }
+    c->async_active = 1;
+
+    return 0;
+}
+
+static int file_async_stop(FileContext *c)
+{
+    int i, ret = 0;
+
+    if (c->async_active) {
+        pthread_mutex_lock(&c->async_lock);
+        c->async_abort = 1;
+        pthread_cond_broadcast(&c->async_cond);
+        pthread_mutex_unlock(&c->async_lock);
+        pthread_join(c->async_thread, NULL);
+        pthread_cond_destroy(&c->async_cond);
+        pthread_mutex_destroy(&c->async_lock);
+        ret = c->async_error;
+        c->async_active = 0;
+    }
+    if (c->blocks) {
+        for (i = 0; i < c->async_blocks; i++)
+            av_freep(&c->blocks[i].data);
+        av_freep(&c->blocks);
+    }
+
+    return ret;
+}
+
+static int file_async_read(FileContext *c, unsigned char *buf, int size)
+{
+    FileAsyncBlock *block;
+    int ret;
+
+    pthread_mutex_lock(&c->async_lock);
+    while (!c->nb_queued && !c->async_eof && !c->async_error)
+        pthread_cond_wait(&c->async_cond, &c->async_lock);
+    if (!c->nb_queued) {
+        ret = c->async_error ? c->async_error : AVERROR_EOF;
+        pthread_mutex_unlock(&c->async_lock);
+        return ret;
+    }
+    block = &c->blocks[c->block_head];
+    pthread_mutex_unlock(&c->async_lock);
+
+    ret = FFMIN(size, block->size - c->block_offset);
+    memcpy(buf, block->data + c->block_offset, ret);
+
+    pthread_mutex_lock(&c->async_lock);
+    c->block_offset += ret;
+    c->logical_pos  += ret;
+    if (c->block_offset == block->size) {
+        c->block_head   = (c->block_head + 1) % c->async_blocks;
+        c->block_offset = 0;
+        c->nb_queued--;
+        pthread_cond_broadcast(&c->async_cond);
+    }
+    pthread_mutex_unlock(&c->async_lock);
+
+    return ret;
+}
+
+static int file_async_write(FileContext *c, const unsigned char *buf, int size)
+{
+    FileAsyncBlock *block;
+
+    pthread_mutex_lock(&c->async_lock);
+    while (c->nb_queued == c->async_blocks && !c->async_error)
+        pthread_cond_wait(&c->async_cond, &c->async_lock);
+    if (c->async_error) {
+        pthread_mutex_unlock(&c->async_lock);
+        return c->async_error;
+    }
+    block = &c->blocks[(c->block_head + c->nb_queued) % c->async_blocks];
+    pthread_mutex_unlock(&c->async_lock);
+
+    size = FFMIN(size, c->async_block_size);
+    memcpy(block->data, buf, size);
+    block->size = size;
+
+    pthread_mutex_lock(&c->async_lock);
+    c->nb_queued++;
+    pthread_cond_broadcast(&c->async_cond);
+    pthread_mutex_unlock(&c->async_lock);
+
+    return size;
+}
+
+/* Wait until all queued blocks have been written. */
+static int file_async_drain(FileContext *c)
+{
+    int ret;
+
+    pthread_mutex_lock(&c->async_lock);
+    while (c->nb_queued)
+        pthread_cond_wait(&c->async_cond, &c->async_lock);
+    ret = c->async_error;
+    pthread_mutex_unlock(&c->async_lock);
+
+    return ret;
+}
+
+static int64_t file_async_seek(URLContext *h, int64_t pos, int whence)
+{
+    FileContext *c = h->priv_data;
+    int64_t queued = 0;
+    int i;
+
+    if (whence == SEEK_CUR) {
+        pos += c->logical_pos;
+    } else if (whence == SEEK_END) {
+        struct stat st;
+        if (fstat(c->fd, &st) < 0)
+            return AVERROR(errno);
+        pos += st.st_size;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->async_lock);
+    for (i = 0; i < c->nb_queued; i++)
+        queued += c->blocks[(c->block_head + i) % c->async_blocks].size;
+    queued -= c->block_offset;
+
+    if (pos >= c->logical_pos && pos < c->logical_pos + queued) {
+        /* The target has already been read ahead; drop what lies before it. */
+        int64_t skip = pos - c->logical_pos;
+        while (skip) {
+            FileAsyncBlock *block = &c->blocks[c->block_head];
+            int n = FFMIN(skip, block->size - c->block_offset);
+            c->block_offset += n;
+            skip            -= n;
+            if (c->block_offset == block->size) {
+                c->block_head   = (c->block_head + 1) % c->async_blocks;
+                c->block_offset = 0;
+                c->nb_queued--;
+            }
+        }
+    } else {
+        c->generation++;
+        c->nb_queued    = 0;
+        c->block_offset = 0;
+        c->fill_pos     = pos;
+        c->seek_pending = 1;
+        c->async_eof    = 0;
+        c->async_error  = 0;
+    }
+    c->logical_pos = pos;
+    pthread_cond_broadcast(&c->async_cond);
+    pthread_mutex_unlock(&c->async_lock);
+
+    return pos;
+}
+#endif
+
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+static int file_map(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    void *ptr;
+
+    if (fstat(c->fd, &st) < 0)
+        return AVERROR(errno);
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > SIZE_MAX)
+        return AVERROR(ENOSYS);
+
+    ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, c->fd, 0);
+    if (ptr == MAP_FAILED)
+        return AVERROR(errno);
+    c->map = av_buffer_create(ptr, st.st_size, file_unmap,
+                              (void *)(uintptr_t)st.st_size,
+                              AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(ptr, st.st_size);
+        return AVERROR(ENOMEM);
+    }
+    c->map_pos = lseek(c->fd, 0, SEEK_CUR);
+    if (c->map_pos < 0)
+        c->map_pos = 0;
+
+    return 0;
+}
+#endif
+
+static int file_map_read(FileContext *c, unsigned char *buf, int size)
+{
+    if (c->map_pos >= c->map->size)
+        return AVERROR_EOF;
+    size = FFMIN(size, c->map->size - c->map_pos);
+    memcpy(buf, c->map->data + c->map_pos, size);
+    c->map_pos += size;
+    return size;
+}
+
+static int file_get_mapping(URLContext *h, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    *buf = av_buffer_ref(c->map);
+    return *buf ? 0 : AVERROR(ENOMEM);
+}
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->map)
+        return file_map_read(c, buf, size);
+#if HAVE_THREADS
+    if (c->async_active)
+        return file_async_read(c, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -153,6 +524,10 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_THREADS
+    if (c->async_active)
+        return file_async_write(c, buf, size);
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -218,8 +593,16 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
-    return (ret == -1) ? AVERROR(errno) : 0;
+    int ret, async_ret = 0;
+#if HAVE_THREADS
+    async_ret = file_async_stop(c);
+#endif
+    /* Packets may still reference the mapping; it outlives the descriptor. */
+    av_buffer_unref(&c->map);
+    ret = close(c->fd);
+    if (ret == -1)
+        return AVERROR(errno);
+    return async_ret;
 }
 
 /* XXX: use llseek */
@@ -228,6 +611,31 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+    if (c->map) {
+        if (whence == AVSEEK_SIZE)
+            return c->map->size;
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+
+#if HAVE_THREADS
+    if (c->async_active) {
+        if (!c->async_write && whence != AVSEEK_SIZE)
+            return file_async_seek(h, pos, whence);
+        /* Written data must reach the file before it can be sized or
+         * overwritten; the I/O thread is idle once the queue is empty. */
+        if (c->async_write && (ret = file_async_drain(c)) < 0)
+            return ret;
+    }
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -315,6 +723,28 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->use_mmap && !c->follow && !(flags & AVIO_FLAG_WRITE)) {
+        int ret = AVERROR(ENOSYS);
+#if HAVE_MMAP
+        ret = file_map(h);
+#endif
+        if (ret < 0)
+            av_log(h, AV_LOG_VERBOSE, "Not mapping %s: %s\n",
+                   filename, av_err2str(ret));
+    }
+
+#if HAVE_THREADS
+    if (!c->map && c->async_blocks && !c->follow &&
+        (flags & AVIO_FLAG_READ_WRITE) != AVIO_FLAG_READ_WRITE) {
+        int ret = file_async_start(h, !!(flags & AVIO_FLAG_WRITE));
+        if (ret < 0) {
+            file_async_stop(c);
+            close(fd);
+            return ret;
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -410,6 +840,7 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+    .url_get_mapping     = file_get_mapping,
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -23,15 +23,43 @@
 
 #include "libavutil/adler32.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/opt.h"
 
 #include "libavcodec/codec_id.h"
 #include "libavcodec/codec_par.h"
 #include "libavcodec/packet.h"
 
 #include "avformat.h"
+#include "framehash.h"
 #include "internal.h"
 #include "mux.h"
 
+typedef struct FrameCRCContext {
+    const AVClass *class;
+    int hash_threads;
+    FFHashPool *pool;
+} FrameCRCContext;
+
+static int framecrc_hash_packet(AVFormatContext *s, int thread,
+                                const AVPacket *pkt, AVBPrint *line);
+
+static int framecrc_init(struct AVFormatContext *s)
+{
+    FrameCRCContext *c = s->priv_data;
+    int ret;
+
+    if (!c->hash_threads)
+        return 0;
+    ret = ff_hash_pool_init(s, &c->pool, c->hash_threads, framecrc_hash_packet);
+    if (ret == AVERROR(ENOSYS)) {
+        av_log(s, AV_LOG_WARNING, "Built without thread support, "
+               "hashing from the muxing thread\n");
+        return 0;
+    }
+    return ret;
+}
+
 static int framecrc_write_header(struct AVFormatContext *s)
 {
     int i;
@@ -48,7 +76,8 @@ static int framecrc_write_header(struct AVFormatContext *s)
     return ff_framehash_write_header(s);
 }
 
-static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+static int framecrc_hash_packet(AVFormatContext *s, int thread,
+                                const AVPacket *pkt, AVBPrint *line)
 {
     uint32_t crc = av_adler32_update(0, pkt->data, pkt->size);
     char buf[256];
@@ -66,17 +95,62 @@ static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
         }
     }
     av_strlcatf(buf, sizeof(buf), "\n");
-    avio_write(s->pb, buf, strlen(buf));
+    av_bprintf(line, "%s", buf);
     return 0;
 }
 
+static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+{
+    FrameCRCContext *c = s->priv_data;
+    AVBPrint line;
+
+    if (c->pool)
+        return ff_hash_pool_submit(c->pool, pkt, -1);
+
+    av_bprint_init(&line, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    framecrc_hash_packet(s, 0, pkt, &line);
+    avio_write(s->pb, line.str, line.len);
+    return 0;
+}
+
+static int framecrc_write_trailer(struct AVFormatContext *s)
+{
+    FrameCRCContext *c = s->priv_data;
+    return c->pool ? ff_hash_pool_flush(c->pool) : 0;
+}
+
+static void framecrc_deinit(struct AVFormatContext *s)
+{
+    FrameCRCContext *c = s->priv_data;
+    ff_hash_pool_free(&c->pool);
+}
+
+#define OFFSET(x) offsetof(FrameCRCContext, x)
+#define ENC AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption framecrc_options[] = {
+    { "hash_threads", "number of threads hashing the packets", OFFSET(hash_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, ENC },
+    { NULL },
+};
+
+static const AVClass framecrc_class = {
+    .class_name = "framecrc muxer",
+    .item_name  = av_default_item_name,
+    .option     = framecrc_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 const FFOutputFormat ff_framecrc_muxer = {
     .p.name            = "framecrc",
     .p.long_name       = NULL_IF_CONFIG_SMALL("framecrc testing"),
     .p.audio_codec     = AV_CODEC_ID_PCM_S16LE,
     .p.video_codec     = AV_CODEC_ID_RAWVIDEO,
+    .priv_data_size    = sizeof(FrameCRCContext),
+    .init              = framecrc_init,
     .write_header      = framecrc_write_header,
     .write_packet      = framecrc_write_packet,
+    .write_trailer     = framecrc_write_trailer,
+    .deinit            = framecrc_deinit,
     .p.flags           = AVFMT_VARIABLE_FPS | AVFMT_TS_NONSTRICT |
                          AVFMT_TS_NEGATIVE,
+    .p.priv_class      = &framecrc_class,
 };
@@ -1,5 +1,5 @@
 /*
- * Common functions for the frame{crc,md5} muxers
+ * Common functions for the frame{crc,md5} and hash muxers
  *
  * This file is part of FFmpeg.
  *
@@ -18,7 +18,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
 #include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#if HAVE_THREADS
+#include "libavutil/thread.h"
+#endif
+#include "framehash.h"
 #include "internal.h"
 #include "version.h"
 
@@ -52,3 +59,275 @@ int ff_framehash_write_header(AVFormatContext *s)
     }
     return 0;
 }
+
+#if HAVE_THREADS
+enum HashJobState {
+    HASH_JOB_QUEUED,
+    HASH_JOB_RUNNING,
+    HASH_JOB_DONE,
+};
+
+typedef struct HashJob {
+    AVPacket *pkt;
+    int key;
+    enum HashJobState state;
+    AVBPrint line;
+} HashJob;
+
+struct FFHashPool {
+    AVFormatContext *s;
+    FFHashPacketFunc hash_packet;
+
+    HashJob *jobs;              ///< ring of jobs, in submission order
+    int nb_jobs;
+    int first;
+    int count;
+    uint8_t *key_busy;          ///< per key, set while a job of that key runs
+    uint8_t *key_seen;          ///< scratch array for finding a job to run
+    int nb_keys;
+    int error;
+
+    pthread_t *threads;
+    int nb_threads;             ///< number of threads started
+    int next_thread_index;
+    int exit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+/* Must be called with pool->lock held. */
+static HashJob *hash_pool_next_job(FFHashPool *pool)
+{
+    memset(pool->key_seen, 0, pool->nb_keys);
+    for (int i = 0; i < pool->count; i++) {
+        HashJob *job = &pool->jobs[(pool->first + i) % pool->nb_jobs];
+
+        if (job->key < 0) {
+            if (job->state == HASH_JOB_QUEUED)
+                return job;
+            continue;
+        }
+        /* keep the jobs of a key in order */
+        if (job->state == HASH_JOB_QUEUED &&
+            !pool->key_busy[job->key] && !pool->key_seen[job->key])
+            return job;
+        if (job->state != HASH_JOB_DONE)
+            pool->key_seen[job->key] = 1;
+    }
+    return NULL;
+}
+
+static void *hash_pool_thread(void *arg)
+{
+    FFHashPool *pool = arg;
+    int thread;
+
+    pthread_mutex_lock(&pool->lock);
+    thread = pool->next_thread_index++;
+    while (!pool->exit) {
+        HashJob *job = hash_pool_next_job(pool);
+        int ret;
+
+        if (!job) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+            continue;
+        }
+        job->state = HASH_JOB_RUNNING;
+        if (job->key >= 0)
+            pool->key_busy[job->key] = 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        ret = pool->hash_packet(pool->s, thread, job->pkt, &job->line);
+        if (ret >= 0 && !av_bprint_is_complete(&job->line))
+            ret = AVERROR(ENOMEM);
+
+        pthread_mutex_lock(&pool->lock);
+        job->state = HASH_JOB_DONE;
+        if (job->key >= 0) {
+            pool->key_busy[job->key] = 0;
+            pthread_cond_broadcast(&pool->work_cond);
+        }
+        if (ret < 0 && !pool->error)
+            pool->error = ret;
+        pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* Write the lines of the finished jobs at the head of the ring.
+ * Must be called with pool->lock held. */
+static void hash_pool_write_done(FFHashPool *pool)
+{
+    while (pool->count && pool->jobs[pool->first].state == HASH_JOB_DONE) {
+        HashJob *job = &pool->jobs[pool->first];
+
+        avio_write(pool->s->pb, job->line.str, job->line.len);
+        av_bprint_clear(&job->line);
+        av_packet_unref(job->pkt);
+        pool->first = (pool->first + 1) % pool->nb_jobs;
+        pool->count--;
+    }
+}
+
+int ff_hash_pool_submit(FFHashPool *pool, const AVPacket *pkt, int key)
+{
+    HashJob *job;
+    int ret;
+
+    pthread_mutex_lock(&pool->lock);
+    hash_pool_write_done(pool);
+    while (!pool->error && pool->count == pool->nb_jobs) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+        hash_pool_write_done(pool);
+    }
+    ret = pool->error;
+    pthread_mutex_unlock(&pool->lock);
+    if (ret < 0)
+        return ret;
+
+    /* only this thread adds jobs, so the free slot stays free */
+    job = &pool->jobs[(pool->first + pool->count) % pool->nb_jobs];
+    if ((ret = av_packet_ref(job->pkt, pkt)) < 0)
+        return ret;
+    job->key   = key;
+    job->state = HASH_JOB_QUEUED;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->count++;
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+int ff_hash_pool_flush(FFHashPool *pool)
+{
+    int ret;
+
+    pthread_mutex_lock(&pool->lock);
+    hash_pool_write_done(pool);
+    while (!pool->error && pool->count) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+        hash_pool_write_done(pool);
+    }
+    ret = pool->error;
+    pthread_mutex_unlock(&pool->lock);
+
+    return ret;
+}
+
+static void hash_pool_stop_threads(FFHashPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->exit = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+    pool->nb_threads = 0;
+}
+
+void ff_hash_pool_free(FFHashPool **ppool)
+{
+    FFHashPool *pool = *ppool;
+
+    if (!pool)
+        return;
+
+    if (pool->threads) {
+        hash_pool_stop_threads(pool);
+        pthread_cond_destroy(&pool->done_cond);
+        pthread_cond_destroy(&pool->work_cond);
+        pthread_mutex_destroy(&pool->lock);
+    }
+
+    for (int i = 0; pool->jobs && i < pool->nb_jobs; i++) {
+        av_packet_free(&pool->jobs[i].pkt);
+        av_bprint_finalize(&pool->jobs[i].line, NULL);
+    }
+    av_freep(&pool->jobs);
+    av_freep(&pool->threads);
+    av_freep(&pool->key_busy);
+    av_freep(&pool->key_seen);
+    av_freep(ppool);
+}
+
+int ff_hash_pool_init(AVFormatContext *s, FFHashPool **ppool,
+                      int nb_threads, FFHashPacketFunc hash_packet)
+{
+    FFHashPool *pool;
+    int ret;
+
+    pool = *ppool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->s           = s;
+    pool->hash_packet = hash_packet;
+    /* two packets per thread keep the threads busy while the muxing
+     * thread writes the finished lines */
+    pool->nb_jobs     = 2 * nb_threads;
+    pool->nb_keys     = s->nb_streams;
+
+    if (!(pool->jobs     = av_calloc(pool->nb_jobs, sizeof(*pool->jobs))) ||
+        !(pool->key_busy = av_mallocz(FFMAX(pool->nb_keys, 1)))           ||
+        !(pool->key_seen = av_mallocz(FFMAX(pool->nb_keys, 1)))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (int i = 0; i < pool->nb_jobs; i++) {
+        av_bprint_init(&pool->jobs[i].line, 0, AV_BPRINT_SIZE_UNLIMITED);
+        if (!(pool->jobs[i].pkt = av_packet_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    /* the threads array doubles as the flag telling that the lock and
+     * conditions were initialized */
+    if (!(pool->threads = av_calloc(nb_threads, sizeof(*pool->threads)))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        ret = pthread_create(&pool->threads[pool->nb_threads], NULL,
+                             hash_pool_thread, pool);
+        if (ret) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    ff_hash_pool_free(ppool);
+    return ret;
+}
+#else
+int ff_hash_pool_init(AVFormatContext *s, FFHashPool **ppool,
+                      int nb_threads, FFHashPacketFunc hash_packet)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_hash_pool_submit(FFHashPool *pool, const AVPacket *pkt, int key)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_hash_pool_flush(FFHashPool *pool)
+{
+    return 0;
+}
+
+void ff_hash_pool_free(FFHashPool **ppool)
+{
+}
+#endif
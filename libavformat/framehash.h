@@ -0,0 +1,66 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_FRAMEHASH_H
+#define AVFORMAT_FRAMEHASH_H
+
+#include "libavutil/bprint.h"
+#include "libavcodec/packet.h"
+#include "avformat.h"
+
+/**
+ * Pool of threads hashing the packets of the hash muxers. The output
+ * lines of the packets are written in the order the packets were given.
+ */
+typedef struct FFHashPool FFHashPool;
+
+/**
+ * Hash one packet; called from the pool threads.
+ *
+ * @param thread index of the calling thread, less than the nb_threads
+ *               given to ff_hash_pool_init()
+ * @param line   where to print the output line of the packet, if any
+ * @return 0 or a negative error code
+ */
+typedef int (*FFHashPacketFunc)(AVFormatContext *s, int thread,
+                                const AVPacket *pkt, AVBPrint *line);
+
+/**
+ * @return 0 on success, AVERROR(ENOSYS) if built without thread support,
+ *         or another negative error code
+ */
+int ff_hash_pool_init(AVFormatContext *s, FFHashPool **ppool,
+                      int nb_threads, FFHashPacketFunc hash_packet);
+
+/**
+ * Queue a packet for hashing and write the lines of the packets hashed so
+ * far. Packets with the same non-negative key are hashed one at a time,
+ * in order; packets with a negative key may be hashed concurrently.
+ *
+ * @return 0 or the error of a previous packet
+ */
+int ff_hash_pool_submit(FFHashPool *pool, const AVPacket *pkt, int key);
+
+/**
+ * Wait for all the queued packets and write their lines.
+ */
+int ff_hash_pool_flush(FFHashPool *pool);
+
+void ff_hash_pool_free(FFHashPool **ppool);
+
+#endif /* AVFORMAT_FRAMEHASH_H */
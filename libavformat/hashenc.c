@@ -22,19 +22,24 @@
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
 #include "libavutil/hash.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
+#include "framehash.h"
 #include "internal.h"
 #include "mux.h"
 
 struct HashContext {
     const AVClass *avclass;
     struct AVHashContext **hashes;
+    int nb_hashes;
     char *hash_name;
     int per_stream;
     int format_version;
+    int hash_threads;
+    FFHashPool *pool;
 };
 
 #define OFFSET(x) offsetof(struct HashContext, x)
@@ -43,10 +48,13 @@ struct HashContext {
     { "hash", "set hash to use", OFFSET(hash_name), AV_OPT_TYPE_STRING, {.str = defaulttype}, 0, 0, ENC }
 #define FORMAT_VERSION_OPT \
     { "format_version", "file format version", OFFSET(format_version), AV_OPT_TYPE_INT, {.i64 = 2}, 1, 2, ENC }
+#define HASH_THREADS_OPT \
+    { "hash_threads", "number of threads hashing the packets", OFFSET(hash_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, ENC }
 
 #if CONFIG_HASH_MUXER || CONFIG_STREAMHASH_MUXER
 static const AVOption hash_streamhash_options[] = {
     HASH_OPT("sha256"),
+    HASH_THREADS_OPT,
     { NULL },
 };
 
@@ -62,6 +70,7 @@ static const AVClass hash_streamhashenc_class = {
 static const AVOption framehash_options[] = {
     HASH_OPT("sha256"),
     FORMAT_VERSION_OPT,
+    HASH_THREADS_OPT,
     { NULL },
 };
 #endif
@@ -69,6 +78,7 @@ static const AVOption framehash_options[] = {
 #if CONFIG_MD5_MUXER
 static const AVOption md5_options[] = {
     HASH_OPT("md5"),
+    HASH_THREADS_OPT,
     { NULL },
 };
 #endif
@@ -77,10 +87,37 @@ static const AVOption md5_options[] = {
 static const AVOption framemd5_options[] = {
     HASH_OPT("md5"),
     FORMAT_VERSION_OPT,
+    HASH_THREADS_OPT,
     { NULL },
 };
 #endif
 
+static int hash_start_pool(struct AVFormatContext *s, FFHashPacketFunc hash_packet)
+{
+    struct HashContext *c = s->priv_data;
+    int ret;
+
+    if (!c->hash_threads)
+        return 0;
+    ret = ff_hash_pool_init(s, &c->pool, c->hash_threads, hash_packet);
+    if (ret == AVERROR(ENOSYS)) {
+        av_log(s, AV_LOG_WARNING, "Built without thread support, "
+               "hashing from the muxing thread\n");
+        return 0;
+    }
+    return ret;
+}
+
+#if CONFIG_HASH_MUXER || CONFIG_MD5_MUXER || CONFIG_STREAMHASH_MUXER
+static int hash_update_packet(struct AVFormatContext *s, int thread,
+                              const AVPacket *pkt, AVBPrint *line)
+{
+    struct HashContext *c = s->priv_data;
+    av_hash_update(c->hashes[c->per_stream ? pkt->stream_index : 0], pkt->data, pkt->size);
+    return 0;
+}
+#endif
+
 #if CONFIG_HASH_MUXER || CONFIG_MD5_MUXER
 static int hash_init(struct AVFormatContext *s)
 {
@@ -90,11 +127,12 @@ static int hash_init(struct AVFormatContext *s)
     c->hashes = av_mallocz(sizeof(*c->hashes));
     if (!c->hashes)
         return AVERROR(ENOMEM);
+    c->nb_hashes = 1;
     res = av_hash_alloc(&c->hashes[0], c->hash_name);
     if (res < 0)
         return res;
     av_hash_init(c->hashes[0]);
-    return 0;
+    return hash_start_pool(s, hash_update_packet);
 }
 #endif
 
@@ -107,6 +145,7 @@ static int streamhash_init(struct AVFormatContext *s)
     c->hashes = av_calloc(s->nb_streams, sizeof(*c->hashes));
     if (!c->hashes)
         return AVERROR(ENOMEM);
+    c->nb_hashes = s->nb_streams;
     for (i = 0; i < s->nb_streams; i++) {
         res = av_hash_alloc(&c->hashes[i], c->hash_name);
         if (res < 0) {
@@ -114,7 +153,7 @@ static int streamhash_init(struct AVFormatContext *s)
         }
         av_hash_init(c->hashes[i]);
     }
-    return 0;
+    return hash_start_pool(s, hash_update_packet);
 }
 #endif
 
@@ -134,15 +173,21 @@ static char get_media_type_char(enum AVMediaType type)
 static int hash_write_packet(struct AVFormatContext *s, AVPacket *pkt)
 {
     struct HashContext *c = s->priv_data;
-    av_hash_update(c->hashes[c->per_stream ? pkt->stream_index : 0], pkt->data, pkt->size);
-    return 0;
+    /* packets of the same hash must be hashed in order */
+    if (c->pool)
+        return ff_hash_pool_submit(c->pool, pkt, c->per_stream ? pkt->stream_index : 0);
+    return hash_update_packet(s, 0, pkt, NULL);
 }
 
 static int hash_write_trailer(struct AVFormatContext *s)
 {
     struct HashContext *c = s->priv_data;
-    int num_hashes = c->per_stream ? s->nb_streams : 1;
-    for (int i = 0; i < num_hashes; i++) {
+    if (c->pool) {
+        int ret = ff_hash_pool_flush(c->pool);
+        if (ret < 0)
+            return ret;
+    }
+    for (int i = 0; i < c->nb_hashes; i++) {
         char buf[AV_HASH_MAX_SIZE*2+128];
         if (c->per_stream) {
             AVStream *st = s->streams[i];
@@ -163,9 +208,9 @@ static int hash_write_trailer(struct AVFormatContext *s)
 static void hash_free(struct AVFormatContext *s)
 {
     struct HashContext *c = s->priv_data;
+    ff_hash_pool_free(&c->pool);
     if (c->hashes) {
-        int num_hashes = c->per_stream ? s->nb_streams : 1;
-        for (int i = 0; i < num_hashes; i++) {
+        for (int i = 0; i < c->nb_hashes; i++) {
             av_hash_freep(&c->hashes[i]);
         }
     }
@@ -252,18 +297,25 @@ static void framehash_print_extradata(struct AVFormatContext *s)
     }
 }
 
+static int framehash_hash_packet(struct AVFormatContext *s, int thread,
+                                 const AVPacket *pkt, AVBPrint *line);
+
 static int framehash_init(struct AVFormatContext *s)
 {
     int res;
     struct HashContext *c = s->priv_data;
     c->per_stream = 0;
-    c->hashes = av_mallocz(sizeof(*c->hashes));
+    /* one hash per thread, the frames are hashed independently */
+    c->hashes = av_calloc(FFMAX(c->hash_threads, 1), sizeof(*c->hashes));
     if (!c->hashes)
         return AVERROR(ENOMEM);
-    res = av_hash_alloc(&c->hashes[0], c->hash_name);
-    if (res < 0)
-        return res;
-    return 0;
+    c->nb_hashes = FFMAX(c->hash_threads, 1);
+    for (int i = 0; i < c->nb_hashes; i++) {
+        res = av_hash_alloc(&c->hashes[i], c->hash_name);
+        if (res < 0)
+            return res;
+    }
+    return hash_start_pool(s, framehash_hash_packet);
 }
 
 static int framehash_write_header(struct AVFormatContext *s)
@@ -278,43 +330,70 @@ static int framehash_write_header(struct AVFormatContext *s)
     return 0;
 }
 
-static int framehash_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+static int framehash_hash_packet(struct AVFormatContext *s, int thread,
+                                 const AVPacket *pkt, AVBPrint *line)
 {
     struct HashContext *c = s->priv_data;
+    struct AVHashContext *hash = c->hashes[thread];
     char buf[AV_HASH_MAX_SIZE*2+128];
     int len;
-    av_hash_init(c->hashes[0]);
-    av_hash_update(c->hashes[0], pkt->data, pkt->size);
+    av_hash_init(hash);
+    av_hash_update(hash, pkt->data, pkt->size);
 
     snprintf(buf, sizeof(buf) - (AV_HASH_MAX_SIZE * 2 + 1), "%d, %10"PRId64", %10"PRId64", %8"PRId64", %8d, ",
              pkt->stream_index, pkt->dts, pkt->pts, pkt->duration, pkt->size);
     len = strlen(buf);
-    av_hash_final_hex(c->hashes[0], buf + len, sizeof(buf) - len);
-    avio_write(s->pb, buf, strlen(buf));
+    av_hash_final_hex(hash, buf + len, sizeof(buf) - len);
+    av_bprintf(line, "%s", buf);
 
     if (c->format_version > 1 && pkt->side_data_elems) {
         int i;
-        avio_printf(s->pb, ", S=%d", pkt->side_data_elems);
+        av_bprintf(line, ", S=%d", pkt->side_data_elems);
         for (i = 0; i < pkt->side_data_elems; i++) {
-            av_hash_init(c->hashes[0]);
+            av_hash_init(hash);
             if (HAVE_BIGENDIAN && pkt->side_data[i].type == AV_PKT_DATA_PALETTE) {
                 for (size_t j = 0; j < pkt->side_data[i].size; j += sizeof(uint32_t)) {
                     uint32_t data = AV_RL32(pkt->side_data[i].data + j);
-                    av_hash_update(c->hashes[0], (uint8_t *)&data, sizeof(uint32_t));
+                    av_hash_update(hash, (uint8_t *)&data, sizeof(uint32_t));
                 }
             } else
-                av_hash_update(c->hashes[0], pkt->side_data[i].data, pkt->side_data[i].size);
+                av_hash_update(hash, pkt->side_data[i].data, pkt->side_data[i].size);
             snprintf(buf, sizeof(buf) - (AV_HASH_MAX_SIZE * 2 + 1),
                      ", %8"SIZE_SPECIFIER", ", pkt->side_data[i].size);
             len = strlen(buf);
-            av_hash_final_hex(c->hashes[0], buf + len, sizeof(buf) - len);
-            avio_write(s->pb, buf, strlen(buf));
+            av_hash_final_hex(hash, buf + len, sizeof(buf) - len);
+            av_bprintf(line, "%s", buf);
         }
     }
 
-    avio_printf(s->pb, "\n");
+    av_bprintf(line, "\n");
     return 0;
 }
+
+static int framehash_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+{
+    struct HashContext *c = s->priv_data;
+    AVBPrint line;
+    int ret;
+
+    if (c->pool)
+        return ff_hash_pool_submit(c->pool, pkt, -1);
+
+    av_bprint_init(&line, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = framehash_hash_packet(s, 0, pkt, &line);
+    if (ret >= 0 && !av_bprint_is_complete(&line))
+        ret = AVERROR(ENOMEM);
+    if (ret >= 0)
+        avio_write(s->pb, line.str, line.len);
+    av_bprint_finalize(&line, NULL);
+    return ret;
+}
+
+static int framehash_write_trailer(struct AVFormatContext *s)
+{
+    struct HashContext *c = s->priv_data;
+    return c->pool ? ff_hash_pool_flush(c->pool) : 0;
+}
 #endif
 
 #if CONFIG_FRAMEHASH_MUXER
@@ -334,6 +413,7 @@ const FFOutputFormat ff_framehash_muxer = {
     .init              = framehash_init,
     .write_header      = framehash_write_header,
     .write_packet      = framehash_write_packet,
+    .write_trailer     = framehash_write_trailer,
     .deinit            = hash_free,
     .p.flags           = AVFMT_VARIABLE_FPS | AVFMT_TS_NONSTRICT |
                          AVFMT_TS_NEGATIVE,
@@ -358,6 +438,7 @@ const FFOutputFormat ff_framemd5_muxer = {
     .init              = framehash_init,
     .write_header      = framehash_write_header,
     .write_packet      = framehash_write_packet,
+    .write_trailer     = framehash_write_trailer,
     .deinit            = hash_free,
     .p.flags           = AVFMT_VARIABLE_FPS | AVFMT_TS_NONSTRICT |
                          AVFMT_TS_NEGATIVE,
@@ -74,6 +74,14 @@ typedef enum {
 #define HLS_MICROSECOND_UNIT   1000000
 #define BUFSIZE (16 * 1024)
 #define POSTFIX_PATTERN "_%d"
+#define STYP_SIZE 24
+
+typedef struct HLSPart {
+    double duration; /* in seconds */
+    int64_t pos;
+    int64_t size;
+    int independent;
+} HLSPart;
 
 typedef struct HLSSegment {
     char filename[MAX_URL_SIZE];
@@ -89,6 +97,9 @@ typedef struct HLSSegment {
     char key_uri[LINE_BUFFER_SIZE + 1];
     char iv_string[KEYSIZE*2 + 1];
 
+    HLSPart *parts;  /* partial segments, only kept near the live edge */
+    int nb_parts;
+
     struct HLSSegment *next;
     double discont_program_date_time;
 } HLSSegment;
@@ -110,6 +121,7 @@ typedef enum HLSFlags {
     HLS_PERIODIC_REKEY = (1 << 12),
     HLS_INDEPENDENT_SEGMENTS = (1 << 13),
     HLS_I_FRAMES_ONLY = (1 << 14),
+    HLS_BLOCKING_RELOAD = (1 << 15),
 } HLSFlags;
 
 typedef enum {
@@ -155,6 +167,12 @@ typedef struct VariantStream {
     HLSSegment *last_segment;
     HLSSegment *old_segments;
 
+    HLSPart *parts;       // partial segments of the segment being written
+    int nb_parts;
+    int64_t part_end_pts; // pts at which the current partial segment started
+    int64_t part_pos;     // write position of the next partial segment
+    int part_independent;
+
     char *basename_tmp;
     char *basename;
     char *vtt_basename;
@@ -200,6 +218,7 @@ typedef struct HLSContext {
 
     int64_t time;          // Set by a private option.
     int64_t init_time;     // Set by a private option.
+    int64_t part_time;     // Set by a private option.
     int max_nb_segments;   // Set by a private option.
     int hls_delete_threshold; // Set by a private option.
     uint32_t flags;        // enum HLSFlags
@@ -689,6 +708,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         av_bprint_clear(&path);
         previous_segment = segment;
         segment = previous_segment->next;
+        av_freep(&previous_segment->parts);
         av_freep(&previous_segment);
     }
 
@@ -966,6 +986,25 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
+/* Partial segments only need to be advertised for the segments close to the
+ * live edge, drop the ones more than three target durations away from it. */
+static void hls_trim_parts(HLSContext *hls, VariantStream *vs)
+{
+    HLSSegment *en;
+    double remaining = 0;
+
+    for (en = vs->segments; en; en = en->next)
+        remaining += en->duration;
+
+    for (en = vs->segments; en; en = en->next) {
+        remaining -= en->duration;
+        if (remaining < 3.0 * hls->time / AV_TIME_BASE)
+            break;
+        av_freep(&en->parts);
+        en->nb_parts = 0;
+    }
+}
+
 static HLSSegment *find_segment_by_filename(HLSSegment *segment, const char *filename)
 {
     while (segment) {
@@ -1122,6 +1161,7 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
     if (!en)
         return AVERROR(ENOMEM);
 
+    en->parts = NULL;
     en->var_stream_idx = vs->var_stream_idx;
     ret = sls_flags_filename_process(s, hls, vs, en, duration, pos, size);
     if (ret < 0) {
@@ -1153,6 +1193,10 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
     en->next     = NULL;
     en->discont  = 0;
     en->discont_program_date_time = 0;
+    en->parts    = vs->parts;
+    en->nb_parts = vs->nb_parts;
+    vs->parts    = NULL;
+    vs->nb_parts = 0;
 
     if (vs->discontinuity) {
         en->discont = 1;
@@ -1186,11 +1230,16 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
             vs->old_segments = en;
             if ((ret = hls_delete_old_segments(s, hls, vs)) < 0)
                 return ret;
-        } else
+        } else {
+            av_freep(&en->parts);
             av_freep(&en);
+        }
     } else
         vs->nb_entries++;
 
+    if (hls->part_time > 0)
+        hls_trim_parts(hls, vs);
+
     if (hls->max_seg_size > 0) {
         return 0;
     }
@@ -1319,6 +1368,7 @@ static void hls_free_segments(HLSSegment *p)
     while (p) {
         en = p;
         p = p->next;
+        av_freep(&en->parts);
         av_freep(&en);
     }
 }
@@ -1545,7 +1595,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     HLSContext *hls = s->priv_data;
     HLSSegment *en;
     int target_duration = 0;
-    int ret = 0;
+    int ret = 0, i;
     char temp_filename[MAX_URL_SIZE];
     char temp_vtt_filename[MAX_URL_SIZE];
     int64_t sequence = FFMAX(hls->start_sequence, vs->sequence - vs->nb_entries);
@@ -1559,6 +1609,9 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     double prog_date_time = vs->initial_prog_date_time;
     double *prog_date_time_p = (hls->flags & HLS_PROGRAM_DATE_TIME) ? &prog_date_time : NULL;
     int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
+    /* vs->out may still hold the segment being written in low-latency mode */
+    int m3u8_out = byterange_mode || hls->part_time > 0;
+    const char *part_filename = NULL;
 
     hls->version = 2;
     if (!(hls->flags & HLS_ROUND_DURATIONS)) {
@@ -1587,7 +1640,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", vs->m3u8_name);
-    if ((ret = hlsenc_io_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
+    if ((ret = hlsenc_io_open(s, m3u8_out ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
         if (hls->ignore_io_errors)
             ret = 0;
         goto fail;
@@ -1599,33 +1652,41 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     }
 
     vs->discontinuity_set = 0;
-    ff_hls_write_playlist_header(byterange_mode ? hls->m3u8_out : vs->out, hls->version, hls->allowcache,
+    ff_hls_write_playlist_header(m3u8_out ? hls->m3u8_out : vs->out, hls->version, hls->allowcache,
                                  target_duration, sequence, hls->pl_type, hls->flags & HLS_I_FRAMES_ONLY);
 
     if ((hls->flags & HLS_DISCONT_START) && sequence==hls->start_sequence && vs->discontinuity_set==0) {
-        avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-DISCONTINUITY\n");
+        avio_printf(m3u8_out ? hls->m3u8_out : vs->out, "#EXT-X-DISCONTINUITY\n");
         vs->discontinuity_set = 1;
     }
     if (vs->has_video && (hls->flags & HLS_INDEPENDENT_SEGMENTS)) {
-        avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-INDEPENDENT-SEGMENTS\n");
+        avio_printf(m3u8_out ? hls->m3u8_out : vs->out, "#EXT-X-INDEPENDENT-SEGMENTS\n");
     }
+    if (hls->part_time > 0)
+        ff_hls_write_part_info(hls->m3u8_out, (double)hls->part_time / AV_TIME_BASE,
+                               hls->flags & HLS_BLOCKING_RELOAD);
     for (en = vs->segments; en; en = en->next) {
         if ((hls->encrypt || hls->key_info_file) && (!key_uri || strcmp(en->key_uri, key_uri) ||
                                     av_strcasecmp(en->iv_string, iv_string))) {
-            avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"", en->key_uri);
+            avio_printf(m3u8_out ? hls->m3u8_out : vs->out, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"", en->key_uri);
             if (*en->iv_string)
-                avio_printf(byterange_mode ? hls->m3u8_out : vs->out, ",IV=0x%s", en->iv_string);
-            avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "\n");
+                avio_printf(m3u8_out ? hls->m3u8_out : vs->out, ",IV=0x%s", en->iv_string);
+            avio_printf(m3u8_out ? hls->m3u8_out : vs->out, "\n");
             key_uri = en->key_uri;
             iv_string = en->iv_string;
         }
 
         if ((hls->segment_type == SEGMENT_TYPE_FMP4) && (en == vs->segments)) {
-            ff_hls_write_init_file(byterange_mode ? hls->m3u8_out : vs->out, (hls->flags & HLS_SINGLE_FILE) ? en->filename : vs->fmp4_init_filename,
+            ff_hls_write_init_file(m3u8_out ? hls->m3u8_out : vs->out, (hls->flags & HLS_SINGLE_FILE) ? en->filename : vs->fmp4_init_filename,
                                    hls->flags & HLS_SINGLE_FILE, vs->init_range_length, 0);
         }
 
-        ret = ff_hls_write_file_entry(byterange_mode ? hls->m3u8_out : vs->out, en->discont, byterange_mode,
+        /* the parts are only useful to clients while the playlist is live */
+        for (i = 0; (!last || (hls->flags & HLS_OMIT_ENDLIST)) && i < en->nb_parts; i++)
+            ff_hls_write_part(hls->m3u8_out, en->parts[i].duration, hls->baseurl, en->filename,
+                              en->parts[i].size, en->parts[i].pos, en->parts[i].independent);
+
+        ret = ff_hls_write_file_entry(m3u8_out ? hls->m3u8_out : vs->out, en->discont, byterange_mode,
                                       en->duration, hls->flags & HLS_ROUND_DURATIONS,
                                       en->size, en->pos, hls->baseurl,
                                       en->filename,
@@ -1638,8 +1699,16 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
         }
     }
 
+    if (hls->part_time > 0 && !last) {
+        part_filename = hls->use_localtime_mkdir ? vs->avf->url : av_basename(vs->avf->url);
+        for (i = 0; i < vs->nb_parts; i++)
+            ff_hls_write_part(hls->m3u8_out, vs->parts[i].duration, hls->baseurl, part_filename,
+                              vs->parts[i].size, vs->parts[i].pos, vs->parts[i].independent);
+        ff_hls_write_preload_hint(hls->m3u8_out, hls->baseurl, part_filename, vs->part_pos);
+    }
+
     if (last && (hls->flags & HLS_OMIT_ENDLIST)==0)
-        ff_hls_write_end_list(byterange_mode ? hls->m3u8_out : vs->out);
+        ff_hls_write_end_list(m3u8_out ? hls->m3u8_out : vs->out);
 
     if (vs->vtt_m3u8_name) {
         snprintf(temp_vtt_filename, sizeof(temp_vtt_filename), use_temp_file ? "%s.tmp" : "%s", vs->vtt_m3u8_name);
@@ -1666,7 +1735,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
 fail:
     av_dict_free(&options);
-    ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
+    ret = hlsenc_io_close(s, m3u8_out ? &hls->m3u8_out : &vs->out, temp_filename);
     if (ret < 0) {
         return ret;
     }
@@ -2410,6 +2479,100 @@ static int64_t append_single_file(AVFormatContext *s, VariantStream *vs)
 
     return ret;
 }
+
+static int hls_add_part(VariantStream *vs, double duration, int size)
+{
+    HLSPart *parts;
+
+    parts = av_realloc_array(vs->parts, vs->nb_parts + 1, sizeof(*vs->parts));
+    if (!parts)
+        return AVERROR(ENOMEM);
+    vs->parts = parts;
+    parts[vs->nb_parts].duration    = duration;
+    parts[vs->nb_parts].pos         = vs->part_pos;
+    parts[vs->nb_parts].size        = size;
+    parts[vs->nb_parts].independent = vs->part_independent;
+    vs->nb_parts++;
+    vs->part_pos += size;
+
+    return 0;
+}
+
+static int hls_flush_part(AVFormatContext *s, VariantStream *vs, double duration)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    int range_length = 0;
+    int ret;
+
+    /* The segment file stays open while its partial segments are written,
+     * every part is a byte range of it. */
+    if (!vs->out) {
+        AVDictionary *options = NULL;
+
+        set_http_options(s, &options, hls);
+        ret = hlsenc_io_open(s, &vs->out, oc->url, &options);
+        av_dict_free(&options);
+        if (ret < 0) {
+            av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+                   "Failed to open file '%s'\n", oc->url);
+            return hls->ignore_io_errors ? 0 : ret;
+        }
+        write_styp(vs->out);
+        vs->part_pos = STYP_SIZE;
+    }
+
+    ret = flush_dynbuf(vs, &range_length);
+    av_freep(&vs->temp_buffer);
+    if (ret < 0)
+        return ret;
+    if (!range_length)
+        return 0;
+
+    return hls_add_part(vs, duration, range_length);
+}
+
+/**
+ * Move the initialization segment, which the first flush of the mp4 muxer
+ * writes on its own thanks to delay_moov, from the dynamic buffer to the
+ * init file.
+ */
+static int hls_write_init_segment(AVFormatContext *s, VariantStream *vs)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
+    int range_length;
+
+    range_length = avio_close_dyn_buf(oc->pb, &vs->init_buffer);
+    oc->pb = NULL;
+    if (range_length <= 0)
+        return AVERROR(EINVAL);
+    avio_write(vs->out, vs->init_buffer, range_length);
+    if (!hls->resend_init_file)
+        av_freep(&vs->init_buffer);
+    vs->init_range_length = range_length;
+    vs->packets_written = 0;
+    vs->start_pos = range_length;
+    if (!byterange_mode) {
+        hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
+    }
+    return avio_open_dyn_buf(&oc->pb);
+}
+
+static int hls_part_window(AVFormatContext *s, VariantStream *vs)
+{
+    HLSContext *hls = s->priv_data;
+    int ret;
+
+    if ((ret = hls_window(s, 0, vs)) < 0) {
+        av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
+        ff_format_io_close(s, &hls->m3u8_out);
+        ret = hls_window(s, 0, vs);
+    }
+    return ret;
+}
+
 static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     HLSContext *hls = s->priv_data;
@@ -2512,19 +2675,9 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         avio_flush(oc->pb);
         if (hls->segment_type == SEGMENT_TYPE_FMP4) {
             if (!vs->init_range_length) {
-                range_length = avio_close_dyn_buf(oc->pb, &vs->init_buffer);
-                if (range_length <= 0)
-                    return AVERROR(EINVAL);
-                avio_write(vs->out, vs->init_buffer, range_length);
-                if (!hls->resend_init_file)
-                    av_freep(&vs->init_buffer);
-                vs->init_range_length = range_length;
-                avio_open_dyn_buf(&oc->pb);
-                vs->packets_written = 0;
-                vs->start_pos = range_length;
-                if (!byterange_mode) {
-                    hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
-                }
+                ret = hls_write_init_segment(s, vs);
+                if (ret < 0)
+                    return ret;
             }
         }
         if (!byterange_mode) {
@@ -2549,7 +2702,17 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                                       && (hls->flags & HLS_TEMP_FILE);
             }
 
-            if ((hls->max_seg_size > 0 && (vs->size + vs->start_pos >= hls->max_seg_size)) || !byterange_mode) {
+            if (hls->part_time > 0 && vs->out) {
+                double part_duration = (double)(pkt->pts - vs->part_end_pts) * st->time_base.num / st->time_base.den;
+
+                ret = hls_flush_part(s, vs, part_duration);
+                if (ret < 0)
+                    return ret;
+                vs->size = vs->part_pos;
+                ret = hlsenc_io_close(s, &vs->out, oc->url);
+                if (ret < 0)
+                    av_log(s, AV_LOG_WARNING, "upload segment '%s' failed\n", oc->url);
+            } else if ((hls->max_seg_size > 0 && (vs->size + vs->start_pos >= hls->max_seg_size)) || !byterange_mode) {
                 AVDictionary *options = NULL;
                 char *filename = NULL;
                 if (hls->key_info_file || hls->encrypt) {
@@ -2622,7 +2785,8 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
 
         // if we're building a VOD playlist, skip writing the manifest multiple times, and just wait until the end
-        if (hls->pl_type != PLAYLIST_TYPE_VOD) {
+        // in low-latency mode it is refreshed once the next segment is started, to hint its first part
+        if (hls->pl_type != PLAYLIST_TYPE_VOD && !hls->part_time) {
             if ((ret = hls_window(s, 0, vs)) < 0) {
                 av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
                 ff_format_io_close(s, &vs->out);
@@ -2670,6 +2834,39 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         if (ret < 0) {
             return ret;
         }
+
+        if (hls->part_time > 0) {
+            vs->part_end_pts     = pkt->pts;
+            vs->part_pos         = STYP_SIZE;
+            vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+            if ((ret = hls_part_window(s, vs)) < 0)
+                return ret;
+        }
+    } else if (hls->part_time > 0 && is_ref_pkt && vs->part_end_pts == AV_NOPTS_VALUE) {
+        /* first part of the first segment */
+        vs->part_end_pts     = pkt->pts;
+        vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+    } else if (hls->part_time > 0 && is_ref_pkt &&
+               pkt->pts > vs->part_end_pts &&
+               av_compare_ts(pkt->pts + pkt->duration - vs->part_end_pts, st->time_base,
+                             hls->part_time, AV_TIME_BASE_Q) > 0) {
+        /* Cut before the packet that would make the part exceed its target duration */
+        double part_duration = (double)(pkt->pts - vs->part_end_pts) * st->time_base.num / st->time_base.den;
+
+        if (!vs->init_range_length) {
+            /* the first flush only writes the delayed moov */
+            av_write_frame(oc, NULL);
+            ret = hls_write_init_segment(s, vs);
+            if (ret < 0)
+                return ret;
+        }
+        ret = hls_flush_part(s, vs, part_duration);
+        if (ret < 0)
+            return ret;
+        vs->part_end_pts     = pkt->pts;
+        vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+        if ((ret = hls_part_window(s, vs)) < 0)
+            return ret;
     }
 
     vs->packets_written++;
@@ -2709,6 +2906,7 @@ static void hls_deinit(AVFormatContext *s)
             av_freep(&vs->init_buffer);
         hls_free_segments(vs->segments);
         hls_free_segments(vs->old_segments);
+        av_freep(&vs->parts);
         av_freep(&vs->m3u8_name);
         av_freep(&vs->streams);
     }
@@ -2779,7 +2977,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
                 }
             }
         }
-        if (!(hls->flags & HLS_SINGLE_FILE)) {
+        if (!(hls->flags & HLS_SINGLE_FILE) && !(hls->part_time > 0 && vs->out)) {
             set_http_options(s, &options, hls);
             ret = hlsenc_io_open(s, &vs->out, filename, &options);
             if (ret < 0) {
@@ -2794,6 +2992,16 @@ static int hls_write_trailer(struct AVFormatContext *s)
             goto failed;
 
         vs->size = range_length;
+        if (vs->nb_parts) {
+            double part_duration = vs->duration + vs->dpp;
+
+            /* the rest of the segment is its last part */
+            for (int j = 0; j < vs->nb_parts; j++)
+                part_duration -= vs->parts[j].duration;
+            vs->size += vs->part_pos;
+            if (range_length && (ret = hls_add_part(vs, part_duration, range_length)) < 0)
+                goto failed;
+        }
         ret = hlsenc_io_close(s, &vs->out, filename);
         if (ret < 0) {
             av_log(s, AV_LOG_WARNING, "upload segment failed, will retry with a new http session.\n");
@@ -2949,6 +3157,27 @@ static int hls_init(AVFormatContext *s)
 
     hls->recording_time = hls->init_time && hls->max_nb_segments > 0 ? hls->init_time : hls->time;
 
+    if (hls->part_time > 0) {
+        if (hls->segment_type != SEGMENT_TYPE_FMP4) {
+            av_log(s, AV_LOG_ERROR, "Partial segments require hls_segment_type fmp4\n");
+            return AVERROR(EINVAL);
+        }
+        if ((hls->flags & (HLS_SINGLE_FILE | HLS_TEMP_FILE)) || hls->max_seg_size > 0 ||
+            hls->key_info_file || hls->encrypt) {
+            av_log(s, AV_LOG_ERROR, "Partial segments cannot be combined with single_file, "
+                   "temp_file, hls_segment_size or encryption\n");
+            return AVERROR(EINVAL);
+        }
+        if (hls->pl_type == PLAYLIST_TYPE_VOD) {
+            av_log(s, AV_LOG_ERROR, "Partial segments are not supported for VOD playlists\n");
+            return AVERROR(EINVAL);
+        }
+        if (hls->part_time > hls->time) {
+            av_log(s, AV_LOG_ERROR, "hls_part_time must not be larger than hls_time\n");
+            return AVERROR(EINVAL);
+        }
+    }
+
     if (hls->flags & HLS_SPLIT_BY_TIME && hls->flags & HLS_INDEPENDENT_SEGMENTS) {
         // Independent segments cannot be guaranteed when splitting by time
         hls->flags &= ~HLS_INDEPENDENT_SEGMENTS;
@@ -2967,6 +3196,7 @@ static int hls_init(AVFormatContext *s)
         vs->sequence  = hls->start_sequence;
         vs->start_pts = AV_NOPTS_VALUE;
         vs->end_pts   = AV_NOPTS_VALUE;
+        vs->part_end_pts = AV_NOPTS_VALUE;
         vs->current_segment_final_filename_fmt[0] = '\0';
         vs->initial_prog_date_time = initial_program_date_time;
 
@@ -3118,6 +3348,7 @@ static const AVOption options[] = {
     {"start_number",  "set first number in the sequence",        OFFSET(start_sequence),AV_OPT_TYPE_INT64,  {.i64 = 0},     0, INT64_MAX, E},
     {"hls_time",      "set segment length",                      OFFSET(time),          AV_OPT_TYPE_DURATION, {.i64 = 2000000}, 0, INT64_MAX, E},
     {"hls_init_time", "set segment length at init list",         OFFSET(init_time),     AV_OPT_TYPE_DURATION, {.i64 = 0},       0, INT64_MAX, E},
+    {"hls_part_time", "set partial segment length for low-latency HLS", OFFSET(part_time), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, E},
     {"hls_list_size", "set maximum number of playlist entries",  OFFSET(max_nb_segments),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_delete_threshold", "set number of unreferenced segments to keep before deleting",  OFFSET(hls_delete_threshold),    AV_OPT_TYPE_INT,    {.i64 = 1},     1, INT_MAX, E},
     {"hls_vtt_options","set hls vtt list of options for the container format used for hls", OFFSET(vtt_format_options_str), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,    E},
@@ -3153,6 +3384,7 @@ static const AVOption options[] = {
     {"periodic_rekey", "reload keyinfo file periodically for re-keying", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_PERIODIC_REKEY }, 0, UINT_MAX,   E, "flags"},
     {"independent_segments", "add EXT-X-INDEPENDENT-SEGMENTS, whenever applicable", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_INDEPENDENT_SEGMENTS }, 0, UINT_MAX, E, "flags"},
     {"iframes_only", "add EXT-X-I-FRAMES-ONLY, whenever applicable", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_I_FRAMES_ONLY }, 0, UINT_MAX, E, "flags"},
+    {"blocking_reload", "advertise CAN-BLOCK-RELOAD when partial segments are enabled", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_BLOCKING_RELOAD }, 0, UINT_MAX, E, "flags"},
     {"strftime", "set filename expansion with strftime at segment creation", OFFSET(use_localtime), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
     {"strftime_mkdir", "create last directory component in strftime-generated filename", OFFSET(use_localtime_mkdir), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
     {"hls_playlist_type", "set the HLS playlist type", OFFSET(pl_type), AV_OPT_TYPE_INT, {.i64 = PLAYLIST_TYPE_NONE }, 0, PLAYLIST_TYPE_NB-1, E, "pl_type" },
@@ -186,6 +186,43 @@ int ff_hls_write_file_entry(AVIOContext *out, int insert_discont,
     return 0;
 }
 
+void ff_hls_write_part_info(AVIOContext *out, double part_target,
+                            int can_block_reload)
+{
+    if (!out)
+        return;
+    /* PART-HOLD-BACK must be at least twice the part target duration,
+     * three times is what the specification recommends. */
+    avio_printf(out, "#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK=%f\n",
+                can_block_reload ? "CAN-BLOCK-RELOAD=YES," : "", 3 * part_target);
+    avio_printf(out, "#EXT-X-PART-INF:PART-TARGET=%f\n", part_target);
+}
+
+void ff_hls_write_part(AVIOContext *out, double duration, const char *baseurl,
+                       const char *filename, int64_t size, int64_t pos,
+                       int independent)
+{
+    if (!out || !filename)
+        return;
+
+    avio_printf(out, "#EXT-X-PART:DURATION=%f,URI=\"%s%s\"", duration,
+                baseurl ? baseurl : "", filename);
+    avio_printf(out, ",BYTERANGE=\"%"PRId64"@%"PRId64"\"", size, pos);
+    if (independent)
+        avio_printf(out, ",INDEPENDENT=YES");
+    avio_printf(out, "\n");
+}
+
+void ff_hls_write_preload_hint(AVIOContext *out, const char *baseurl,
+                               const char *filename, int64_t pos)
+{
+    if (!out || !filename)
+        return;
+
+    avio_printf(out, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s%s\",BYTERANGE-START=%"PRId64"\n",
+                baseurl ? baseurl : "", filename, pos);
+}
+
 void ff_hls_write_end_list(AVIOContext *out)
 {
     if (!out)
@@ -62,6 +62,8 @@ typedef struct VideoDemuxData {
     int frame_size;
     int ts_from_file;
     int export_path_metadata; /**< enabled when set to 1. */
+    int read_ahead;         /**< number of images read concurrently */
+    struct ImageReadAhead *ra;
 } VideoDemuxData;
 
 typedef struct IdStrMap {
@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "config_components.h"
 
 #define _DEFAULT_SOURCE
@@ -27,10 +28,12 @@
 #include <sys/stat.h>
 #include "libavutil/avstring.h"
 #include "libavutil/log.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -183,6 +186,261 @@ static int img_read_probe(const AVProbeData *p)
     return 0;
 }
 
+static int get_image_filename(VideoDemuxData *s, int number, char *buf, int size)
+{
+    if (s->pattern_type == PT_NONE) {
+        av_strlcpy(buf, s->path, size);
+    } else if (s->use_glob) {
+#if HAVE_GLOB
+        av_strlcpy(buf, s->globstate.gl_pathv[number], size);
+#endif
+    } else if (av_get_frame_filename(buf, size, s->path, number) < 0 && number > 1) {
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+enum ImageReadState {
+    IMAGE_QUEUED,
+    IMAGE_READING,
+    IMAGE_DONE,
+};
+
+typedef struct ImageReadJob {
+    int number;
+    enum ImageReadState state;
+    char filename[1024];
+    AVBufferRef *buf;
+    int size;               /**< file size */
+    int ret;                /**< avio_read() result or error code */
+    int open_failed;
+} ImageReadJob;
+
+typedef struct ImageReadAhead {
+    ImageReadJob *jobs;     /**< ring of the next images, in reading order */
+    int nb_jobs;
+    int first;
+    int count;
+    int next_number;        /**< next image to queue */
+    int queue_end;          /**< set when there is no more image to queue */
+
+    pthread_t *workers;
+    int nb_workers;
+    int workers_exit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+} ImageReadAhead;
+
+static void read_ahead_image(AVFormatContext *s1, ImageReadJob *job)
+{
+    AVIOContext *f = NULL;
+
+    if (s1->io_open(s1, &f, job->filename, AVIO_FLAG_READ, NULL) < 0) {
+        job->open_failed = 1;
+        job->ret = AVERROR(EIO);
+        return;
+    }
+    job->size = avio_size(f);
+
+    /* same limits as av_new_packet() */
+    if (job->size < 0 || job->size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        job->ret = AVERROR(EINVAL);
+    } else if (!(job->buf = av_buffer_alloc(job->size + AV_INPUT_BUFFER_PADDING_SIZE))) {
+        job->ret = AVERROR(ENOMEM);
+    } else {
+        int len;
+
+        job->ret = avio_read(f, job->buf->data, job->size);
+        len = FFMAX(job->ret, 0);
+        memset(job->buf->data + len, 0, job->buf->size - len);
+    }
+    ff_format_io_close(s1, &f);
+}
+
+static void *read_ahead_worker(void *arg)
+{
+    AVFormatContext *s1 = arg;
+    VideoDemuxData *s = s1->priv_data;
+    ImageReadAhead *ra = s->ra;
+
+    pthread_mutex_lock(&ra->lock);
+    while (!ra->workers_exit) {
+        ImageReadJob *job = NULL;
+
+        /* read the queued images in order */
+        for (int i = 0; i < ra->count; i++) {
+            ImageReadJob *j = &ra->jobs[(ra->first + i) % ra->nb_jobs];
+            if (j->state == IMAGE_QUEUED) {
+                job = j;
+                break;
+            }
+        }
+        if (!job) {
+            pthread_cond_wait(&ra->work_cond, &ra->lock);
+            continue;
+        }
+
+        job->state = IMAGE_READING;
+        pthread_mutex_unlock(&ra->lock);
+
+        read_ahead_image(s1, job);
+
+        pthread_mutex_lock(&ra->lock);
+        job->state = IMAGE_DONE;
+        pthread_cond_broadcast(&ra->done_cond);
+    }
+    pthread_mutex_unlock(&ra->lock);
+
+    return NULL;
+}
+
+/* Must be called with ra->lock held. */
+static void read_ahead_fill(VideoDemuxData *s, ImageReadAhead *ra)
+{
+    while (ra->count < ra->nb_jobs && !ra->queue_end) {
+        ImageReadJob *job = &ra->jobs[(ra->first + ra->count) % ra->nb_jobs];
+
+        if (get_image_filename(s, ra->next_number, job->filename, sizeof(job->filename)) < 0) {
+            ra->queue_end = 1;
+            break;
+        }
+        job->number      = ra->next_number;
+        job->state       = IMAGE_QUEUED;
+        job->buf         = NULL;
+        job->size        = 0;
+        job->ret         = 0;
+        job->open_failed = 0;
+        ra->count++;
+        pthread_cond_signal(&ra->work_cond);
+
+        if (++ra->next_number > s->img_last) {
+            if (s->loop)
+                ra->next_number = s->img_first;
+            else
+                ra->queue_end = 1;
+        }
+    }
+}
+
+/* Drop all the queued images, e.g. after a seek.
+ * Must be called with ra->lock held. */
+static void read_ahead_flush(ImageReadAhead *ra)
+{
+    int reading;
+
+    do {
+        reading = 0;
+        for (int i = 0; i < ra->count; i++) {
+            ImageReadJob *job = &ra->jobs[(ra->first + i) % ra->nb_jobs];
+            if (job->state == IMAGE_QUEUED)
+                job->state = IMAGE_DONE;
+            reading |= job->state == IMAGE_READING;
+        }
+        if (reading)
+            pthread_cond_wait(&ra->done_cond, &ra->lock);
+    } while (reading);
+
+    for (int i = 0; i < ra->count; i++)
+        av_buffer_unref(&ra->jobs[(ra->first + i) % ra->nb_jobs].buf);
+    ra->first = ra->count = 0;
+}
+
+static int read_ahead_get(AVFormatContext *s1, int number, ImageReadJob *out)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImageReadAhead *ra = s->ra;
+    ImageReadJob *job;
+    int ret = 0;
+
+    pthread_mutex_lock(&ra->lock);
+    if (ra->count && ra->jobs[ra->first].number != number)
+        read_ahead_flush(ra);
+    if (!ra->count) {
+        ra->next_number = number;
+        ra->queue_end   = 0;
+    }
+    read_ahead_fill(s, ra);
+
+    if (!ra->count) {
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    job = &ra->jobs[ra->first];
+    while (job->state != IMAGE_DONE)
+        pthread_cond_wait(&ra->done_cond, &ra->lock);
+
+    *out = *job;
+    job->buf = NULL;
+    ra->first = (ra->first + 1) % ra->nb_jobs;
+    ra->count--;
+    read_ahead_fill(s, ra);
+end:
+    pthread_mutex_unlock(&ra->lock);
+    return ret;
+}
+
+static void read_ahead_stop(VideoDemuxData *s)
+{
+    ImageReadAhead *ra = s->ra;
+
+    if (!ra)
+        return;
+
+    pthread_mutex_lock(&ra->lock);
+    ra->workers_exit = 1;
+    pthread_cond_broadcast(&ra->work_cond);
+    pthread_mutex_unlock(&ra->lock);
+
+    for (int i = 0; i < ra->nb_workers; i++)
+        pthread_join(ra->workers[i], NULL);
+    for (int i = 0; i < ra->count; i++)
+        av_buffer_unref(&ra->jobs[(ra->first + i) % ra->nb_jobs].buf);
+
+    pthread_cond_destroy(&ra->done_cond);
+    pthread_cond_destroy(&ra->work_cond);
+    pthread_mutex_destroy(&ra->lock);
+    av_freep(&ra->workers);
+    av_freep(&ra->jobs);
+    av_freep(&s->ra);
+}
+
+static int read_ahead_start(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImageReadAhead *ra;
+    int ret;
+
+    ra = s->ra = av_mallocz(sizeof(*ra));
+    if (!ra)
+        return AVERROR(ENOMEM);
+    ra->nb_jobs = s->read_ahead;
+    if (!FF_ALLOCZ_TYPED_ARRAY(ra->jobs,    ra->nb_jobs) ||
+        !FF_ALLOCZ_TYPED_ARRAY(ra->workers, ra->nb_jobs)) {
+        av_freep(&ra->jobs);
+        av_freep(&s->ra);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&ra->lock, NULL);
+    pthread_cond_init(&ra->work_cond, NULL);
+    pthread_cond_init(&ra->done_cond, NULL);
+
+    for (int i = 0; i < ra->nb_jobs; i++) {
+        ret = pthread_create(&ra->workers[i], NULL, read_ahead_worker, s1);
+        if (ret) {
+            av_log(s1, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            read_ahead_stop(s);
+            return AVERROR(ret);
+        }
+        ra->nb_workers++;
+    }
+    return 0;
+}
+#endif
+
 int ff_img_read_header(AVFormatContext *s1)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -377,6 +635,22 @@ int ff_img_read_header(AVFormatContext *s1)
         pix_fmt != AV_PIX_FMT_NONE)
         st->codecpar->format = pix_fmt;
 
+    if (s->read_ahead && !s->is_pipe) {
+        if (s1->pb || s->split_planes) {
+            av_log(s1, AV_LOG_WARNING, "read_ahead is not supported with "
+                   "split planes or a custom I/O context\n");
+        } else {
+#if HAVE_THREADS
+            int ret = read_ahead_start(s1);
+            if (ret < 0)
+                return ret;
+#else
+            av_log(s1, AV_LOG_WARNING, "Built without thread support, "
+                   "reading the images from the demuxing thread\n");
+#endif
+        }
+    }
+
     return 0;
 }
 
@@ -415,6 +689,9 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     int size[3]           = { 0 }, ret[3] = { 0 };
     AVIOContext *f[3]     = { NULL };
     AVCodecParameters *par = s1->streams[0]->codecpar;
+#if HAVE_THREADS
+    ImageReadJob ahead = { 0 };
+#endif
 
     if (!s->is_pipe) {
         /* loop over input */
@@ -423,18 +700,22 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
-        if (s->pattern_type == PT_NONE) {
-            av_strlcpy(filename_bytes, s->path, sizeof(filename_bytes));
-        } else if (s->use_glob) {
-#if HAVE_GLOB
-            filename = s->globstate.gl_pathv[s->img_number];
+        res = get_image_filename(s, s->img_number, filename_bytes, sizeof(filename_bytes));
+        if (res < 0)
+            return res;
+#if HAVE_THREADS
+        if (s->ra) {
+            res = read_ahead_get(s1, s->img_number, &ahead);
+            if (res < 0)
+                return res;
+            if (ahead.open_failed) {
+                av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n",
+                       filename);
+                return AVERROR(EIO);
+            }
+            size[0] = ahead.size;
+        } else
 #endif
-        } else {
-        if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
-                                  s->path,
-                                  s->img_number) < 0 && s->img_number > 1)
-            return AVERROR(EIO);
-        }
         for (i = 0; i < 3; i++) {
             if (s1->pb &&
                 !strcmp(filename_bytes, s->path) &&
@@ -462,11 +743,20 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
             int ret;
             int score = 0;
 
-            ret = avio_read(f[0], header, PROBE_BUF_MIN);
-            if (ret < 0)
-                return ret;
+#if HAVE_THREADS
+            if (s->ra) {
+                ret = ahead.buf ? FFMIN(FFMAX(ahead.ret, 0), PROBE_BUF_MIN) : 0;
+                if (ret)
+                    memcpy(header, ahead.buf->data, ret);
+            } else
+#endif
+            {
+                ret = avio_read(f[0], header, PROBE_BUF_MIN);
+                if (ret < 0)
+                    return ret;
+                avio_skip(f[0], -ret);
+            }
             memset(header + ret, 0, sizeof(header) - ret);
-            avio_skip(f[0], -ret);
             pd.buf = header;
             pd.buf_size = ret;
             pd.filename = filename;
@@ -493,9 +783,19 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
     }
 
-    res = av_new_packet(pkt, size[0] + size[1] + size[2]);
-    if (res < 0) {
-        goto fail;
+#if HAVE_THREADS
+    if (s->ra) {
+        /* the buffer is padded by the read-ahead thread */
+        pkt->buf  = ahead.buf;
+        pkt->data = ahead.buf ? ahead.buf->data : NULL;
+        ahead.buf = NULL;
+    } else
+#endif
+    {
+        res = av_new_packet(pkt, size[0] + size[1] + size[2]);
+        if (res < 0) {
+            goto fail;
+        }
     }
     pkt->stream_index = 0;
     pkt->flags       |= AV_PKT_FLAG_KEY;
@@ -530,6 +830,13 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     }
 
     pkt->size = 0;
+#if HAVE_THREADS
+    if (s->ra) {
+        ret[0] = ahead.ret;
+        if (ret[0] > 0)
+            pkt->size = ret[0];
+    }
+#endif
     for (i = 0; i < 3; i++) {
         if (f[i]) {
             ret[i] = avio_read(f[i], pkt->data + pkt->size, size[i]);
@@ -565,6 +872,9 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     }
 
 fail:
+#if HAVE_THREADS
+    av_buffer_unref(&ahead.buf);
+#endif
     if (!s->is_pipe) {
         for (i = 0; i < 3; i++) {
             if (f[i] != s1->pb)
@@ -576,8 +886,11 @@ fail:
 
 static int img_read_close(struct AVFormatContext* s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_THREADS
+    read_ahead_stop(s);
+#endif
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -628,6 +941,7 @@ const AVOption ff_img_options[] = {
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, "ts_type" },
     { "export_path_metadata", "enable metadata containing input path information", OFFSET(export_path_metadata), AV_OPT_TYPE_BOOL,   {.i64 = 0   }, 0, 1,       DEC }, \
+    { "read_ahead",   "set number of images read concurrently",  OFFSET(read_ahead),   AV_OPT_TYPE_INT,    {.i64 = 0   }, 0,     256,       DEC },
     COMMON_OPTIONS
 };
 
@@ -20,14 +20,18 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "config_components.h"
 
 #include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
 #include "libavutil/dict.h"
+#include "libavutil/fifo.h"
 #include "libavutil/log.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/time_internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -35,53 +39,44 @@
 #include "img2.h"
 #include "mux.h"
 
+typedef struct ImageWriteJob {
+    AVPacket *pkt;
+    char filename[1024];
+} ImageWriteJob;
+
 typedef struct VideoMuxData {
     const AVClass *class;  /**< Class for private options. */
     int start_img_number;
     int img_number;
     int split_planes;       /**< use independent file for each Y, U, V plane */
-    char tmp[4][1024];
-    char target[4][1024];
     int update;
     int use_strftime;
     int frame_pts;
     const char *muxer;
     int use_rename;
     AVDictionary *protocol_opts;
-} VideoMuxData;
+    int nb_threads;
 
-static int write_header(AVFormatContext *s)
-{
-    VideoMuxData *img = s->priv_data;
-    AVStream *st = s->streams[0];
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(st->codecpar->format);
-
-    if (st->codecpar->codec_id == AV_CODEC_ID_GIF) {
-        img->muxer = "gif";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_FITS) {
-        img->muxer = "fits";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_AV1) {
-        img->muxer = "avif";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_RAWVIDEO) {
-        const char *str = strrchr(s->url, '.');
-        img->split_planes =     str
-                             && !av_strcasecmp(str + 1, "y")
-                             && s->nb_streams == 1
-                             && desc
-                             &&(desc->flags & AV_PIX_FMT_FLAG_PLANAR)
-                             && desc->nb_components >= 3;
-    }
-    img->img_number = img->start_img_number;
-
-    return 0;
-}
+#if HAVE_THREADS
+    pthread_t *workers;
+    unsigned nb_workers;
+    AVFifo *jobs;           /**< ImageWriteJob queue */
+    unsigned nb_busy;
+    int error;
+    int workers_exit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+#endif
+} VideoMuxData;
 
-static int write_muxed_file(AVFormatContext *s, AVIOContext *pb, AVPacket *pkt)
+/* pkt2 is a scratch packet, it must not be shared by concurrent calls. */
+static int write_muxed_file(AVFormatContext *s, AVIOContext *pb, AVPacket *pkt,
+                            AVPacket *pkt2)
 {
     VideoMuxData *img = s->priv_data;
     AVCodecParameters *par = s->streams[pkt->stream_index]->codecpar;
     AVStream *st;
-    AVPacket *const pkt2 = ffformatcontext(s)->pkt;
     AVFormatContext *fmt = NULL;
     int ret;
 
@@ -118,7 +113,7 @@ static int write_packet_pipe(AVFormatContext *s, AVPacket *pkt)
 {
     VideoMuxData *img = s->priv_data;
     if (img->muxer) {
-        int ret = write_muxed_file(s, s->pb, pkt);
+        int ret = write_muxed_file(s, s->pb, pkt, ffformatcontext(s)->pkt);
         if (ret < 0)
             return ret;
     } else {
@@ -135,53 +130,27 @@ static int write_and_close(AVFormatContext *s, AVIOContext **pb, const unsigned
     return ff_format_io_close(s, pb);
 }
 
-static int write_packet(AVFormatContext *s, AVPacket *pkt)
+/* Write one image; this may run in a worker thread, so it must not
+ * modify the muxer context. */
+static int write_image(AVFormatContext *s, char *filename, AVPacket *pkt,
+                       AVPacket *tmp_pkt)
 {
     VideoMuxData *img = s->priv_data;
     AVIOContext *pb[4] = {0};
-    char filename[1024];
+    char tmp[4][1024];
+    char target[4][1024];
     AVCodecParameters *par = s->streams[pkt->stream_index]->codecpar;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(par->format);
     int ret, i;
     int nb_renames = 0;
     AVDictionary *options = NULL;
 
-    if (img->update) {
-        av_strlcpy(filename, s->url, sizeof(filename));
-    } else if (img->use_strftime) {
-        time_t now0;
-        struct tm *tm, tmpbuf;
-        time(&now0);
-        tm = localtime_r(&now0, &tmpbuf);
-        if (!strftime(filename, sizeof(filename), s->url, tm)) {
-            av_log(s, AV_LOG_ERROR, "Could not get frame filename with strftime\n");
-            return AVERROR(EINVAL);
-        }
-    } else if (img->frame_pts) {
-        if (av_get_frame_filename2(filename, sizeof(filename), s->url, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
-            av_log(s, AV_LOG_ERROR, "Cannot write filename by pts of the frames.");
-            return AVERROR(EINVAL);
-        }
-    } else if (av_get_frame_filename2(filename, sizeof(filename), s->url,
-                                      img->img_number,
-                                      AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
-        if (img->img_number == img->start_img_number) {
-            av_log(s, AV_LOG_WARNING, "The specified filename '%s' does not contain an image sequence pattern or a pattern is invalid.\n", s->url);
-            av_log(s, AV_LOG_WARNING,
-                   "Use a pattern such as %%03d for an image sequence or "
-                   "use the -update option (with -frames:v 1 if needed) to write a single image.\n");
-            av_strlcpy(filename, s->url, sizeof(filename));
-        } else {
-            av_log(s, AV_LOG_ERROR, "Cannot write more than one file with the same name. Are you missing the -update option or a sequence pattern?\n");
-            return AVERROR(EINVAL);
-        }
-    }
     for (i = 0; i < 4; i++) {
         av_dict_copy(&options, img->protocol_opts, 0);
-        snprintf(img->tmp[i], sizeof(img->tmp[i]), "%s.tmp", filename);
-        av_strlcpy(img->target[i], filename, sizeof(img->target[i]));
-        if (s->io_open(s, &pb[i], img->use_rename ? img->tmp[i] : filename, AVIO_FLAG_WRITE, &options) < 0) {
-            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", img->use_rename ? img->tmp[i] : filename);
+        snprintf(tmp[i], sizeof(tmp[i]), "%s.tmp", filename);
+        av_strlcpy(target[i], filename, sizeof(target[i]));
+        if (s->io_open(s, &pb[i], img->use_rename ? tmp[i] : filename, AVIO_FLAG_WRITE, &options) < 0) {
+            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", img->use_rename ? tmp[i] : filename);
             ret = AVERROR(EIO);
             goto fail;
         }
@@ -212,7 +181,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
         if (desc->nb_components > 3)
             ret = write_and_close(s, &pb[3], pkt->data + ysize + 2*usize, ysize);
     } else if (img->muxer) {
-        if ((ret = write_muxed_file(s, pb[0], pkt)) < 0)
+        if ((ret = write_muxed_file(s, pb[0], pkt, tmp_pkt)) < 0)
             goto fail;
         ret = ff_format_io_close(s, &pb[0]);
     } else {
@@ -222,12 +191,11 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
         goto fail;
 
     for (i = 0; i < nb_renames; i++) {
-        int ret = ff_rename(img->tmp[i], img->target[i], s);
+        int ret = ff_rename(tmp[i], target[i], s);
         if (ret < 0)
             return ret;
     }
 
-    img->img_number++;
     return 0;
 
 fail:
@@ -238,6 +206,252 @@ fail:
     return ret;
 }
 
+#if HAVE_THREADS
+static void *write_worker(void *arg)
+{
+    AVFormatContext *s = arg;
+    VideoMuxData *img = s->priv_data;
+    AVPacket *tmp_pkt = av_packet_alloc();
+
+    pthread_mutex_lock(&img->lock);
+    if (!tmp_pkt)
+        img->error = AVERROR(ENOMEM);
+    while (!img->workers_exit) {
+        ImageWriteJob job;
+        int ret;
+
+        if (img->error || av_fifo_read(img->jobs, &job, 1) < 0) {
+            pthread_cond_wait(&img->work_cond, &img->lock);
+            continue;
+        }
+        img->nb_busy++;
+        pthread_mutex_unlock(&img->lock);
+
+        ret = write_image(s, job.filename, job.pkt, tmp_pkt);
+        av_packet_free(&job.pkt);
+
+        pthread_mutex_lock(&img->lock);
+        img->nb_busy--;
+        if (ret < 0 && !img->error)
+            img->error = ret;
+        pthread_cond_broadcast(&img->done_cond);
+    }
+    pthread_mutex_unlock(&img->lock);
+
+    av_packet_free(&tmp_pkt);
+    return NULL;
+}
+
+static void stop_workers(VideoMuxData *img)
+{
+    ImageWriteJob job;
+
+    if (!img->workers)
+        return;
+
+    pthread_mutex_lock(&img->lock);
+    img->workers_exit = 1;
+    pthread_cond_broadcast(&img->work_cond);
+    pthread_mutex_unlock(&img->lock);
+
+    for (unsigned i = 0; i < img->nb_workers; i++)
+        pthread_join(img->workers[i], NULL);
+    av_freep(&img->workers);
+    img->nb_workers = 0;
+
+    while (av_fifo_read(img->jobs, &job, 1) >= 0)
+        av_packet_free(&job.pkt);
+    av_fifo_freep2(&img->jobs);
+
+    pthread_cond_destroy(&img->done_cond);
+    pthread_cond_destroy(&img->work_cond);
+    pthread_mutex_destroy(&img->lock);
+}
+
+static int start_workers(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    int ret;
+
+    /* Allow two queued images per thread, so that no worker waits for the
+     * muxing thread while bounding the memory held by the queue. */
+    img->jobs = av_fifo_alloc2(2 * img->nb_threads, sizeof(ImageWriteJob), 0);
+    if (!img->jobs || !FF_ALLOCZ_TYPED_ARRAY(img->workers, img->nb_threads)) {
+        av_fifo_freep2(&img->jobs);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&img->lock, NULL);
+    pthread_cond_init(&img->work_cond, NULL);
+    pthread_cond_init(&img->done_cond, NULL);
+
+    for (int i = 0; i < img->nb_threads; i++) {
+        ret = pthread_create(&img->workers[i], NULL, write_worker, s);
+        if (ret) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            stop_workers(img);
+            return AVERROR(ret);
+        }
+        img->nb_workers++;
+    }
+    return 0;
+}
+
+static int queue_image(AVFormatContext *s, const char *filename, AVPacket *pkt)
+{
+    VideoMuxData *img = s->priv_data;
+    ImageWriteJob job;
+    int ret;
+
+    job.pkt = av_packet_clone(pkt);
+    if (!job.pkt)
+        return AVERROR(ENOMEM);
+    av_strlcpy(job.filename, filename, sizeof(job.filename));
+
+    pthread_mutex_lock(&img->lock);
+    while (!img->error && !av_fifo_can_write(img->jobs))
+        pthread_cond_wait(&img->done_cond, &img->lock);
+    ret = img->error;
+    if (!ret) {
+        av_fifo_write(img->jobs, &job, 1);
+        pthread_cond_signal(&img->work_cond);
+    }
+    pthread_mutex_unlock(&img->lock);
+
+    if (ret < 0)
+        av_packet_free(&job.pkt);
+    return ret;
+}
+
+/* Wait until the workers have written all the queued images. */
+static int drain_workers(VideoMuxData *img)
+{
+    int ret;
+
+    pthread_mutex_lock(&img->lock);
+    while (!img->error && (img->nb_busy || av_fifo_can_read(img->jobs)))
+        pthread_cond_wait(&img->done_cond, &img->lock);
+    while (img->nb_busy)
+        pthread_cond_wait(&img->done_cond, &img->lock);
+    ret = img->error;
+    pthread_mutex_unlock(&img->lock);
+
+    return ret;
+}
+#endif
+
+static int write_header(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    AVStream *st = s->streams[0];
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(st->codecpar->format);
+
+    if (st->codecpar->codec_id == AV_CODEC_ID_GIF) {
+        img->muxer = "gif";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_FITS) {
+        img->muxer = "fits";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_AV1) {
+        img->muxer = "avif";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_RAWVIDEO) {
+        const char *str = strrchr(s->url, '.');
+        img->split_planes =     str
+                             && !av_strcasecmp(str + 1, "y")
+                             && s->nb_streams == 1
+                             && desc
+                             &&(desc->flags & AV_PIX_FMT_FLAG_PLANAR)
+                             && desc->nb_components >= 3;
+    }
+    img->img_number = img->start_img_number;
+
+    if (img->nb_threads) {
+#if HAVE_THREADS
+        /* Images sharing a file name must be written in order. */
+        if (img->update || img->use_strftime) {
+            av_log(s, AV_LOG_WARNING, "write_threads is not supported with "
+                   "update or strftime, writing from the muxing thread\n");
+        } else {
+            int ret = start_workers(s);
+            if (ret < 0)
+                return ret;
+        }
+#else
+        av_log(s, AV_LOG_WARNING, "Built without thread support, "
+               "writing from the muxing thread\n");
+#endif
+    }
+
+    return 0;
+}
+
+static int write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VideoMuxData *img = s->priv_data;
+    char filename[1024];
+    int ret;
+
+    if (img->update) {
+        av_strlcpy(filename, s->url, sizeof(filename));
+    } else if (img->use_strftime) {
+        time_t now0;
+        struct tm *tm, tmpbuf;
+        time(&now0);
+        tm = localtime_r(&now0, &tmpbuf);
+        if (!strftime(filename, sizeof(filename), s->url, tm)) {
+            av_log(s, AV_LOG_ERROR, "Could not get frame filename with strftime\n");
+            return AVERROR(EINVAL);
+        }
+    } else if (img->frame_pts) {
+        if (av_get_frame_filename2(filename, sizeof(filename), s->url, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
+            av_log(s, AV_LOG_ERROR, "Cannot write filename by pts of the frames.");
+            return AVERROR(EINVAL);
+        }
+    } else if (av_get_frame_filename2(filename, sizeof(filename), s->url,
+                                      img->img_number,
+                                      AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
+        if (img->img_number == img->start_img_number) {
+            av_log(s, AV_LOG_WARNING, "The specified filename '%s' does not contain an image sequence pattern or a pattern is invalid.\n", s->url);
+            av_log(s, AV_LOG_WARNING,
+                   "Use a pattern such as %%03d for an image sequence or "
+                   "use the -update option (with -frames:v 1 if needed) to write a single image.\n");
+            av_strlcpy(filename, s->url, sizeof(filename));
+        } else {
+            av_log(s, AV_LOG_ERROR, "Cannot write more than one file with the same name. Are you missing the -update option or a sequence pattern?\n");
+            return AVERROR(EINVAL);
+        }
+    }
+
+#if HAVE_THREADS
+    if (img->workers)
+        ret = queue_image(s, filename, pkt);
+    else
+#endif
+    ret = write_image(s, filename, pkt, ffformatcontext(s)->pkt);
+    if (ret < 0)
+        return ret;
+
+    img->img_number++;
+    return 0;
+}
+
+static int write_trailer(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    VideoMuxData *img = s->priv_data;
+
+    if (img->workers)
+        return drain_workers(img);
+#endif
+    return 0;
+}
+
+static void img_deinit(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    stop_workers(s->priv_data);
+#endif
+}
+
 static int query_codec(enum AVCodecID id, int std_compliance)
 {
     int i;
@@ -258,6 +472,7 @@ static const AVOption muxoptions[] = {
     { "frame_pts",    "use current frame pts for filename", OFFSET(frame_pts),  AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "atomic_writing", "write files atomically (using temporary files and renames)", OFFSET(use_rename), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "protocol_opts", "specify protocol options for the opened files", OFFSET(protocol_opts), AV_OPT_TYPE_DICT, {0}, 0, 0, ENC },
+    { "write_threads", "write the images from a pool of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 256, ENC },
     { NULL },
 };
 
@@ -279,6 +494,8 @@ const FFOutputFormat ff_image2_muxer = {
     .p.video_codec  = AV_CODEC_ID_MJPEG,
     .write_header   = write_header,
     .write_packet   = write_packet,
+    .write_trailer  = write_trailer,
+    .deinit         = img_deinit,
     .query_codec    = query_codec,
     .p.flags        = AVFMT_NOTIMESTAMPS | AVFMT_NODIMENSIONS | AVFMT_NOFILE,
     .p.priv_class   = &img2mux_class,
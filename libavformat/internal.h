@@ -45,6 +45,12 @@
  * by the caller upon read_header() failure.
  */
 #define FF_FMT_INIT_CLEANUP                             (1 << 0)
+/**
+ * For an AVInputFormat with this flag set read_packet() does not modify the
+ * public fields of the AVFormatContext and its streams, so packets may be
+ * read ahead in a separate thread, see AVFormatContext.prefetch_size.
+ */
+#define FF_FMT_PREFETCH                                 (1 << 1)
 
 typedef struct AVCodecTag {
     enum AVCodecID id;
@@ -186,6 +192,11 @@ typedef struct FFFormatContext {
      * Contexts and child contexts do not contain a metadata option
      */
     int metafree;
+
+    /**
+     * Demuxing thread reading packets ahead, see AVFormatContext.prefetch_size.
+     */
+    struct DemuxPrefetch *prefetch;
 } FFFormatContext;
 
 static av_always_inline FFFormatContext *ffformatcontext(AVFormatContext *s)
@@ -537,6 +548,33 @@ int ff_get_line(AVIOContext *s, char *buf, int maxlen);
  */
 int ff_get_chomp_line(AVIOContext *s, char *buf, int maxlen);
 
+/**
+ * Like av_get_packet(), but if the data comes from a memory mapped file
+ * the packet references the mapping instead of a copy. Such a packet is
+ * read-only and its padding holds the following bytes of the file rather
+ * than zeros, so this is only done for uncompressed audio and video,
+ * whose decoders never look past the end of a packet. The caller must not
+ * modify pkt->data in place.
+ *
+ * @param par  parameters of the stream the packet belongs to
+ * @param pool if not NULL, the data is read into a buffer from this pool
+ *             when it is not mapped, see ff_get_pooled_packet()
+ */
+int ff_get_mapped_packet(AVIOContext *s, AVPacket *pkt, int size,
+                         const AVCodecParameters *par, AVBufferPool *pool);
+
+/**
+ * Like av_get_packet(), but read the data into a buffer from pool instead
+ * of allocating a new one. This avoids reallocating large buffers for
+ * every packet of constant size, and the buffers are aligned like
+ * av_malloc() memory.
+ *
+ * @param pool pool of buffers of at least size + AV_INPUT_BUFFER_PADDING_SIZE
+ *             bytes
+ */
+int ff_get_pooled_packet(AVIOContext *s, AVPacket *pkt, int size,
+                         AVBufferPool *pool);
+
 #define SPACE_CHARS " \t\r\n"
 
 /**
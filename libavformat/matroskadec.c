@@ -376,6 +376,11 @@ typedef struct MatroskaLevel1Element {
     int parsed;
 } MatroskaLevel1Element;
 
+typedef struct MatroskaClusterIndexEntry {
+    int64_t  pos;
+    uint64_t timecode;
+} MatroskaClusterIndexEntry;
+
 typedef struct MatroskaDemuxContext {
     const AVClass *class;
     AVFormatContext *ctx;
@@ -418,6 +423,15 @@ typedef struct MatroskaDemuxContext {
     /* File has a CUES element, but we defer parsing until it is needed. */
     int cues_parsing_deferred;
 
+    /* Cluster positions and timecodes found by scanning the file
+     * when it has no usable Cues; built on the first seek. */
+    int cluster_index_enable;
+    char *cluster_index_file;
+    int cluster_index_built;
+    MatroskaClusterIndexEntry *cluster_index;
+    int nb_cluster_index;
+    unsigned cluster_index_size;
+
     /* Level1 elements and whether they were read yet */
     MatroskaLevel1Element level1_elems[64];
     int num_level1_elems;
@@ -850,6 +864,14 @@ static int matroska_reset_status(MatroskaDemuxContext *matroska,
     return err;
 }
 
+static int matroska_is_level1_id(uint32_t id)
+{
+    return id == MATROSKA_ID_INFO     || id == MATROSKA_ID_TRACKS      ||
+           id == MATROSKA_ID_CUES     || id == MATROSKA_ID_TAGS        ||
+           id == MATROSKA_ID_SEEKHEAD || id == MATROSKA_ID_ATTACHMENTS ||
+           id == MATROSKA_ID_CLUSTER  || id == MATROSKA_ID_CHAPTERS;
+}
+
 static int matroska_resync(MatroskaDemuxContext *matroska, int64_t last_pos)
 {
     AVIOContext *pb = matroska->ctx->pb;
@@ -869,10 +891,7 @@ static int matroska_resync(MatroskaDemuxContext *matroska, int64_t last_pos)
 
     // try to find a toplevel element
     while (!avio_feof(pb)) {
-        if (id == MATROSKA_ID_INFO     || id == MATROSKA_ID_TRACKS      ||
-            id == MATROSKA_ID_CUES     || id == MATROSKA_ID_TAGS        ||
-            id == MATROSKA_ID_SEEKHEAD || id == MATROSKA_ID_ATTACHMENTS ||
-            id == MATROSKA_ID_CLUSTER  || id == MATROSKA_ID_CHAPTERS) {
+        if (matroska_is_level1_id(id)) {
             /* Prepare the context for parsing of a level 1 element. */
             matroska_reset_status(matroska, id, -1);
             /* Given that we are here means that an error has occurred,
@@ -4084,6 +4103,255 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+static int matroska_add_cluster_index_entry(MatroskaDemuxContext *matroska,
+                                            int64_t pos, uint64_t timecode)
+{
+    MatroskaClusterIndexEntry *entries;
+
+    if (matroska->nb_cluster_index >= INT_MAX / sizeof(*entries) - 1)
+        return AVERROR(ENOMEM);
+    entries = av_fast_realloc(matroska->cluster_index, &matroska->cluster_index_size,
+                              (matroska->nb_cluster_index + 1) * sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    matroska->cluster_index = entries;
+    entries[matroska->nb_cluster_index++] = (MatroskaClusterIndexEntry){ pos, timecode };
+
+    return 0;
+}
+
+static int ebml_read_element_header(MatroskaDemuxContext *matroska,
+                                    AVIOContext *pb, uint32_t *id,
+                                    uint64_t *length)
+{
+    uint64_t num;
+    int res = ebml_read_num(matroska, pb, 4, &num, 0);
+    if (res < 0)
+        return res;
+    *id = num | 1 << 7 * res;
+    return ebml_read_length(matroska, pb, length);
+}
+
+/*
+ * Walk the level 1 elements starting at the first Cluster and record the
+ * position and timecode of every Cluster. Only element headers and the
+ * Cluster Timecode are read; the blocks themselves are skipped.
+ */
+static int matroska_scan_clusters(MatroskaDemuxContext *matroska)
+{
+    AVFormatContext *s = matroska->ctx;
+    AVIOContext *pb    = s->pb;
+    int64_t pos        = ffformatcontext(s)->data_offset;
+    int64_t end        = avio_size(pb);
+    int ret;
+
+    if (matroska->levels[0].length != EBML_UNKNOWN_LENGTH)
+        end = FFMIN(end, matroska->segment_start + matroska->levels[0].length);
+
+    while (pos > 0 && pos < end) {
+        int64_t next = -1;
+        uint64_t length, timecode = 0;
+        int have_timecode = 0;
+        uint32_t id;
+
+        if (ff_check_interrupt(&s->interrupt_callback))
+            return AVERROR_EXIT;
+        if ((ret = avio_seek(pb, pos, SEEK_SET)) < 0)
+            return ret;
+        if ((ret = ebml_read_element_header(matroska, pb, &id, &length)) < 0)
+            return ret;
+        if (length != EBML_UNKNOWN_LENGTH)
+            next = avio_tell(pb) + length;
+
+        if (id != MATROSKA_ID_CLUSTER) {
+            if (next < 0)
+                return AVERROR_INVALIDDATA;
+            pos = next;
+            continue;
+        }
+
+        /* Read children up to the Cluster Timecode; a Cluster of unknown
+         * size ends at the next level 1 element, so skip over all of them. */
+        while (!have_timecode || length == EBML_UNKNOWN_LENGTH) {
+            int64_t child_pos = avio_tell(pb);
+            uint64_t child_length;
+            uint32_t child_id;
+
+            if (next >= 0 && child_pos >= next)
+                break;
+            ret = ebml_read_element_header(matroska, pb, &child_id, &child_length);
+            if (ret == AVERROR_EOF || ret >= 0 && matroska_is_level1_id(child_id)) {
+                next = child_pos;
+                break;
+            }
+            if (ret < 0)
+                return ret;
+            if (child_length == EBML_UNKNOWN_LENGTH)
+                return AVERROR_INVALIDDATA;
+            if (child_id == MATROSKA_ID_CLUSTERTIMECODE && child_length <= 8 &&
+                !have_timecode) {
+                ebml_read_uint(pb, child_length, 0, &timecode);
+                have_timecode = 1;
+            } else if ((ret = avio_skip(pb, child_length)) < 0) {
+                return ret;
+            }
+        }
+
+        if (have_timecode && (!matroska->nb_cluster_index ||
+                              timecode >= matroska->cluster_index[matroska->nb_cluster_index - 1].timecode)) {
+            ret = matroska_add_cluster_index_entry(matroska, pos, timecode);
+            if (ret < 0)
+                return ret;
+        }
+        if (next <= pos)
+            break;
+        pos = next;
+    }
+
+    return 0;
+}
+
+static int matroska_read_cluster_index_file(MatroskaDemuxContext *matroska)
+{
+    AVFormatContext *s = matroska->ctx;
+    AVIOContext *in;
+    char line[64];
+    int64_t size;
+    int ret;
+
+    ret = s->io_open(s, &in, matroska->cluster_index_file, AVIO_FLAG_READ, NULL);
+    if (ret < 0)
+        return ret;
+
+    if (ff_get_chomp_line(in, line, sizeof(line)) <= 0 ||
+        sscanf(line, "FFMKVCLUSTERS1 %"SCNd64, &size) != 1 ||
+        size != avio_size(s->pb)) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    while (ff_get_chomp_line(in, line, sizeof(line)) > 0) {
+        int64_t pos;
+        uint64_t timecode;
+
+        if (sscanf(line, "%"SCNd64" %"SCNu64, &pos, &timecode) != 2 ||
+            pos <= 0 || pos >= size ||
+            matroska->nb_cluster_index &&
+            timecode < matroska->cluster_index[matroska->nb_cluster_index - 1].timecode) {
+            ret = AVERROR_INVALIDDATA;
+            goto end;
+        }
+        if ((ret = matroska_add_cluster_index_entry(matroska, pos, timecode)) < 0)
+            goto end;
+    }
+    ret = matroska->nb_cluster_index ? 0 : AVERROR_INVALIDDATA;
+
+end:
+    if (ret < 0)
+        matroska->nb_cluster_index = 0;
+    ff_format_io_close(s, &in);
+    return ret;
+}
+
+static int matroska_write_cluster_index_file(MatroskaDemuxContext *matroska)
+{
+    AVFormatContext *s = matroska->ctx;
+    AVIOContext *out;
+    int ret, i;
+
+    ret = s->io_open(s, &out, matroska->cluster_index_file, AVIO_FLAG_WRITE, NULL);
+    if (ret < 0)
+        return ret;
+
+    avio_printf(out, "FFMKVCLUSTERS1 %"PRId64"\n", avio_size(s->pb));
+    for (i = 0; i < matroska->nb_cluster_index; i++)
+        avio_printf(out, "%"PRId64" %"PRIu64"\n", matroska->cluster_index[i].pos,
+                    matroska->cluster_index[i].timecode);
+
+    return ff_format_io_close(s, &out);
+}
+
+static void matroska_build_cluster_index(MatroskaDemuxContext *matroska)
+{
+    AVFormatContext *s = matroska->ctx;
+    int64_t pos = avio_tell(s->pb);
+    int ret;
+
+    matroska->cluster_index_built = 1;
+
+    if (!matroska->cluster_index_enable || s->flags & AVFMT_FLAG_IGNIDX ||
+        !(s->pb->seekable & AVIO_SEEKABLE_NORMAL) ||
+        matroska->index.nb_elem >= 2 || ffformatcontext(s)->data_offset <= 0)
+        return;
+
+    if (matroska->cluster_index_file &&
+        matroska_read_cluster_index_file(matroska) >= 0) {
+        av_log(s, AV_LOG_VERBOSE, "Loaded %d clusters from %s\n",
+               matroska->nb_cluster_index, matroska->cluster_index_file);
+        return;
+    }
+
+    ret = matroska_scan_clusters(matroska);
+    avio_seek(s->pb, pos, SEEK_SET);
+    if (ret < 0)
+        av_log(s, AV_LOG_WARNING, "Cluster scan stopped early: %s\n",
+               av_err2str(ret));
+    av_log(s, AV_LOG_VERBOSE, "Indexed %d clusters\n", matroska->nb_cluster_index);
+
+    if (matroska->cluster_index_file && matroska->nb_cluster_index && ret >= 0) {
+        ret = matroska_write_cluster_index_file(matroska);
+        if (ret < 0)
+            av_log(s, AV_LOG_WARNING, "Could not write cluster index %s: %s\n",
+                   matroska->cluster_index_file, av_err2str(ret));
+    }
+}
+
+/*
+ * Make sure the stream's index contains the last keyframe before timestamp
+ * by parsing the clusters in front of it, walking backwards from the
+ * cluster that covers timestamp.
+ */
+static void matroska_index_clusters(MatroskaDemuxContext *matroska,
+                                    AVStream *st, int64_t timestamp)
+{
+    MatroskaClusterIndexEntry *entries = matroska->cluster_index;
+    MatroskaCluster *cluster = &matroska->current_cluster;
+    MatroskaTrack *tracks = matroska->tracks.elem;
+    FFStream *const sti = ffstream(st);
+    double track_scale = 1.0;
+    int lo = 0, hi = matroska->nb_cluster_index - 1, i;
+
+    for (i = 0; i < matroska->tracks.nb_elem; i++)
+        if (tracks[i].stream == st)
+            track_scale = tracks[i].time_scale;
+
+    timestamp = FFMAX(timestamp, 0) * track_scale;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) >> 1;
+        if (entries[mid].timecode <= timestamp)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    for (i = lo; i >= 0; i--) {
+        int64_t pos = entries[i].pos;
+        int index = av_index_search_timestamp(st, timestamp / track_scale,
+                                              AVSEEK_FLAG_BACKWARD);
+
+        if (index >= 0 && sti->index_entries[index].pos >= pos)
+            break;
+
+        matroska_reset_status(matroska, 0, pos);
+        cluster->pos = pos;
+        do {
+            matroska_clear_queue(matroska);
+            if (matroska_parse_cluster(matroska) < 0)
+                break;
+        } while (cluster->pos == pos);
+    }
+    matroska_clear_queue(matroska);
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -4099,6 +4367,11 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         matroska_parse_cues(matroska);
     }
 
+    if (!matroska->cluster_index_built)
+        matroska_build_cluster_index(matroska);
+    if (matroska->nb_cluster_index)
+        matroska_index_clusters(matroska, st, timestamp);
+
     if (!sti->nb_index_entries)
         goto err;
     timestamp = FFMAX(timestamp, sti->index_entries[0].timestamp);
@@ -4164,10 +4437,25 @@ static int matroska_read_close(AVFormatContext *s)
         if (tracks[n].type == MATROSKA_TRACK_TYPE_AUDIO)
             av_freep(&tracks[n].audio.buf);
     ebml_free(matroska_segment, matroska);
+    av_freep(&matroska->cluster_index);
 
     return 0;
 }
 
+#define OFFSET(x) offsetof(MatroskaDemuxContext, x)
+static const AVOption matroska_options[] = {
+    { "cluster_index", "build a cluster index for seeking in files without Cues", OFFSET(cluster_index_enable), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "cluster_index_file", "file to load the cluster index from or store it to", OFFSET(cluster_index_file), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass matroska_class = {
+    .class_name = "matroska,webm demuxer",
+    .item_name  = av_default_item_name,
+    .option     = matroska_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 #if CONFIG_WEBM_DASH_MANIFEST_DEMUXER
 typedef struct {
     int64_t start_time_ns;
@@ -4583,7 +4871,6 @@ static int webm_dash_manifest_read_packet(AVFormatContext *s, AVPacket *pkt)
     return AVERROR_EOF;
 }
 
-#define OFFSET(x) offsetof(MatroskaDemuxContext, x)
 static const AVOption options[] = {
     { "live", "flag indicating that the input is a live file that only has the headers.", OFFSET(is_live), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "bandwidth", "bandwidth of this stream to be specified in the DASH manifest.", OFFSET(bandwidth), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
@@ -4613,6 +4900,7 @@ const AVInputFormat ff_matroska_demuxer = {
     .name           = "matroska,webm",
     .long_name      = NULL_IF_CONFIG_SMALL("Matroska / WebM"),
     .extensions     = "mkv,mk3d,mka,mks,webm",
+    .priv_class     = &matroska_class,
     .priv_data_size = sizeof(MatroskaDemuxContext),
     .flags_internal = FF_FMT_INIT_CLEANUP,
     .read_probe     = matroska_probe,
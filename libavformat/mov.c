@@ -8935,8 +8935,10 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 
         if (st->codecpar->codec_id == AV_CODEC_ID_EIA_608 && sample->size > 8)
             ret = get_eia608_packet(sc->pb, pkt, sample->size);
-        else
+        else if (mov->aax_mode || mov->decryption_key)
             ret = av_get_packet(sc->pb, pkt, sample->size);
+        else
+            ret = ff_get_mapped_packet(sc->pb, pkt, sample->size, st->codecpar, NULL);
         if (ret < 0) {
             if (should_retry(sc->pb, ret)) {
                 mov_current_sample_dec(sc);
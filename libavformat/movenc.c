@@ -4779,10 +4779,30 @@ static uint32_t get_sample_flags(MOVTrack *track, MOVIentry *entry)
            (MOV_FRAG_SAMPLE_FLAG_DEPENDS_YES | MOV_FRAG_SAMPLE_FLAG_IS_NON_SYNC);
 }
 
+static int mov_add_moof_patch(AVIOContext *pb, MOVMuxContext *mov,
+                              int base_offset)
+{
+    MOVMoofPatch *patches;
+
+    if (pb != mov->moof_buf)
+        return 0;
+
+    patches = av_fast_realloc(mov->moof_patches, &mov->moof_patches_size,
+                              (mov->nb_moof_patches + 1) * sizeof(*patches));
+    if (!patches)
+        return AVERROR(ENOMEM);
+    mov->moof_patches = patches;
+    patches[mov->nb_moof_patches].pos         = avio_tell(pb);
+    patches[mov->nb_moof_patches].base_offset = base_offset;
+    mov->nb_moof_patches++;
+    return 0;
+}
+
 static int mov_write_tfhd_tag(AVIOContext *pb, MOVMuxContext *mov,
                               MOVTrack *track, int64_t moof_offset)
 {
     int64_t pos = avio_tell(pb);
+    int ret;
     uint32_t flags = MOV_TFHD_DEFAULT_SIZE | MOV_TFHD_DEFAULT_DURATION |
                      MOV_TFHD_BASE_DATA_OFFSET;
     if (!track->entry) {
@@ -4814,8 +4834,11 @@ static int mov_write_tfhd_tag(AVIOContext *pb, MOVMuxContext *mov,
     avio_wb24(pb, flags);
 
     avio_wb32(pb, track->track_id); /* track-id */
-    if (flags & MOV_TFHD_BASE_DATA_OFFSET)
+    if (flags & MOV_TFHD_BASE_DATA_OFFSET) {
+        if ((ret = mov_add_moof_patch(pb, mov, 1)) < 0)
+            return ret;
         avio_wb64(pb, moof_offset);
+    }
     if (flags & MOV_TFHD_STSD_ID) {
         avio_wb32(pb, 1);
     }
@@ -4851,7 +4874,7 @@ static int mov_write_trun_tag(AVIOContext *pb, MOVMuxContext *mov,
 {
     int64_t pos = avio_tell(pb);
     uint32_t flags = MOV_TRUN_DATA_OFFSET;
-    int i;
+    int i, ret;
 
     for (i = first; i < end; i++) {
         if (get_cluster_duration(track, i) != track->default_duration)
@@ -4880,9 +4903,12 @@ static int mov_write_trun_tag(AVIOContext *pb, MOVMuxContext *mov,
         !(mov->flags & FF_MOV_FLAG_DEFAULT_BASE_MOOF) &&
         !mov->first_trun)
         avio_wb32(pb, 0); /* Later tracks follow immediately after the previous one */
-    else
+    else {
+        if ((ret = mov_add_moof_patch(pb, mov, 0)) < 0)
+            return ret;
         avio_wb32(pb, moof_size + 8 + track->data_offset +
                       track->cluster[first].pos); /* data offset */
+    }
     if (flags & MOV_TRUN_FIRST_SAMPLE_FLAGS)
         avio_wb32(pb, get_sample_flags(track, &track->cluster[first]));
 
@@ -5040,20 +5066,23 @@ static int mov_write_traf_tag(AVIOContext *pb, MOVMuxContext *mov,
                               int moof_size)
 {
     int64_t pos = avio_tell(pb);
-    int i, start = 0;
+    int i, ret, start = 0;
     avio_wb32(pb, 0); /* size placeholder */
     ffio_wfourcc(pb, "traf");
 
-    mov_write_tfhd_tag(pb, mov, track, moof_offset);
+    if ((ret = mov_write_tfhd_tag(pb, mov, track, moof_offset)) < 0)
+        return ret;
     if (mov->mode != MODE_ISM)
         mov_write_tfdt_tag(pb, track);
     for (i = 1; i < track->entry; i++) {
         if (track->cluster[i].pos != track->cluster[i - 1].pos + track->cluster[i - 1].size) {
-            mov_write_trun_tag(pb, mov, track, moof_size, start, i);
+            if ((ret = mov_write_trun_tag(pb, mov, track, moof_size, start, i)) < 0)
+                return ret;
             start = i;
         }
     }
-    mov_write_trun_tag(pb, mov, track, moof_size, start, track->entry);
+    if ((ret = mov_write_trun_tag(pb, mov, track, moof_size, start, track->entry)) < 0)
+        return ret;
     if (mov->mode == MODE_ISM) {
         mov_write_tfxd_tag(pb, track);
 
@@ -5078,7 +5107,7 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
                                        int tracks, int moof_size)
 {
     int64_t pos = avio_tell(pb);
-    int i;
+    int i, ret;
 
     avio_wb32(pb, 0); /* size placeholder */
     ffio_wfourcc(pb, "moof");
@@ -5091,7 +5120,8 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
             continue;
         if (!track->entry)
             continue;
-        mov_write_traf_tag(pb, mov, track, pos, moof_size);
+        if ((ret = mov_write_traf_tag(pb, mov, track, pos, moof_size)) < 0)
+            return ret;
     }
 
     return update_size(pb, pos);
@@ -5251,12 +5281,32 @@ static int mov_write_moof_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks,
                               int64_t mdat_size)
 {
     AVIOContext *avio_buf;
-    int ret, moof_size;
+    uint8_t *buf;
+    int ret, moof_size, i;
+    int64_t moof_pos;
 
-    if ((ret = ffio_open_null_buf(&avio_buf)) < 0)
-        return ret;
-    mov_write_moof_tag_internal(avio_buf, mov, tracks, 0);
-    moof_size = ffio_close_null_buf(avio_buf);
+    if (mov->mode == MODE_ISM) {
+        /* tfxd and tfrf depend on the final position, size the moof with a dry run */
+        if ((ret = ffio_open_null_buf(&avio_buf)) < 0)
+            return ret;
+        ret = mov_write_moof_tag_internal(avio_buf, mov, tracks, 0);
+        moof_size = ffio_close_null_buf(avio_buf);
+        if (ret < 0)
+            return ret;
+    } else {
+        /* Build the moof only once, the data offsets depending on its size
+         * and position are patched in before it is written out. */
+        if (!mov->moof_buf) {
+            if ((ret = avio_open_dyn_buf(&mov->moof_buf)) < 0)
+                return ret;
+        } else {
+            ffio_reset_dyn_buf(mov->moof_buf);
+        }
+        mov->nb_moof_patches = 0;
+        if ((ret = mov_write_moof_tag_internal(mov->moof_buf, mov, tracks, 0)) < 0)
+            return ret;
+        moof_size = avio_tell(mov->moof_buf);
+    }
 
     if (mov->flags & FF_MOV_FLAG_DASH &&
         !(mov->flags & (FF_MOV_FLAG_GLOBAL_SIDX | FF_MOV_FLAG_SKIP_SIDX)))
@@ -5276,7 +5326,23 @@ static int mov_write_moof_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks,
         }
     }
 
-    return mov_write_moof_tag_internal(pb, mov, tracks, moof_size);
+    if (mov->mode == MODE_ISM)
+        return mov_write_moof_tag_internal(pb, mov, tracks, moof_size);
+
+    moof_pos = avio_tell(pb);
+    avio_get_dyn_buf(mov->moof_buf, &buf);
+    if (mov->moof_buf->error < 0)
+        return mov->moof_buf->error;
+    for (i = 0; i < mov->nb_moof_patches; i++) {
+        uint8_t *field = buf + mov->moof_patches[i].pos;
+        if (mov->moof_patches[i].base_offset)
+            AV_WB64(field, AV_RB64(field) + moof_pos);
+        else
+            AV_WB32(field, AV_RB32(field) + moof_size);
+    }
+    avio_write(pb, buf, moof_size);
+
+    return 0;
 }
 
 static int mov_write_tfra_tag(AVIOContext *pb, MOVTrack *track)
@@ -5930,6 +5996,7 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
             continue;
         if (track->mdat_buf)
             mdat_size += avio_tell(track->mdat_buf);
+        mdat_size += track->mdat_queue_size;
         if (first_track < 0)
             first_track = i;
     }
@@ -5949,7 +6016,7 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         if (mov->flags & FF_MOV_FLAG_SEPARATE_MOOF) {
             if (!track->entry)
                 continue;
-            mdat_size = avio_tell(track->mdat_buf);
+            mdat_size = avio_tell(track->mdat_buf) + track->mdat_queue_size;
             moof_tracks = i;
         } else {
             write_moof = i == first_track;
@@ -5958,7 +6025,9 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         if (write_moof) {
             avio_write_marker(s->pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
 
-            mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size);
+            ret = mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size);
+            if (ret < 0)
+                return ret;
             mov->fragments++;
 
             avio_wb32(s->pb, mdat_size + 8);
@@ -5969,6 +6038,12 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         track->entries_flushed = 0;
         track->end_reliable = 0;
         if (!mov->frag_interleave) {
+            /* Referenced packets come first, they are written straight from
+             * their own buffers. */
+            for (PacketListEntry *pktl = track->mdat_queue.head; pktl; pktl = pktl->next)
+                avio_write(s->pb, pktl->pkt.data, pktl->pkt.size);
+            avpriv_packet_list_free(&track->mdat_queue);
+            track->mdat_queue_size = 0;
             if (!track->mdat_buf)
                 continue;
             buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
@@ -6242,6 +6317,14 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             if (ret) {
                 goto err;
             }
+        } else if (pb == trk->mdat_buf && !mov->frag_interleave && !avio_tell(pb)) {
+            /* Keep a reference instead of copying the payload into the
+             * fragment buffer. Once anything was written to the buffer,
+             * packets have to go there as well to keep their order. */
+            ret = avpriv_packet_list_put(&trk->mdat_queue, pkt, av_packet_ref, 0);
+            if (ret < 0)
+                goto err;
+            trk->mdat_queue_size += size;
         } else {
             avio_write(pb, pkt->data, size);
         }
@@ -6258,7 +6341,8 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         trk->cluster_capacity = new_capacity;
     }
 
-    trk->cluster[trk->entry].pos              = avio_tell(pb) - size;
+    /* The queued packets precede the contents of the fragment buffer */
+    trk->cluster[trk->entry].pos              = avio_tell(pb) + trk->mdat_queue_size - size;
     trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
     trk->cluster[trk->entry].chunkNum         = 0;
     trk->cluster[trk->entry].size             = size;
@@ -6844,12 +6928,15 @@ static void mov_free(AVFormatContext *s)
 
         ff_mov_cenc_free(&track->cenc);
         ffio_free_dyn_buf(&track->mdat_buf);
+        avpriv_packet_list_free(&track->mdat_queue);
 
         avpriv_packet_list_free(&track->squashed_packet_queue);
     }
 
     av_freep(&mov->tracks);
     ffio_free_dyn_buf(&mov->mdat_buf);
+    ffio_free_dyn_buf(&mov->moof_buf);
+    av_freep(&mov->moof_patches);
 }
 
 static uint32_t rgb_to_yuv(uint32_t rgb)
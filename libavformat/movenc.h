@@ -83,6 +83,15 @@ typedef struct MOVFragmentInfo {
     int size;
 } MOVFragmentInfo;
 
+/**
+ * Field of a moof built in MOVMuxContext.moof_buf which depends on the
+ * moof size or position, only known once the whole box has been built.
+ */
+typedef struct MOVMoofPatch {
+    int pos;         ///< offset of the field in moof_buf
+    int base_offset; ///< 64 bit tfhd base data offset if set, 32 bit trun data offset otherwise
+} MOVMoofPatch;
+
 typedef struct MOVTrack {
     int         mode;
     int         entry;
@@ -140,6 +149,8 @@ typedef struct MOVTrack {
     AVPacket *cover_image;
 
     AVIOContext *mdat_buf;
+    PacketList  mdat_queue;      ///< packets referenced by the current fragment, written before mdat_buf
+    int64_t     mdat_queue_size;
     int64_t     data_offset;
     int         frag_discont;
     int         entries_flushed;
@@ -211,6 +222,11 @@ typedef struct MOVMuxContext {
     AVIOContext *mdat_buf;
     int first_trun;
 
+    AVIOContext *moof_buf;  ///< reused to build the moof of every fragment
+    MOVMoofPatch *moof_patches;
+    int nb_moof_patches;
+    unsigned moof_patches_size;
+
     int video_track_timescale;
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
@@ -139,6 +139,7 @@ const AVInputFormat ff_pcm_ ## name_ ## _demuxer = {        \
     .read_packet    = ff_pcm_read_packet,                   \
     .read_seek      = ff_pcm_read_seek,                     \
     .flags          = AVFMT_GENERIC_INDEX,                  \
+    .flags_internal = FF_FMT_PREFETCH,                      \
     .extensions     = ext,                                  \
     .raw_codec_id   = codec,                                \
     .priv_class     = &pcm_demuxer_class,                   \
@@ -204,6 +205,7 @@ const AVInputFormat ff_sln_demuxer = {
     .read_packet    = ff_pcm_read_packet,
     .read_seek      = ff_pcm_read_seek,
     .flags          = AVFMT_GENERIC_INDEX,
+    .flags_internal = FF_FMT_PREFETCH,
     .extensions     = "sln",
     .raw_codec_id   = AV_CODEC_ID_PCM_S16LE,
     .priv_class     = &sln_demuxer_class,
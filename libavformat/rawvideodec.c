@@ -33,6 +33,7 @@ typedef struct RawVideoDemuxerContext {
     int width, height;        /**< Integers describing video size, set by a private option. */
     char *pixel_format;       /**< Set by a private option. */
     AVRational framerate;     /**< AVRational describing framerate, set by a private option. */
+    AVBufferPool *pool;       /**< packet buffers, all frames having the same size */
 } RawVideoDemuxerContext;
 
 // v210 frame width is padded to multiples of 48
@@ -115,15 +116,23 @@ static int rawvideo_read_header(AVFormatContext *ctx)
     st->codecpar->bit_rate = av_rescale_q(ctx->packet_size,
                                        (AVRational){8,1}, st->time_base);
 
+    if (packet_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+    s->pool = av_buffer_pool_init(packet_size + AV_INPUT_BUFFER_PADDING_SIZE, NULL);
+    if (!s->pool)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
 
 static int rawvideo_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
+    RawVideoDemuxerContext *c = s->priv_data;
     int ret;
 
-    ret = av_get_packet(s->pb, pkt, s->packet_size);
+    ret = ff_get_mapped_packet(s->pb, pkt, s->packet_size, s->streams[0]->codecpar,
+                               c->pool);
     pkt->pts = pkt->dts = pkt->pos / s->packet_size;
 
     pkt->stream_index = 0;
@@ -132,6 +141,14 @@ static int rawvideo_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+static int rawvideo_read_close(AVFormatContext *s)
+{
+    RawVideoDemuxerContext *c = s->priv_data;
+
+    av_buffer_pool_uninit(&c->pool);
+    return 0;
+}
+
 #define OFFSET(x) offsetof(RawVideoDemuxerContext, x)
 #define DEC AV_OPT_FLAG_DECODING_PARAM
 static const AVOption rawvideo_options[] = {
@@ -155,7 +172,9 @@ const AVInputFormat ff_rawvideo_demuxer = {
     .priv_data_size = sizeof(RawVideoDemuxerContext),
     .read_header    = rawvideo_read_header,
     .read_packet    = rawvideo_read_packet,
+    .read_close     = rawvideo_read_close,
     .flags          = AVFMT_GENERIC_INDEX,
+    .flags_internal = FF_FMT_PREFETCH,
     .extensions     = "yuv,cif,qcif,rgb",
     .raw_codec_id   = AV_CODEC_ID_RAWVIDEO,
     .priv_class     = &rawvideo_demuxer_class,
@@ -175,7 +194,9 @@ const AVInputFormat ff_bitpacked_demuxer = {
     .priv_data_size = sizeof(RawVideoDemuxerContext),
     .read_header    = rawvideo_read_header,
     .read_packet    = rawvideo_read_packet,
+    .read_close     = rawvideo_read_close,
     .flags          = AVFMT_GENERIC_INDEX,
+    .flags_internal = FF_FMT_PREFETCH,
     .extensions     = "bitpacked",
     .raw_codec_id   = AV_CODEC_ID_BITPACKED,
     .priv_class     = &bitpacked_demuxer_class,
@@ -196,7 +217,9 @@ const AVInputFormat ff_v210_demuxer = {
     .priv_data_size = sizeof(RawVideoDemuxerContext),
     .read_header    = rawvideo_read_header,
     .read_packet    = rawvideo_read_packet,
+    .read_close     = rawvideo_read_close,
     .flags          = AVFMT_GENERIC_INDEX,
+    .flags_internal = FF_FMT_PREFETCH,
     .extensions     = "v210",
     .raw_codec_id   = AV_CODEC_ID_V210,
     .priv_class     = &v210_demuxer_class,
@@ -210,7 +233,9 @@ const AVInputFormat ff_v210x_demuxer = {
     .priv_data_size = sizeof(RawVideoDemuxerContext),
     .read_header    = rawvideo_read_header,
     .read_packet    = rawvideo_read_packet,
+    .read_close     = rawvideo_read_close,
     .flags          = AVFMT_GENERIC_INDEX,
+    .flags_internal = FF_FMT_PREFETCH,
     .extensions     = "yuv10",
     .raw_codec_id   = AV_CODEC_ID_V210X,
     .priv_class     = &v210_demuxer_class,
@@ -276,6 +276,166 @@ const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
     return &sti->index_entries[idx];
 }
 
+int avformat_index_group_timestamps(AVStream *st, const int64_t *ts, int nb_ts,
+                                    int64_t *key_ts)
+{
+    const FFStream *const sti = ffstream(st);
+    int nb_groups = 0;
+
+    for (int i = 0; i < nb_ts; i++) {
+        int idx;
+
+        if (i && ts[i] < ts[i - 1])
+            return AVERROR(EINVAL);
+
+        idx = ff_index_search_timestamp(sti->index_entries, sti->nb_index_entries,
+                                        ts[i], AVSEEK_FLAG_BACKWARD);
+        key_ts[i] = idx >= 0 ? sti->index_entries[idx].timestamp : AV_NOPTS_VALUE;
+        if (!i || key_ts[i] == AV_NOPTS_VALUE || key_ts[i] != key_ts[i - 1])
+            nb_groups++;
+    }
+
+    return nb_groups;
+}
+
+int avformat_read_frames_at(AVFormatContext *s, int stream_index,
+                            AVCodecContext *dec_ctx,
+                            const int64_t *ts, int nb_ts,
+                            int (*packet_cb)(void *opaque, AVPacket *pkt),
+                            int (*frame_cb)(void *opaque, AVFrame *frame),
+                            void *opaque)
+{
+    AVStream *st;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL;
+    int64_t *key_ts = NULL, start_ts, last_ts = AV_NOPTS_VALUE;
+    int ret, nb_groups, next = 0;
+
+    if (stream_index < 0 || stream_index >= s->nb_streams || !frame_cb)
+        return AVERROR(EINVAL);
+    st = s->streams[stream_index];
+
+    key_ts = av_malloc_array(nb_ts, sizeof(*key_ts));
+    frame  = av_frame_alloc();
+    pkt    = av_packet_alloc();
+    if (!key_ts || !frame || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    nb_groups = avformat_index_group_timestamps(st, ts, nb_ts, key_ts);
+    if (nb_groups < 0) {
+        ret = nb_groups;
+        goto end;
+    }
+    av_log(s, AV_LOG_VERBOSE, "Reading %d frames in %d groups\n", nb_ts, nb_groups);
+    start_ts = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+
+    while (next < nb_ts) {
+        int64_t seek_ts, backoff = 0;
+        int group_end, retry;
+
+        /* targets before the last frame found were found with it */
+        if (last_ts != AV_NOPTS_VALUE && ts[next] <= last_ts) {
+            next++;
+            continue;
+        }
+        seek_ts   = ts[next];
+        group_end = next + 1;
+        while (group_end < nb_ts && key_ts[group_end] != AV_NOPTS_VALUE &&
+               key_ts[group_end] == key_ts[next])
+            group_end++;
+
+        do {
+            int64_t first_dts = AV_NOPTS_VALUE;
+            int eof = 0, first_frame = 1;
+
+            retry = 0;
+            av_log(s, AV_LOG_VERBOSE, "Seeking to %s for frame at %s\n",
+                   seek_ts == INT64_MIN ? "start" : av_ts2timestr(seek_ts, &st->time_base),
+                   av_ts2timestr(ts[next], &st->time_base));
+            avcodec_flush_buffers(dec_ctx);
+            ret = avformat_seek_file(s, stream_index, INT64_MIN, seek_ts, seek_ts, 0);
+            if (ret < 0) {
+                av_log(s, AV_LOG_ERROR, "Could not seek to position %s: %s\n",
+                       av_ts2timestr(seek_ts, &st->time_base), av_err2str(ret));
+                goto end;
+            }
+
+            while (next < group_end && !eof && !retry) {
+                eof = av_read_frame(s, pkt) < 0;
+                if (!eof) {
+                    if (pkt->stream_index != stream_index) {
+                        av_packet_unref(pkt);
+                        continue;
+                    }
+                    if (first_dts == AV_NOPTS_VALUE)
+                        first_dts = pkt->dts;
+                    if (packet_cb && (ret = packet_cb(opaque, pkt)) < 0)
+                        goto end;
+                }
+
+                ret = avcodec_send_packet(dec_ctx, eof ? NULL : pkt);
+                av_packet_unref(pkt);
+                if (ret < 0 && ret != AVERROR_EOF)
+                    av_log(s, AV_LOG_WARNING, "Error sending packet to the decoder: %s\n",
+                           av_err2str(ret));
+
+                while (next < group_end && !retry &&
+                       avcodec_receive_frame(dec_ctx, frame) >= 0) {
+                    int64_t t = frame->best_effort_timestamp;
+
+                    /* The index holds decoding timestamps and some demuxers
+                     * seek to any packet: the target may precede the first
+                     * decodable frame and need an earlier keyframe. */
+                    if (first_frame && t != AV_NOPTS_VALUE && t > ts[next] &&
+                        seek_ts != INT64_MIN) {
+                        backoff = FFMAX(2 * backoff, t - ts[next]);
+                        retry   = 1;
+                    } else if (t != AV_NOPTS_VALUE && t >= ts[next]) {
+                        while (next < group_end && ts[next] <= t)
+                            next++;
+                        last_ts = t;
+                        ret = frame_cb(opaque, frame);
+                        if (ret < 0)
+                            goto end;
+                    }
+                    first_frame = 0;
+                    av_frame_unref(frame);
+                }
+
+                if (eof && first_frame && seek_ts != INT64_MIN) {
+                    backoff = FFMAX(2 * backoff, av_rescale_q(1, (AVRational){ 1, 1 },
+                                                              st->time_base));
+                    retry   = 1;
+                }
+            }
+
+            if (retry) {
+                int64_t prev = seek_ts;
+                seek_ts = ts[next] - backoff;
+                if (first_dts != AV_NOPTS_VALUE)
+                    seek_ts = FFMIN(seek_ts, first_dts - 1);
+                seek_ts = FFMIN(seek_ts, prev - 1);
+                /* last resort, decode from the beginning */
+                if (seek_ts <= start_ts)
+                    seek_ts = INT64_MIN;
+            }
+        } while (retry);
+
+        /* the stream ended before the remaining targets */
+        if (next < group_end)
+            break;
+    }
+    ret = next;
+
+end:
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    av_free(key_ts);
+    return ret;
+}
+
 static int64_t read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
                               int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ))
 {
@@ -641,6 +801,8 @@ int av_seek_frame(AVFormatContext *s, int stream_index,
 {
     int ret;
 
+    ff_demux_prefetch_stop(s);
+
     if (s->iformat->read_seek2 && !s->iformat->read_seek) {
         int64_t min_ts = INT64_MIN, max_ts = INT64_MAX;
         if ((flags & AVSEEK_FLAG_BACKWARD))
@@ -667,6 +829,8 @@ int avformat_seek_file(AVFormatContext *s, int stream_index, int64_t min_ts,
     if (stream_index < -1 || stream_index >= (int)s->nb_streams)
         return AVERROR(EINVAL);
 
+    ff_demux_prefetch_stop(s);
+
     if (s->seek2any > 0)
         flags |= AVSEEK_FLAG_ANY;
     flags &= ~AVSEEK_FLAG_BACKWARD;
@@ -754,6 +918,7 @@ void ff_read_frame_flush(AVFormatContext *s)
 
 int avformat_flush(AVFormatContext *s)
 {
+    ff_demux_prefetch_stop(s);
     ff_read_frame_flush(s);
     return 0;
 }
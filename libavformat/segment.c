@@ -43,6 +43,7 @@
 #include "libavutil/timecode.h"
 #include "libavutil/time_internal.h"
 #include "libavutil/timestamp.h"
+#include "libavutil/thread.h"
 
 typedef struct SegmentListEntry {
     int index;
@@ -126,6 +127,29 @@ typedef struct SegmentContext {
     SegmentListEntry cur_entry;
     SegmentListEntry *segment_list_entries;
     SegmentListEntry *segment_list_entries_end;
+
+    int use_async;         ///< open and finish segments in a separate thread
+#if HAVE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int thread_started;
+    int thread_exit;
+
+    /* next segment output, opened by the thread */
+    int prep_pending;
+    char *prep_url;
+    AVIOContext *prep_pb;
+
+    /* finished segment, closed by the thread */
+    int fin_pending;
+    int fin_ret;
+    AVFormatContext *fin_avf;  ///< segment muxer to write the trailer for, if any
+    AVIOContext *fin_pb;       ///< segment output to close, if no trailer is written
+    char *fin_url;
+    SegmentListEntry fin_entry;
+    int fin_count;
+#endif
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -189,31 +213,40 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
-static int set_segment_filename(AVFormatContext *s)
+static int segment_filename(AVFormatContext *s, void *log_ctx, int idx,
+                            char *buf, int buf_size)
 {
     SegmentContext *seg = s->priv_data;
-    AVFormatContext *oc = seg->avf;
-    size_t size;
-    int ret;
-    char buf[1024];
-    char *new_name;
 
-    if (seg->segment_idx_wrap)
-        seg->segment_idx %= seg->segment_idx_wrap;
     if (seg->use_strftime) {
         time_t now0;
         struct tm *tm, tmpbuf;
         time(&now0);
         tm = localtime_r(&now0, &tmpbuf);
-        if (!strftime(buf, sizeof(buf), s->url, tm)) {
-            av_log(oc, AV_LOG_ERROR, "Could not get segment filename with strftime\n");
+        if (!strftime(buf, buf_size, s->url, tm)) {
+            av_log(log_ctx, AV_LOG_ERROR, "Could not get segment filename with strftime\n");
             return AVERROR(EINVAL);
         }
-    } else if (av_get_frame_filename(buf, sizeof(buf),
-                                     s->url, seg->segment_idx) < 0) {
-        av_log(oc, AV_LOG_ERROR, "Invalid segment filename template '%s'\n", s->url);
+    } else if (av_get_frame_filename(buf, buf_size, s->url, idx) < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Invalid segment filename template '%s'\n", s->url);
         return AVERROR(EINVAL);
     }
+    return 0;
+}
+
+static int set_segment_filename(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    size_t size;
+    int ret;
+    char buf[1024];
+    char *new_name;
+
+    if (seg->segment_idx_wrap)
+        seg->segment_idx %= seg->segment_idx_wrap;
+    if ((ret = segment_filename(s, oc, seg->segment_idx, buf, sizeof(buf))) < 0)
+        return ret;
     new_name = av_strdup(buf);
     if (!new_name)
         return AVERROR(ENOMEM);
@@ -233,51 +266,6 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
-static int segment_start(AVFormatContext *s, int write_header)
-{
-    SegmentContext *seg = s->priv_data;
-    AVFormatContext *oc = seg->avf;
-    int err = 0;
-
-    if (write_header) {
-        avformat_free_context(oc);
-        seg->avf = NULL;
-        if ((err = segment_mux_init(s)) < 0)
-            return err;
-        oc = seg->avf;
-    }
-
-    seg->segment_idx++;
-    if ((seg->segment_idx_wrap) && (seg->segment_idx % seg->segment_idx_wrap == 0))
-        seg->segment_idx_wrap_nb++;
-
-    if ((err = set_segment_filename(s)) < 0)
-        return err;
-
-    if ((err = s->io_open(s, &oc->pb, oc->url, AVIO_FLAG_WRITE, NULL)) < 0) {
-        av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->url);
-        return err;
-    }
-    if (!seg->individual_header_trailer)
-        oc->pb->seekable = 0;
-
-    if (oc->oformat->priv_class && oc->priv_data)
-        av_opt_set(oc->priv_data, "mpegts_flags", "+resend_headers", 0);
-
-    if (write_header) {
-        AVDictionary *options = NULL;
-        av_dict_copy(&options, seg->format_options, 0);
-        av_dict_set(&options, "fflags", "-autobsf", 0);
-        err = avformat_write_header(oc, &options);
-        av_dict_free(&options);
-        if (err < 0)
-            return err;
-    }
-
-    seg->segment_frame_count = 0;
-    return 0;
-}
-
 static int segment_list_open(AVFormatContext *s)
 {
     SegmentContext *seg = s->priv_data;
@@ -348,11 +336,54 @@ static void segment_list_print_entry(AVIOContext      *list_ioctx,
     }
 }
 
-static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
+static int segment_list_add_entry(AVFormatContext *s, const SegmentListEntry *cur_entry,
+                                  int segment_count, int is_last)
 {
     SegmentContext *seg = s->priv_data;
-    AVFormatContext *oc = seg->avf;
     int ret = 0;
+
+    if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
+        SegmentListEntry *entry = av_mallocz(sizeof(*entry));
+        if (!entry)
+            return AVERROR(ENOMEM);
+
+        /* append new element */
+        memcpy(entry, cur_entry, sizeof(*entry));
+        entry->filename = av_strdup(entry->filename);
+        if (!seg->segment_list_entries)
+            seg->segment_list_entries = seg->segment_list_entries_end = entry;
+        else
+            seg->segment_list_entries_end->next = entry;
+        seg->segment_list_entries_end = entry;
+
+        /* drop first item */
+        if (seg->list_size && segment_count >= seg->list_size) {
+            entry = seg->segment_list_entries;
+            seg->segment_list_entries = seg->segment_list_entries->next;
+            av_freep(&entry->filename);
+            av_freep(&entry);
+        }
+
+        if ((ret = segment_list_open(s)) < 0)
+            return ret;
+        for (entry = seg->segment_list_entries; entry; entry = entry->next)
+            segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
+        if (seg->list_type == LIST_TYPE_M3U8 && is_last)
+            avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
+        ff_format_io_close(s, &seg->list_pb);
+        if (seg->use_rename)
+            ff_rename(seg->temp_list_filename, seg->list, s);
+    } else {
+        segment_list_print_entry(seg->list_pb, seg->list_type, cur_entry, s);
+        avio_flush(seg->list_pb);
+    }
+
+    return ret;
+}
+
+static void segment_increment_tc(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
     AVTimecode tc;
     AVRational rate;
     AVDictionaryEntry *tcr;
@@ -360,6 +391,50 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     int i;
     int err;
 
+    tcr = av_dict_get(s->metadata, "timecode", NULL, 0);
+    if (tcr) {
+        /* search the first video stream */
+        for (i = 0; i < s->nb_streams; i++) {
+            if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                rate = s->streams[i]->avg_frame_rate;/* Get fps from the video stream */
+                err = av_timecode_init_from_string(&tc, rate, tcr->value, s);
+                if (err < 0) {
+                    av_log(s, AV_LOG_WARNING, "Could not increment global timecode, error occurred during timecode creation.\n");
+                    break;
+                }
+                tc.start += (int)((seg->cur_entry.end_time - seg->cur_entry.start_time) * av_q2d(rate));/* increment timecode */
+                av_dict_set(&s->metadata, "timecode",
+                            av_timecode_make_string(&tc, buf, 0), 0);
+                break;
+            }
+        }
+    } else {
+        av_log(s, AV_LOG_WARNING, "Could not increment global timecode, no global timecode metadata found.\n");
+    }
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            char st_buf[AV_TIMECODE_STR_SIZE];
+            AVTimecode st_tc;
+            AVRational st_rate = s->streams[i]->avg_frame_rate;
+            AVDictionaryEntry *st_tcr = av_dict_get(s->streams[i]->metadata, "timecode", NULL, 0);
+            if (st_tcr) {
+                if ((av_timecode_init_from_string(&st_tc, st_rate, st_tcr->value, s) < 0)) {
+                    av_log(s, AV_LOG_WARNING, "Could not increment stream %d timecode, error occurred during timecode creation.\n", i);
+                    continue;
+                }
+            st_tc.start += (int)((seg->cur_entry.end_time - seg->cur_entry.start_time) * av_q2d(st_rate));    // increment timecode
+            av_dict_set(&s->streams[i]->metadata, "timecode", av_timecode_make_string(&st_tc, st_buf, 0), 0);
+            }
+        }
+    }
+}
+
+static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    int ret = 0;
+
     if (!oc || !oc->pb)
         return AVERROR(EINVAL);
 
@@ -372,94 +447,300 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
                oc->url);
 
     if (seg->list) {
-        if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
-            SegmentListEntry *entry = av_mallocz(sizeof(*entry));
-            if (!entry) {
-                ret = AVERROR(ENOMEM);
-                goto end;
-            }
-
-            /* append new element */
-            memcpy(entry, &seg->cur_entry, sizeof(*entry));
-            entry->filename = av_strdup(entry->filename);
-            if (!seg->segment_list_entries)
-                seg->segment_list_entries = seg->segment_list_entries_end = entry;
-            else
-                seg->segment_list_entries_end->next = entry;
-            seg->segment_list_entries_end = entry;
-
-            /* drop first item */
-            if (seg->list_size && seg->segment_count >= seg->list_size) {
-                entry = seg->segment_list_entries;
-                seg->segment_list_entries = seg->segment_list_entries->next;
-                av_freep(&entry->filename);
-                av_freep(&entry);
-            }
-
-            if ((ret = segment_list_open(s)) < 0)
-                goto end;
-            for (entry = seg->segment_list_entries; entry; entry = entry->next)
-                segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
-            if (seg->list_type == LIST_TYPE_M3U8 && is_last)
-                avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
-            ff_format_io_close(s, &seg->list_pb);
-            if (seg->use_rename)
-                ff_rename(seg->temp_list_filename, seg->list, s);
-        } else {
-            segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
-            avio_flush(seg->list_pb);
-        }
+        if ((ret = segment_list_add_entry(s, &seg->cur_entry, seg->segment_count, is_last)) < 0)
+            goto end;
     }
 
     av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
            seg->avf->url, seg->segment_count);
     seg->segment_count++;
 
-    if (seg->increment_tc) {
-        tcr = av_dict_get(s->metadata, "timecode", NULL, 0);
-        if (tcr) {
-            /* search the first video stream */
-            for (i = 0; i < s->nb_streams; i++) {
-                if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                    rate = s->streams[i]->avg_frame_rate;/* Get fps from the video stream */
-                    err = av_timecode_init_from_string(&tc, rate, tcr->value, s);
-                    if (err < 0) {
-                        av_log(s, AV_LOG_WARNING, "Could not increment global timecode, error occurred during timecode creation.\n");
-                        break;
-                    }
-                    tc.start += (int)((seg->cur_entry.end_time - seg->cur_entry.start_time) * av_q2d(rate));/* increment timecode */
-                    av_dict_set(&s->metadata, "timecode",
-                                av_timecode_make_string(&tc, buf, 0), 0);
-                    break;
-                }
+    if (seg->increment_tc)
+        segment_increment_tc(s);
+
+end:
+    ff_format_io_close(oc, &oc->pb);
+
+    return ret;
+}
+
+#if HAVE_THREADS
+static void *segment_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&seg->lock);
+    for (;;) {
+        if (seg->prep_pending) {
+            AVIOContext *pb = NULL;
+
+            pthread_mutex_unlock(&seg->lock);
+            /* An existing output is only overwritten once its segment
+             * actually starts. */
+            if (s->io_open(s, &pb, seg->prep_url, AVIO_FLAG_READ, NULL) >= 0) {
+                ff_format_io_close(s, &pb);
+                av_log(s, AV_LOG_VERBOSE, "Segment '%s' exists, not preparing it\n",
+                       seg->prep_url);
+            } else {
+                ret = s->io_open(s, &pb, seg->prep_url, AVIO_FLAG_WRITE, NULL);
+                if (ret < 0)
+                    av_log(s, AV_LOG_WARNING, "Failed to prepare segment '%s'\n",
+                           seg->prep_url);
             }
-        } else {
-            av_log(s, AV_LOG_WARNING, "Could not increment global timecode, no global timecode metadata found.\n");
-        }
-        for (i = 0; i < s->nb_streams; i++) {
-            if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                char st_buf[AV_TIMECODE_STR_SIZE];
-                AVTimecode st_tc;
-                AVRational st_rate = s->streams[i]->avg_frame_rate;
-                AVDictionaryEntry *st_tcr = av_dict_get(s->streams[i]->metadata, "timecode", NULL, 0);
-                if (st_tcr) {
-                    if ((av_timecode_init_from_string(&st_tc, st_rate, st_tcr->value, s) < 0)) {
-                        av_log(s, AV_LOG_WARNING, "Could not increment stream %d timecode, error occurred during timecode creation.\n", i);
-                        continue;
-                    }
-                st_tc.start += (int)((seg->cur_entry.end_time - seg->cur_entry.start_time) * av_q2d(st_rate));    // increment timecode
-                av_dict_set(&s->streams[i]->metadata, "timecode", av_timecode_make_string(&st_tc, st_buf, 0), 0);
-                }
+            pthread_mutex_lock(&seg->lock);
+
+            seg->prep_pb = pb;
+            seg->prep_pending = 0;
+            pthread_cond_broadcast(&seg->cond);
+        } else if (seg->fin_pending) {
+            AVFormatContext *oc = seg->fin_avf;
+
+            pthread_mutex_unlock(&seg->lock);
+            ret = 0;
+            if (oc) {
+                ret = av_write_trailer(oc);
+                if (ret < 0)
+                    av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                           oc->url);
+                ff_format_io_close(oc, &oc->pb);
+                avformat_free_context(oc);
+            } else {
+                ff_format_io_close(s, &seg->fin_pb);
             }
+            /* Only list the segment once its output is complete. */
+            if (seg->list && ret >= 0)
+                ret = segment_list_add_entry(s, &seg->fin_entry, seg->fin_count, 0);
+            av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
+                   seg->fin_url, seg->fin_count);
+            pthread_mutex_lock(&seg->lock);
+
+            seg->fin_avf = NULL;
+            seg->fin_ret = ret;
+            seg->fin_pending = 0;
+            pthread_cond_broadcast(&seg->cond);
+        } else if (seg->thread_exit) {
+            break;
+        } else {
+            pthread_cond_wait(&seg->cond, &seg->lock);
         }
     }
+    pthread_mutex_unlock(&seg->lock);
 
-end:
-    ff_format_io_close(oc, &oc->pb);
+    return NULL;
+}
+
+/* Wait for the thread to be done with the previous segments, and return the
+ * result of finishing them. */
+static int segment_async_wait(SegmentContext *seg)
+{
+    int ret;
+
+    pthread_mutex_lock(&seg->lock);
+    while (seg->fin_pending || seg->prep_pending)
+        pthread_cond_wait(&seg->cond, &seg->lock);
+    ret = seg->fin_ret;
+    seg->fin_ret = 0;
+    pthread_mutex_unlock(&seg->lock);
 
     return ret;
 }
 
+static void segment_async_wait_prepared(SegmentContext *seg)
+{
+    pthread_mutex_lock(&seg->lock);
+    while (seg->prep_pending)
+        pthread_cond_wait(&seg->cond, &seg->lock);
+    pthread_mutex_unlock(&seg->lock);
+}
+
+/* Must be called with no output being prepared. */
+static void segment_async_discard_prepared(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+
+    ff_format_io_close(s, &seg->prep_pb);
+    av_freep(&seg->prep_url);
+}
+
+/* Request opening the output for the segment following the current one. */
+static int segment_async_prepare(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int idx = seg->segment_idx + 1;
+    char buf[1024];
+    int ret;
+
+    /* With wrapping, the next segment overwrites an earlier one, which may
+     * still be listed and must be left alone until the switch. */
+    if (seg->segment_idx_wrap)
+        return 0;
+
+    if ((ret = segment_filename(s, s, idx, buf, sizeof(buf))) < 0)
+        return ret;
+
+    pthread_mutex_lock(&seg->lock);
+    av_freep(&seg->prep_url);
+    if (!(seg->prep_url = av_strdup(buf))) {
+        pthread_mutex_unlock(&seg->lock);
+        return AVERROR(ENOMEM);
+    }
+    seg->prep_pending = 1;
+    pthread_cond_broadcast(&seg->cond);
+    pthread_mutex_unlock(&seg->lock);
+
+    return 0;
+}
+
+/* Hand the current segment to the thread, which writes its trailer, closes
+ * it and adds it to the list. */
+static int segment_end_async(AVFormatContext *s, int write_trailer)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    int ret;
+
+    if (!oc || !oc->pb)
+        return AVERROR(EINVAL);
+
+    av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
+
+    if ((ret = segment_async_wait(seg)) < 0)
+        return ret;
+
+    av_freep(&seg->fin_url);
+    av_freep(&seg->fin_entry.filename);
+    seg->fin_url = av_strdup(oc->url);
+    seg->fin_entry = seg->cur_entry;
+    seg->fin_entry.filename = av_strdup(seg->cur_entry.filename);
+    if (!seg->fin_url || !seg->fin_entry.filename)
+        return AVERROR(ENOMEM);
+    seg->fin_count = seg->segment_count;
+    if (write_trailer) {
+        seg->fin_avf = oc;
+        seg->avf = NULL;
+    } else {
+        seg->fin_pb = oc->pb;
+        oc->pb = NULL;
+    }
+
+    pthread_mutex_lock(&seg->lock);
+    seg->fin_pending = 1;
+    pthread_cond_broadcast(&seg->cond);
+    pthread_mutex_unlock(&seg->lock);
+
+    seg->segment_count++;
+
+    if (seg->increment_tc)
+        segment_increment_tc(s);
+
+    return 0;
+}
+
+static int segment_async_start(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    pthread_mutex_init(&seg->lock, NULL);
+    pthread_cond_init(&seg->cond, NULL);
+    if ((ret = pthread_create(&seg->thread, NULL, segment_thread, s))) {
+        av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&seg->cond);
+        pthread_mutex_destroy(&seg->lock);
+        return AVERROR(ret);
+    }
+    seg->thread_started = 1;
+
+    return 0;
+}
+
+static void segment_async_stop(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+
+    if (!seg->thread_started)
+        return;
+
+    /* Pending segments are still finished before the thread exits. */
+    pthread_mutex_lock(&seg->lock);
+    seg->thread_exit = 1;
+    pthread_cond_broadcast(&seg->cond);
+    pthread_mutex_unlock(&seg->lock);
+    pthread_join(seg->thread, NULL);
+    seg->thread_started = 0;
+
+    pthread_cond_destroy(&seg->cond);
+    pthread_mutex_destroy(&seg->lock);
+
+    segment_async_discard_prepared(s);
+    av_freep(&seg->fin_url);
+    av_freep(&seg->fin_entry.filename);
+}
+#endif
+
+static int segment_start(AVFormatContext *s, int write_header)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    int err = 0;
+
+    if (write_header) {
+        avformat_free_context(oc);
+        seg->avf = NULL;
+        if ((err = segment_mux_init(s)) < 0)
+            return err;
+        oc = seg->avf;
+    }
+
+    seg->segment_idx++;
+    if ((seg->segment_idx_wrap) && (seg->segment_idx % seg->segment_idx_wrap == 0))
+        seg->segment_idx_wrap_nb++;
+
+    if ((err = set_segment_filename(s)) < 0)
+        return err;
+
+#if HAVE_THREADS
+    if (seg->use_async) {
+        segment_async_wait_prepared(seg);
+        if (seg->prep_pb && !strcmp(seg->prep_url, oc->url)) {
+            oc->pb = seg->prep_pb;
+            seg->prep_pb = NULL;
+        }
+        segment_async_discard_prepared(s);
+    }
+#endif
+    if (!oc->pb &&
+        (err = s->io_open(s, &oc->pb, oc->url, AVIO_FLAG_WRITE, NULL)) < 0) {
+        av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->url);
+        return err;
+    }
+    if (!seg->individual_header_trailer)
+        oc->pb->seekable = 0;
+
+    if (oc->oformat->priv_class && oc->priv_data)
+        av_opt_set(oc->priv_data, "mpegts_flags", "+resend_headers", 0);
+
+    if (write_header) {
+        AVDictionary *options = NULL;
+        av_dict_copy(&options, seg->format_options, 0);
+        av_dict_set(&options, "fflags", "-autobsf", 0);
+        err = avformat_write_header(oc, &options);
+        av_dict_free(&options);
+        if (err < 0)
+            return err;
+    }
+
+    seg->segment_frame_count = 0;
+
+#if HAVE_THREADS
+    if (seg->use_async)
+        return segment_async_prepare(s);
+#endif
+    return 0;
+}
+
 static int parse_times(void *log_ctx, int64_t **times, int *nb_times,
                        const char *times_str)
 {
@@ -651,6 +932,9 @@ static void seg_free(AVFormatContext *s)
     SegmentContext *seg = s->priv_data;
     SegmentListEntry *cur;
 
+#if HAVE_THREADS
+    segment_async_stop(s);
+#endif
     ff_format_io_close(s, &seg->list_pb);
     if (seg->avf) {
         if (seg->is_nullctx)
@@ -690,6 +974,19 @@ static int seg_init(AVFormatContext *s)
         seg->individual_header_trailer = 0;
     }
 
+#if !HAVE_THREADS
+    if (seg->use_async) {
+        av_log(s, AV_LOG_WARNING, "Built without thread support, "
+               "segment_async is ignored\n");
+        seg->use_async = 0;
+    }
+#endif
+    if (seg->use_async && (seg->use_strftime || seg->segment_idx_wrap == 1)) {
+        av_log(s, AV_LOG_WARNING, "Consecutive segments may have the same name, "
+               "segment_async is ignored\n");
+        seg->use_async = 0;
+    }
+
     if (seg->initial_offset > 0) {
         av_log(s, AV_LOG_WARNING, "NOTE: the option initial_offset is deprecated,"
                "you can use output_ts_offset instead of it\n");
@@ -818,6 +1115,14 @@ static int seg_init(AVFormatContext *s)
     if (oc->avoid_negative_ts > 0 && s->avoid_negative_ts < 0)
         s->avoid_negative_ts = 1;
 
+#if HAVE_THREADS
+    if (seg->use_async) {
+        int err = segment_async_start(s);
+        if (err < 0)
+            return err;
+    }
+#endif
+
     return ret;
 }
 
@@ -847,6 +1152,10 @@ static int seg_write_header(AVFormatContext *s)
             oc->pb->seekable = 0;
     }
 
+#if HAVE_THREADS
+    if (seg->use_async)
+        return segment_async_prepare(s);
+#endif
     return 0;
 }
 
@@ -932,7 +1241,13 @@ calc_times:
         if (seg->cur_entry.last_duration == 0)
             seg->cur_entry.end_time = (double)pkt->pts * av_q2d(st->time_base);
 
-        if ((ret = segment_end(s, seg->individual_header_trailer, 0)) < 0)
+#if HAVE_THREADS
+        if (seg->use_async)
+            ret = segment_end_async(s, seg->individual_header_trailer);
+        else
+#endif
+        ret = segment_end(s, seg->individual_header_trailer, 0);
+        if (ret < 0)
             goto fail;
 
         if ((ret = segment_start(s, seg->individual_header_trailer)) < 0)
@@ -1003,6 +1318,14 @@ static int seg_write_trailer(struct AVFormatContext *s)
     if (!oc)
         return 0;
 
+#if HAVE_THREADS
+    if (seg->use_async) {
+        if ((ret = segment_async_wait(seg)) < 0)
+            return ret;
+        segment_async_discard_prepared(s);
+    }
+#endif
+
     if (!seg->write_header_trailer) {
         if ((ret = segment_end(s, 0, 1)) < 0)
             return ret;
@@ -1079,6 +1402,7 @@ static const AVOption options[] = {
     { "reset_timestamps", "reset timestamps at the beginning of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
     { "write_empty_segments", "allow writing empty 'filler' segments", OFFSET(write_empty), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
+    { "segment_async", "open and finish segments in a separate thread", OFFSET(use_async), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
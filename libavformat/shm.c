@@ -0,0 +1,510 @@
+/*
+ * Shared memory protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ *
+ * Shared memory url_protocol: a single producer, single consumer ring
+ * buffer in a POSIX shared memory object, for exchanging data between
+ * processes on the same host.
+ */
+
+/* for pthread_mutex_consistent() */
+#undef  _POSIX_C_SOURCE
+#undef  _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "libavutil/avstring.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/macros.h"
+#include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "url.h"
+
+#define SHM_MAGIC       MKTAG('F', 'S', 'H', 'M')
+#define SHM_DATA_OFFSET 4096
+/* interval at which blocked calls check the interrupt callback */
+#define SHM_POLL_TIME   100000
+
+/* Header at the start of the shared memory object, followed by the ring. */
+typedef struct SHMHeader {
+    atomic_uint magic;          ///< set last by the writer, once initialized
+    uint32_t pkt_size;          ///< maximum packet size, 0 in byte-stream mode
+    uint64_t size;              ///< size of the ring
+    pid_t writer_pid;           ///< set by the writer before initializing
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        ///< signaled when any field below changes
+    uint64_t write_pos;         ///< total number of bytes written
+    uint64_t read_pos;          ///< total number of bytes read
+    int writer_closed;
+    int reader_closed;
+    pid_t reader_pid;           ///< 0 until the reader has attached
+} SHMHeader;
+
+typedef struct SHMContext {
+    const AVClass *class;
+    char name[1024];
+    int64_t buffer_size;
+    int pkt_size;
+    int64_t timeout;
+
+    SHMHeader *hdr;
+    uint8_t *ring;
+    size_t map_size;
+} SHMContext;
+
+#define OFFSET(x) offsetof(SHMContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+#define E AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption shm_options[] = {
+    { "buffer_size", "set size of the ring buffer in bytes",                     OFFSET(buffer_size), AV_OPT_TYPE_INT64, { .i64 = 16 << 20 }, 4096, INT64_MAX / 2, E },
+    { "pkt_size",    "set maximum packet size, enables the packet-framed mode",  OFFSET(pkt_size),    AV_OPT_TYPE_INT,   { .i64 = 0 },        0,    INT_MAX - 4, E },
+    { "timeout",     "set timeout (in microseconds) of waiting for the peer",    OFFSET(timeout),     AV_OPT_TYPE_INT64, { .i64 = -1 },      -1,    INT64_MAX, D|E },
+    { NULL }
+};
+
+static const AVClass shm_class = {
+    .class_name = "shm",
+    .item_name  = av_default_item_name,
+    .option     = shm_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+static int64_t shm_timeout(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+
+    return s->timeout >= 0 ? s->timeout : h->rw_timeout;
+}
+
+static int shm_alive(pid_t pid)
+{
+    /* EPERM means that the process exists but belongs to another user */
+    return !kill(pid, 0) || errno == EPERM;
+}
+
+/* Mark the peer as gone when it died without closing, with hdr->lock held. */
+static void shm_peer_died(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+    int writer = h->flags & AVIO_FLAG_WRITE;
+
+    av_log(h, AV_LOG_WARNING, "The %s of '%s' died without closing it\n",
+           writer ? "reader" : "writer", s->name);
+    if (writer)
+        s->hdr->reader_closed = 1;
+    else
+        s->hdr->writer_closed = 1;
+}
+
+static void shm_lock(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+
+#if HAVE_PTHREAD_MUTEXATTR_SETROBUST
+    /* the lock is robust, the previous owner can only be the peer */
+    if (pthread_mutex_lock(&s->hdr->lock) == EOWNERDEAD) {
+        shm_peer_died(h);
+        pthread_mutex_consistent(&s->hdr->lock);
+    }
+#else
+    pthread_mutex_lock(&s->hdr->lock);
+#endif
+}
+
+/* Wait for the peer, with hdr->lock held. */
+static int shm_wait(URLContext *h, int64_t *wait_start)
+{
+    SHMContext *s = h->priv_data;
+    int writer = h->flags & AVIO_FLAG_WRITE;
+    pid_t peer = writer ? s->hdr->reader_pid : s->hdr->writer_pid;
+    int64_t timeout = shm_timeout(h);
+    int64_t now = av_gettime_relative();
+    int64_t abstime = av_gettime() + SHM_POLL_TIME;
+    struct timespec ts = { abstime / 1000000, abstime % 1000000 * 1000 };
+
+    if (h->flags & AVIO_FLAG_NONBLOCK)
+        return AVERROR(EAGAIN);
+    if (ff_check_interrupt(&h->interrupt_callback))
+        return AVERROR_EXIT;
+    /* a peer killed while waiting never marks itself as closed */
+    if (peer && !shm_alive(peer)) {
+        shm_peer_died(h);
+        return 0;
+    }
+    if (!*wait_start)
+        *wait_start = now;
+    else if (timeout > 0 && now - *wait_start > timeout)
+        return AVERROR(ETIMEDOUT);
+
+#if HAVE_PTHREAD_MUTEXATTR_SETROBUST
+    if (pthread_cond_timedwait(&s->hdr->cond, &s->hdr->lock, &ts) == EOWNERDEAD) {
+        shm_peer_died(h);
+        pthread_mutex_consistent(&s->hdr->lock);
+    }
+#else
+    pthread_cond_timedwait(&s->hdr->cond, &s->hdr->lock, &ts);
+#endif
+    return 0;
+}
+
+static void ring_read(SHMContext *s, uint64_t pos, uint8_t *buf, size_t size)
+{
+    size_t off = pos % s->hdr->size, len = FFMIN(size, s->hdr->size - off);
+
+    memcpy(buf, s->ring + off, len);
+    memcpy(buf + len, s->ring, size - len);
+}
+
+static void ring_write(SHMContext *s, uint64_t pos, const uint8_t *buf, size_t size)
+{
+    size_t off = pos % s->hdr->size, len = FFMIN(size, s->hdr->size - off);
+
+    memcpy(s->ring + off, buf, len);
+    memcpy(s->ring, buf + len, size - len);
+}
+
+static int shm_map(URLContext *h, int fd, size_t size)
+{
+    SHMContext *s = h->priv_data;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED)
+        return AVERROR(errno);
+    s->hdr      = map;
+    s->ring     = (uint8_t *)map + SHM_DATA_OFFSET;
+    s->map_size = size;
+    return 0;
+}
+
+/**
+ * Remove an object with the same name left by a writer that died before its
+ * reader attached, and fail if its writer is still running.
+ */
+static int shm_remove_stale(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+    const SHMHeader *hdr = MAP_FAILED;
+    struct stat st;
+    pid_t pid = 0;
+    int fd = shm_open(s->name, O_RDONLY, 0);
+
+    if (fd < 0)
+        return errno == ENOENT ? 0 : AVERROR(errno);
+    if (!fstat(fd, &st) && st.st_size > SHM_DATA_OFFSET)
+        hdr = mmap(NULL, SHM_DATA_OFFSET, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    /* an object that is not initialized yet is being created */
+    if (hdr != MAP_FAILED) {
+        if (atomic_load_explicit(&hdr->magic, memory_order_acquire) == SHM_MAGIC)
+            pid = hdr->writer_pid;
+        munmap((void *)hdr, SHM_DATA_OFFSET);
+    }
+    if (!pid || shm_alive(pid)) {
+        av_log(h, AV_LOG_ERROR, "Shared memory '%s' is in use by another writer\n",
+               s->name);
+        return AVERROR(EEXIST);
+    }
+
+    av_log(h, AV_LOG_WARNING, "Removing shared memory '%s' left by process %d\n",
+           s->name, (int)pid);
+    if (shm_unlink(s->name) < 0 && errno != ENOENT)
+        return AVERROR(errno);
+    return 0;
+}
+
+static int shm_create(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+    int fd, ret;
+
+    if (s->pkt_size && s->pkt_size + 4 > s->buffer_size) {
+        av_log(h, AV_LOG_ERROR, "pkt_size must be smaller than buffer_size\n");
+        return AVERROR(EINVAL);
+    }
+
+    fd = shm_open(s->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        if ((ret = shm_remove_stale(h)) < 0)
+            return ret;
+        fd = shm_open(s->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (fd < 0) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Could not create shared memory '%s': %s\n",
+               s->name, av_err2str(ret));
+        return ret;
+    }
+    if (ftruncate(fd, SHM_DATA_OFFSET + s->buffer_size) < 0)
+        ret = AVERROR(errno);
+    else
+        ret = shm_map(h, fd, SHM_DATA_OFFSET + s->buffer_size);
+    close(fd);
+    if (ret < 0) {
+        shm_unlink(s->name);
+        return ret;
+    }
+
+    s->hdr->size       = s->buffer_size;
+    s->hdr->pkt_size   = s->pkt_size;
+    s->hdr->writer_pid = getpid();
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+#if HAVE_PTHREAD_MUTEXATTR_SETROBUST
+    /* let the peer recover the lock if a process dies while holding it */
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&s->hdr->lock, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&s->hdr->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    atomic_store_explicit(&s->hdr->magic, SHM_MAGIC, memory_order_release);
+    return 0;
+}
+
+static int shm_attach(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+    int64_t timeout = shm_timeout(h);
+    int64_t wait_start = 0;
+
+    for (;;) {
+        int fd = shm_open(s->name, O_RDWR, 0);
+        struct stat st;
+        int ret;
+
+        if (fd < 0 && errno != ENOENT) {
+            ret = AVERROR(errno);
+            av_log(h, AV_LOG_ERROR, "Could not open shared memory '%s': %s\n",
+                   s->name, av_err2str(ret));
+            return ret;
+        }
+        if (fd >= 0) {
+            ret = fstat(fd, &st) < 0 ? AVERROR(errno) : 0;
+            if (!ret && st.st_size > SHM_DATA_OFFSET)
+                ret = shm_map(h, fd, st.st_size);
+            close(fd);
+            if (ret < 0)
+                return ret;
+            if (s->hdr) {
+                if (atomic_load_explicit(&s->hdr->magic, memory_order_acquire) == SHM_MAGIC &&
+                    s->hdr->size == st.st_size - SHM_DATA_OFFSET)
+                    break;
+                munmap(s->hdr, s->map_size);
+                s->hdr = NULL;
+            }
+        }
+
+        /* the writer has not created the object yet */
+        if (ff_check_interrupt(&h->interrupt_callback))
+            return AVERROR_EXIT;
+        if (!wait_start)
+            wait_start = av_gettime_relative();
+        else if (timeout > 0 && av_gettime_relative() - wait_start > timeout)
+            return AVERROR(ETIMEDOUT);
+        av_usleep(10000);
+    }
+
+    /* the mapping is all the reader needs from now on */
+    shm_unlink(s->name);
+
+    shm_lock(h);
+    s->hdr->reader_pid = getpid();
+    pthread_cond_broadcast(&s->hdr->cond);
+    pthread_mutex_unlock(&s->hdr->lock);
+
+    s->pkt_size = s->hdr->pkt_size;
+    return 0;
+}
+
+static int shm_open_url(URLContext *h, const char *url, int flags)
+{
+    SHMContext *s = h->priv_data;
+    int ret;
+
+    av_strstart(url, "shm:", &url);
+    if (!*url || ((flags & AVIO_FLAG_READ) && (flags & AVIO_FLAG_WRITE))) {
+        av_log(h, AV_LOG_ERROR, "A shared memory name and a single direction are required\n");
+        return AVERROR(EINVAL);
+    }
+    snprintf(s->name, sizeof(s->name), "%s%s", *url == '/' ? "" : "/", url);
+
+    ret = flags & AVIO_FLAG_WRITE ? shm_create(h) : shm_attach(h);
+    if (ret < 0)
+        return ret;
+
+    h->is_streamed     = 1;
+    h->max_packet_size = s->pkt_size;
+    return 0;
+}
+
+static int shm_read(URLContext *h, uint8_t *buf, int size)
+{
+    SHMContext *s = h->priv_data;
+    SHMHeader *hdr = s->hdr;
+    int64_t wait_start = 0;
+    uint64_t avail, consumed;
+    int ret = 0;
+
+    shm_lock(h);
+    while (!(avail = hdr->write_pos - hdr->read_pos)) {
+        if (hdr->writer_closed)
+            ret = AVERROR_EOF;
+        else
+            ret = shm_wait(h, &wait_start);
+        if (ret < 0)
+            break;
+    }
+    pthread_mutex_unlock(&hdr->lock);
+    if (ret < 0)
+        return ret;
+
+    /* Only this reader moves read_pos, and the writer does not touch the
+     * data before it, so the ring can be accessed without the lock. */
+    if (s->pkt_size) {
+        uint8_t len[4];
+
+        ring_read(s, hdr->read_pos, len, 4);
+        ret = AV_RL32(len);
+        consumed = 4 + ret;
+        if (ret > size) {
+            av_log(h, AV_LOG_WARNING, "Packet of %d bytes truncated to %d bytes\n",
+                   ret, size);
+            ret = size;
+        }
+        ring_read(s, hdr->read_pos + 4, buf, ret);
+    } else {
+        ret = FFMIN(size, avail);
+        consumed = ret;
+        ring_read(s, hdr->read_pos, buf, ret);
+    }
+
+    shm_lock(h);
+    hdr->read_pos += consumed;
+    pthread_cond_broadcast(&hdr->cond);
+    pthread_mutex_unlock(&hdr->lock);
+
+    return ret;
+}
+
+static int shm_write(URLContext *h, const uint8_t *buf, int size)
+{
+    SHMContext *s = h->priv_data;
+    SHMHeader *hdr = s->hdr;
+    int64_t wait_start = 0;
+    /* packets are written whole, byte-stream data in as many parts as needed */
+    uint64_t need = s->pkt_size ? 4 + size : 1;
+    int written = 0, ret = 0;
+
+    if (s->pkt_size && size > s->pkt_size) {
+        av_log(h, AV_LOG_ERROR, "Packet of %d bytes larger than pkt_size\n", size);
+        return AVERROR(EINVAL);
+    }
+
+    do {
+        uint64_t space, used;
+        int len;
+
+        shm_lock(h);
+        for (;;) {
+            /* nobody will ever read what would be written */
+            if (hdr->reader_closed)
+                ret = AVERROR(EPIPE);
+            else if ((space = hdr->size - (hdr->write_pos - hdr->read_pos)) >= need)
+                break;
+            else
+                ret = shm_wait(h, &wait_start);
+            if (ret < 0)
+                break;
+        }
+        pthread_mutex_unlock(&hdr->lock);
+        if (ret < 0)
+            return written && ret == AVERROR(EAGAIN) ? written : ret;
+
+        if (s->pkt_size) {
+            uint8_t hdr_len[4];
+
+            AV_WL32(hdr_len, size);
+            ring_write(s, hdr->write_pos, hdr_len, 4);
+            ring_write(s, hdr->write_pos + 4, buf, size);
+            len  = size;
+            used = 4 + size;
+        } else {
+            len  = FFMIN(size - written, space);
+            used = len;
+            ring_write(s, hdr->write_pos, buf + written, len);
+        }
+
+        shm_lock(h);
+        hdr->write_pos += used;
+        pthread_cond_broadcast(&hdr->cond);
+        pthread_mutex_unlock(&hdr->lock);
+
+        written += len;
+    } while (written < size);
+
+    return written;
+}
+
+static int shm_close(URLContext *h)
+{
+    SHMContext *s = h->priv_data;
+
+    if (!s->hdr)
+        return 0;
+
+    shm_lock(h);
+    if (h->flags & AVIO_FLAG_WRITE)
+        s->hdr->writer_closed = 1;
+    else
+        s->hdr->reader_closed = 1;
+    pthread_cond_broadcast(&s->hdr->cond);
+    pthread_mutex_unlock(&s->hdr->lock);
+    munmap(s->hdr, s->map_size);
+    s->hdr = NULL;
+    return 0;
+}
+
+const URLProtocol ff_shm_protocol = {
+    .name                = "shm",
+    .url_open            = shm_open_url,
+    .url_read            = shm_read,
+    .url_write           = shm_write,
+    .url_close           = shm_close,
+    .priv_data_size      = sizeof(SHMContext),
+    .priv_data_class     = &shm_class,
+};
@@ -20,9 +20,13 @@
  */
 
 
+#include "config.h"
+
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavcodec/bsf.h"
 #include "internal.h"
 #include "avformat.h"
@@ -36,6 +40,11 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    ON_QUEUE_FULL_BLOCK = 0,
+    ON_QUEUE_FULL_DROP  = 1
+} QueueFullPolicy;
+
 typedef struct {
     AVFormatContext *avf;
     AVBSFContext **bsfs; ///< bitstream filters per stream
@@ -48,6 +57,15 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    /* The following fields are only used with write_threads */
+    int queue_size;
+    QueueFullPolicy on_full;
+    AVFifo *queue;           ///< packets waiting to be written, protected by TeeContext.lock
+    int busy;                ///< a worker thread is writing to this slave
+    int error;               ///< error returned to the worker, handled by the muxing thread
+    uint8_t *wait_keyframe;  ///< per output stream, packets were dropped since the last keyframe
+    int64_t nb_dropped;
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -57,6 +75,19 @@ typedef struct TeeContext {
     TeeSlave *slaves;
     int use_fifo;
     AVDictionary *fifo_options;
+    int nb_threads;
+    int queue_size;
+    int on_full;
+
+#if HAVE_THREADS
+    pthread_t *workers;
+    unsigned nb_workers;
+    unsigned next_slave;
+    int workers_exit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   ///< signalled when packets are queued
+    pthread_cond_t done_cond;   ///< signalled when a worker is done with a packet
+#endif
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -69,6 +100,14 @@ static const AVOption options[] = {
          OFFSET(use_fifo), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
         {"fifo_options", "fifo pseudo-muxer options", OFFSET(fifo_options),
          AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+        {"write_threads", "Number of threads writing to the slaves, 0 to write from the muxing thread",
+         OFFSET(nb_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 256, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_size", "Maximum number of packets queued per slave with write_threads",
+         OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64 = 64}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+        {"on_full", "Action when the queue of a slave is full", OFFSET(on_full),
+         AV_OPT_TYPE_INT, {.i64 = ON_QUEUE_FULL_BLOCK}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, "on_full"},
+        {"block", "wait for the slave", 0, AV_OPT_TYPE_CONST, {.i64 = ON_QUEUE_FULL_BLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "on_full"},
+        {"drop",  "drop packets up to the next keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = ON_QUEUE_FULL_DROP}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "on_full"},
         {NULL}
 };
 
@@ -115,6 +154,39 @@ static int parse_slave_fifo_options(const char *fifo_options, TeeSlave *tee_slav
     return av_dict_parse_string(&tee_slave->fifo_options, fifo_options, "=", ":", 0);
 }
 
+static int parse_slave_queue_size(const char *queue_size, TeeSlave *tee_slave)
+{
+    char *end;
+    long size = strtol(queue_size, &end, 10);
+
+    if (*end || size < 1 || size > INT_MAX)
+        return AVERROR(EINVAL);
+    tee_slave->queue_size = size;
+    return 0;
+}
+
+static int parse_slave_queue_full_policy(const char *on_full, TeeSlave *tee_slave)
+{
+    if (!av_strcasecmp("block", on_full)) {
+        tee_slave->on_full = ON_QUEUE_FULL_BLOCK;
+    } else if (!av_strcasecmp("drop", on_full)) {
+        tee_slave->on_full = ON_QUEUE_FULL_DROP;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static void flush_slave_queue(TeeSlave *tee_slave)
+{
+    AVPacket *pkt;
+
+    if (!tee_slave->queue)
+        return;
+    while (av_fifo_read(tee_slave->queue, &pkt, 1) >= 0)
+        av_packet_free(&pkt);
+}
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
@@ -122,6 +194,9 @@ static int close_slave(TeeSlave *tee_slave)
     int ret = 0;
 
     av_dict_free(&tee_slave->fifo_options);
+    flush_slave_queue(tee_slave);
+    av_fifo_freep2(&tee_slave->queue);
+    av_freep(&tee_slave->wait_keyframe);
     avf = tee_slave->avf;
     if (!avf)
         return 0;
@@ -155,12 +230,14 @@ static void close_slaves(AVFormatContext *avf)
 
 static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 {
+    TeeContext *tee = avf->priv_data;
     int i, ret;
     AVDictionary *options = NULL, *bsf_options = NULL;
     AVDictionaryEntry *entry;
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
     char *use_fifo = NULL, *fifo_options_str = NULL;
+    char *queue_size = NULL, *on_full = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -195,6 +272,14 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
                           av_err2str(ret)););
     PROCESS_OPTION("fifo_options", fifo_options_str,
                    parse_slave_fifo_options(fifo_options_str, tee_slave), ;);
+    PROCESS_OPTION("queue_size", queue_size,
+                   parse_slave_queue_size(queue_size, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid queue_size option value '%s'\n",
+                          queue_size););
+    PROCESS_OPTION("on_full", on_full,
+                   parse_slave_queue_full_policy(on_full, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid on_full option value, "
+                          "valid options are 'block' and 'drop'\n"););
     entry = NULL;
     while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
         /* trim out strlen("bsfs") characters from key */
@@ -315,6 +400,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
         goto end;
     }
 
+    if (tee->nb_threads) {
+        tee_slave->queue = av_fifo_alloc2(tee_slave->queue_size, sizeof(AVPacket*), 0);
+        tee_slave->wait_keyframe = av_calloc(avf2->nb_streams, sizeof(*tee_slave->wait_keyframe));
+        if (!tee_slave->queue || !tee_slave->wait_keyframe) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
     entry = NULL;
     while (entry = av_dict_get(bsf_options, "", NULL, AV_DICT_IGNORE_SUFFIX)) {
         const char *spec = entry->key;
@@ -450,6 +544,241 @@ static int tee_process_slave_failure(AVFormatContext *avf, unsigned slave_idx, i
     }
 }
 
+static int tee_write_slave_packet(AVFormatContext *avf, TeeSlave *tee_slave,
+                                  AVPacket *pkt)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    int s2 = pkt->stream_index;
+    AVBSFContext *bsfs = tee_slave->bsfs[s2];
+    int ret;
+
+    ret = av_bsf_send_packet(bsfs, pkt);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
+               av_err2str(ret));
+        return ret;
+    }
+
+    while(1) {
+        ret = av_bsf_receive_packet(bsfs, pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            ret = 0;
+            break;
+        } else if (ret < 0) {
+            break;
+        }
+
+        av_packet_rescale_ts(pkt, bsfs->time_base_out,
+                             avf2->streams[s2]->time_base);
+        ret = av_interleaved_write_frame(avf2, pkt);
+        if (ret < 0)
+            break;
+    };
+
+    return ret;
+}
+
+#if HAVE_THREADS
+/* Must be called with tee->lock held. */
+static int tee_next_queued_slave(TeeContext *tee)
+{
+    for (unsigned n = 0; n < tee->nb_slaves; n++) {
+        unsigned i = (tee->next_slave + n) % tee->nb_slaves;
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        if (!tee_slave->busy && !tee_slave->error && tee_slave->queue &&
+            av_fifo_can_read(tee_slave->queue)) {
+            tee->next_slave = i + 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *tee_worker(void *arg)
+{
+    AVFormatContext *avf = arg;
+    TeeContext *tee = avf->priv_data;
+
+    pthread_mutex_lock(&tee->lock);
+    while (!tee->workers_exit) {
+        TeeSlave *tee_slave;
+        AVPacket *pkt;
+        int i = tee_next_queued_slave(tee), ret;
+
+        if (i < 0) {
+            pthread_cond_wait(&tee->work_cond, &tee->lock);
+            continue;
+        }
+
+        /* Only one worker at a time writes to a given slave, so packets
+         * reach each slave in the order they were queued. */
+        tee_slave = &tee->slaves[i];
+        av_fifo_read(tee_slave->queue, &pkt, 1);
+        tee_slave->busy = 1;
+        pthread_mutex_unlock(&tee->lock);
+
+        ret = tee_write_slave_packet(avf, tee_slave, pkt);
+        av_packet_free(&pkt);
+
+        pthread_mutex_lock(&tee->lock);
+        tee_slave->busy = 0;
+        if (ret < 0)
+            tee_slave->error = ret;
+        pthread_cond_broadcast(&tee->done_cond);
+    }
+    pthread_mutex_unlock(&tee->lock);
+
+    return NULL;
+}
+
+static void tee_stop_workers(TeeContext *tee)
+{
+    if (!tee->workers)
+        return;
+
+    pthread_mutex_lock(&tee->lock);
+    tee->workers_exit = 1;
+    pthread_cond_broadcast(&tee->work_cond);
+    pthread_mutex_unlock(&tee->lock);
+
+    for (unsigned i = 0; i < tee->nb_workers; i++)
+        pthread_join(tee->workers[i], NULL);
+    av_freep(&tee->workers);
+    tee->nb_workers = 0;
+
+    pthread_cond_destroy(&tee->done_cond);
+    pthread_cond_destroy(&tee->work_cond);
+    pthread_mutex_destroy(&tee->lock);
+}
+
+static int tee_start_workers(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned nb_workers = FFMIN(tee->nb_threads, tee->nb_slaves);
+    int ret;
+
+    if (!FF_ALLOCZ_TYPED_ARRAY(tee->workers, nb_workers))
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_init(&tee->lock, NULL);
+    pthread_cond_init(&tee->work_cond, NULL);
+    pthread_cond_init(&tee->done_cond, NULL);
+
+    for (unsigned i = 0; i < nb_workers; i++) {
+        ret = pthread_create(&tee->workers[i], NULL, tee_worker, avf);
+        if (ret) {
+            av_log(avf, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            tee_stop_workers(tee);
+            return AVERROR(ret);
+        }
+        tee->nb_workers++;
+    }
+
+    av_log(avf, AV_LOG_VERBOSE, "Writing to %u slaves from %u threads\n",
+           tee->nb_slaves, nb_workers);
+    return 0;
+}
+
+/* Wait until the workers have written all the queued packets. */
+static void tee_drain_slaves(TeeContext *tee)
+{
+    pthread_mutex_lock(&tee->lock);
+    for (unsigned i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        while (!tee_slave->error &&
+               (tee_slave->busy || (tee_slave->queue && av_fifo_can_read(tee_slave->queue))))
+            pthread_cond_wait(&tee->done_cond, &tee->lock);
+    }
+    pthread_mutex_unlock(&tee->lock);
+}
+
+static int tee_get_slave_error(TeeContext *tee, TeeSlave *tee_slave)
+{
+    int err;
+
+    pthread_mutex_lock(&tee->lock);
+    err = tee_slave->avf ? tee_slave->error : 0;
+    pthread_mutex_unlock(&tee->lock);
+
+    return err;
+}
+
+static int tee_check_slave_errors(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    int ret_all = 0, ret;
+
+    for (unsigned i = 0; i < tee->nb_slaves; i++) {
+        if ((ret = tee_get_slave_error(tee, &tee->slaves[i])) < 0) {
+            ret = tee_process_slave_failure(avf, i, ret);
+            if (!ret_all && ret < 0)
+                ret_all = ret;
+        }
+    }
+    return ret_all;
+}
+
+static int tee_queue_packet(AVFormatContext *avf, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    int ret_all = 0, ret;
+
+    for (unsigned i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *tee_slave = &tee->slaves[i];
+        AVPacket *pkt2 = NULL;
+        int s2;
+
+        if (!tee_slave->avf)
+            continue;
+
+        s2 = tee_slave->stream_map[pkt->stream_index];
+        if (s2 >= 0) {
+            /* The packet data is shared by all the slaves. */
+            if (!(pkt2 = av_packet_clone(pkt))) {
+                if (!ret_all)
+                    ret_all = AVERROR(ENOMEM);
+                continue;
+            }
+            pkt2->stream_index = s2;
+        }
+
+        pthread_mutex_lock(&tee->lock);
+        if (pkt2 && !tee_slave->error) {
+            if (tee_slave->on_full == ON_QUEUE_FULL_BLOCK) {
+                while (!tee_slave->error && !av_fifo_can_write(tee_slave->queue))
+                    pthread_cond_wait(&tee->done_cond, &tee->lock);
+            }
+            /* After dropping packets, resume the stream at a keyframe so the
+             * slave output stays decodable. */
+            if (!tee_slave->error &&
+                (!tee_slave->wait_keyframe[s2] || (pkt2->flags & AV_PKT_FLAG_KEY)) &&
+                av_fifo_write(tee_slave->queue, &pkt2, 1) >= 0) {
+                tee_slave->wait_keyframe[s2] = 0;
+                pkt2 = NULL;
+                pthread_cond_signal(&tee->work_cond);
+            } else if (!tee_slave->error) {
+                tee_slave->wait_keyframe[s2] = 1;
+                tee_slave->nb_dropped++;
+            }
+        }
+        ret = tee_slave->error;
+        pthread_mutex_unlock(&tee->lock);
+
+        av_packet_free(&pkt2);
+        if (ret < 0) {
+            ret = tee_process_slave_failure(avf, i, ret);
+            if (!ret_all && ret < 0)
+                ret_all = ret;
+        }
+    }
+    return ret_all;
+}
+#endif
+
 static int tee_write_header(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
@@ -479,9 +808,19 @@ static int tee_write_header(AVFormatContext *avf)
     }
     tee->nb_slaves = tee->nb_alive = nb_slaves;
 
+#if !HAVE_THREADS
+    if (tee->nb_threads) {
+        av_log(avf, AV_LOG_WARNING, "Built without thread support, "
+               "writing to the slaves from the muxing thread\n");
+        tee->nb_threads = 0;
+    }
+#endif
+
     for (i = 0; i < nb_slaves; i++) {
 
         tee->slaves[i].use_fifo = tee->use_fifo;
+        tee->slaves[i].queue_size = tee->queue_size;
+        tee->slaves[i].on_full = tee->on_full;
         ret = av_dict_copy(&tee->slaves[i].fifo_options, tee->fifo_options, 0);
         if (ret < 0)
             goto fail;
@@ -506,6 +845,13 @@ static int tee_write_header(AVFormatContext *avf)
                    "to any slave.\n", i);
     }
     av_free(slaves);
+
+#if HAVE_THREADS
+    if (tee->nb_threads && (ret = tee_start_workers(avf)) < 0) {
+        close_slaves(avf);
+        return ret;
+    }
+#endif
     return 0;
 
 fail:
@@ -522,7 +868,19 @@ static int tee_write_trailer(AVFormatContext *avf)
     int ret_all = 0, ret;
     unsigned i;
 
+#if HAVE_THREADS
+    if (tee->workers) {
+        tee_drain_slaves(tee);
+        ret_all = tee_check_slave_errors(avf);
+        tee_stop_workers(tee);
+    }
+#endif
+
     for (i = 0; i < tee->nb_slaves; i++) {
+        if (tee->slaves[i].nb_dropped)
+            av_log(avf, AV_LOG_WARNING, "Slave muxer #%u: %"PRId64" packets "
+                   "dropped because its queue was full\n",
+                   i, tee->slaves[i].nb_dropped);
         if ((ret = close_slave(&tee->slaves[i])) < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
@@ -537,12 +895,22 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
     AVFormatContext *avf2;
-    AVBSFContext *bsfs;
     AVPacket *const pkt2 = ffformatcontext(avf)->pkt;
     int ret_all = 0, ret;
     unsigned i, s;
     int s2;
 
+#if HAVE_THREADS
+    if (tee->workers) {
+        if (pkt)
+            return tee_queue_packet(avf, pkt);
+        /* Flush the slaves from this thread once their queues are empty. */
+        tee_drain_slaves(tee);
+        if ((ret_all = tee_check_slave_errors(avf)) < 0)
+            return ret_all;
+    }
+#endif
+
     for (i = 0; i < tee->nb_slaves; i++) {
         if (!(avf2 = tee->slaves[i].avf))
             continue;
@@ -568,35 +936,9 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
                 ret_all = ret;
             continue;
         }
-        bsfs = tee->slaves[i].bsfs[s2];
         pkt2->stream_index = s2;
 
-        ret = av_bsf_send_packet(bsfs, pkt2);
-        if (ret < 0) {
-            av_packet_unref(pkt2);
-            av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
-                   av_err2str(ret));
-            ret = tee_process_slave_failure(avf, i, ret);
-            if (!ret_all && ret < 0)
-                ret_all = ret;
-        }
-
-        while(1) {
-            ret = av_bsf_receive_packet(bsfs, pkt2);
-            if (ret == AVERROR(EAGAIN)) {
-                ret = 0;
-                break;
-            } else if (ret < 0) {
-                break;
-            }
-
-            av_packet_rescale_ts(pkt2, bsfs->time_base_out,
-                                 avf2->streams[s2]->time_base);
-            ret = av_interleaved_write_frame(avf2, pkt2);
-            if (ret < 0)
-                break;
-        };
-
+        ret = tee_write_slave_packet(avf, &tee->slaves[i], pkt2);
         if (ret < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
@@ -606,6 +948,13 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
     return ret_all;
 }
 
+static void tee_deinit(AVFormatContext *avf)
+{
+#if HAVE_THREADS
+    tee_stop_workers(avf->priv_data);
+#endif
+}
+
 const FFOutputFormat ff_tee_muxer = {
     .p.name            = "tee",
     .p.long_name       = NULL_IF_CONFIG_SMALL("Multiple muxer tee"),
@@ -613,6 +962,7 @@ const FFOutputFormat ff_tee_muxer = {
     .write_header      = tee_write_header,
     .write_trailer     = tee_write_trailer,
     .write_packet      = tee_write_packet,
+    .deinit            = tee_deinit,
     .p.priv_class      = &tee_muxer_class,
     .p.flags           = AVFMT_NOFILE | AVFMT_ALLOW_FLUSH | AVFMT_TS_NEGATIVE,
 };
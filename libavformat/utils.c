@@ -115,6 +115,62 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return append_packet_chunked(s, pkt, size);
 }
 
+int ff_get_pooled_packet(AVIOContext *s, AVPacket *pkt, int size,
+                         AVBufferPool *pool)
+{
+    int ret;
+
+    av_packet_unref(pkt);
+    if (size < 0)
+        return AVERROR(EINVAL);
+    pkt->pos = avio_tell(s);
+    pkt->buf = av_buffer_pool_get(pool);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+
+    ret = avio_read(s, pkt->data, size);
+    pkt->size = FFMAX(ret, 0);
+    memset(pkt->data + pkt->size, 0, size - pkt->size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (pkt->size < size)
+        pkt->flags |= AV_PKT_FLAG_CORRUPT;
+
+    if (!pkt->size) {
+        av_packet_unref(pkt);
+        return size ? ret : 0;
+    }
+    return pkt->size;
+}
+
+int ff_get_mapped_packet(AVIOContext *s, AVPacket *pkt, int size,
+                         const AVCodecParameters *par, AVBufferPool *pool)
+{
+    int64_t pos = avio_tell(s);
+    AVBufferRef *buf;
+    int ret;
+
+    if (par->codec_id != AV_CODEC_ID_RAWVIDEO &&
+        (par->codec_id < AV_CODEC_ID_PCM_S16LE ||
+         par->codec_id >= AV_CODEC_ID_ADPCM_IMA_QT))
+        return pool ? ff_get_pooled_packet(s, pkt, size, pool) :
+                      av_get_packet(s, pkt, size);
+
+    ret = ffio_read_mapped(s, &buf, size, AV_INPUT_BUFFER_PADDING_SIZE);
+    if (ret == AVERROR(ENOSYS))
+        return pool ? ff_get_pooled_packet(s, pkt, size, pool) :
+                      av_get_packet(s, pkt, size);
+
+    av_packet_unref(pkt);
+    if (ret < 0)
+        return ret;
+    pkt->buf  = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    pkt->pos  = pos;
+
+    return size;
+}
+
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
@@ -0,0 +1,185 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/vf_overlay.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define WIDTH 256
+#define ALPHA_SIZE (WIDTH * 2 * 2 * 2)
+#define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
+
+typedef struct OverlayTest {
+    const char *name;
+    int format;
+    int pix_format;
+    int alpha_format;
+    int depth;
+    int hsub, vsub;
+} OverlayTest;
+
+static const OverlayTest tests[] = {
+    { "yuv444",       OVERLAY_FORMAT_YUV444,    AV_PIX_FMT_YUV444P,   0,  8, 0, 0 },
+    { "yuv422",       OVERLAY_FORMAT_YUV422,    AV_PIX_FMT_YUV422P,   0,  8, 1, 0 },
+    { "yuv420",       OVERLAY_FORMAT_YUV420,    AV_PIX_FMT_YUV420P,   0,  8, 1, 1 },
+    { "yuv444_pm",    OVERLAY_FORMAT_YUV444,    AV_PIX_FMT_YUV444P,   1,  8, 0, 0 },
+    { "yuv422_pm",    OVERLAY_FORMAT_YUV422,    AV_PIX_FMT_YUV422P,   1,  8, 1, 0 },
+    { "yuv420_pm",    OVERLAY_FORMAT_YUV420,    AV_PIX_FMT_YUV420P,   1,  8, 1, 1 },
+    { "gbrp_pm",      OVERLAY_FORMAT_GBRP,      AV_PIX_FMT_GBRP,      1,  8, 0, 0 },
+    { "yuv422p10",    OVERLAY_FORMAT_YUV422P10, AV_PIX_FMT_YUV422P10, 0, 10, 1, 0 },
+    { "yuv420p10",    OVERLAY_FORMAT_YUV420P10, AV_PIX_FMT_YUV420P10, 0, 10, 1, 1 },
+    { "yuv422p10_pm", OVERLAY_FORMAT_YUV422P10, AV_PIX_FMT_YUV422P10, 1, 10, 1, 0 },
+    { "yuv420p10_pm", OVERLAY_FORMAT_YUV420P10, AV_PIX_FMT_YUV420P10, 1, 10, 1, 1 },
+};
+
+/* same as the C blending in vf_overlay.c, for a row without main alpha */
+static void blend_row_ref(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                          int w, ptrdiff_t alinesize, const OverlayTest *t,
+                          int hsub, int vsub, int chroma)
+{
+    const int max = (1 << t->depth) - 1;
+    const int mid = 1 << (t->depth - 1);
+    const int bytes = t->depth > 8 ? 2 : 1;
+    int k;
+
+    alinesize /= bytes;
+    for (k = 0; k < w; k++) {
+        int d, s, a, a0, a1, a2, a3;
+
+        if (bytes == 2) {
+            const uint16_t *ap = (const uint16_t *)alpha + (k << hsub);
+            d  = AV_RN16(dst + 2 * k);
+            s  = AV_RN16(src + 2 * k);
+            a0 = ap[0];
+            a1 = ap[1];
+            a2 = ap[alinesize];
+            a3 = ap[alinesize + 1];
+        } else {
+            const uint8_t *ap = alpha + (k << hsub);
+            d  = dst[k];
+            s  = src[k];
+            a0 = ap[0];
+            a1 = ap[1];
+            a2 = ap[alinesize];
+            a3 = ap[alinesize + 1];
+        }
+
+        if (hsub && vsub)
+            a = (a0 + a2 + a1 + a3) >> 2;
+        else if (hsub)
+            a = (a0 + ((a0 + a1) >> 1)) >> 1;
+        else
+            a = a0;
+
+        if (!t->alpha_format) {
+            if (bytes == 2)
+                d = (d * (max - a) + s * a) / max;
+            else
+                d = FAST_DIV255(d * (255 - a) + s * a);
+        } else if (bytes == 2) {
+            d = (d * (max - a) + s * a) / max + s;
+            if (chroma)
+                d = av_clip(d - mid, -mid, mid) + mid;
+            else
+                d = av_clip_uintp2(d - (16 << (t->depth - 8)), t->depth);
+        } else if (chroma && t->format != OVERLAY_FORMAT_GBRP) {
+            d = (uint8_t)(av_clip(FAST_DIV255((d - mid) * (max - a)) + s - mid, -mid, mid) + mid);
+        } else {
+            d = av_clip_uint8(FAST_DIV255(d * (255 - a)) + s - 16);
+        }
+
+        if (bytes == 2)
+            AV_WN16(dst + 2 * k, d);
+        else
+            dst[k] = d;
+    }
+}
+
+static void check_overlay_row(const OverlayTest *t)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,     [WIDTH * 2]);
+    LOCAL_ALIGNED_32(uint8_t, alpha,   [ALPHA_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [WIDTH * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [WIDTH * 2]);
+    const int bytes = t->depth > 8 ? 2 : 1;
+    const ptrdiff_t alinesize = WIDTH * 2 * bytes;
+    OverlayContext s = { 0 };
+    int plane, i;
+    declare_func(int, uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                 int w, ptrdiff_t alinesize);
+
+#if ARCH_X86
+    ff_overlay_init_x86(&s, t->format, t->pix_format, t->alpha_format, 0);
+#endif
+
+    for (plane = 0; plane < 2; plane++) {
+        const int hsub = plane ? t->hsub : 0;
+        const int vsub = plane ? t->vsub : 0;
+        const int w = (WIDTH >> hsub) - (rnd() & 15);
+        int c;
+
+        if (!check_func(s.blend_row[plane], "overlay_row_%s_%s", t->name,
+                        plane ? "chroma" : "luma"))
+            continue;
+
+        for (i = 0; i < ALPHA_SIZE; i++)
+            alpha[i] = rnd();
+        for (i = 0; i < WIDTH * 2; i++) {
+            src[i] = rnd();
+            dst_ref[i] = dst_new[i] = rnd();
+        }
+        if (bytes == 2) {
+            for (i = 0; i < ALPHA_SIZE; i += 2)
+                AV_WN16(alpha + i, AV_RN16(alpha + i) & 0x3FF);
+            for (i = 0; i < WIDTH * 2; i += 2) {
+                AV_WN16(src + i, AV_RN16(src + i) & 0x3FF);
+                AV_WN16(dst_ref + i, AV_RN16(dst_ref + i) & 0x3FF);
+                AV_WN16(dst_new + i, AV_RN16(dst_ref + i));
+            }
+        }
+        /* fully transparent and fully opaque pixels */
+        if (bytes == 1) {
+            memset(alpha, 0, 16);
+            memset(alpha + 16, 0xFF, 16);
+        }
+
+        /* the row functions return the number of pixels they blended,
+         * the caller finishes the row in C */
+        c = call_new(dst_new, NULL, src, alpha, w, alinesize);
+        if (c < 0 || c > w || c < w - 64)
+            fail();
+        else
+            blend_row_ref(dst_ref, src, alpha, c, alinesize, t, hsub, vsub, plane);
+        if (memcmp(dst_ref, dst_new, WIDTH * bytes))
+            fail();
+
+        bench_new(dst_new, NULL, src, alpha, w, alinesize);
+    }
+}
+
+void checkasm_check_vf_overlay(void)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++)
+        check_overlay_row(&tests[i]);
+    report("overlay_row");
+}
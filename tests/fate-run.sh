@@ -565,6 +565,36 @@ concat(){
     fi
 }
 
+tee_write_threads(){
+    write_threads=$1
+
+    for t in 0 $write_threads; do
+        base="${outdir}/${test}-$t"
+        cleanfiles="$cleanfiles $base.nut $base.framecrc $base.wav"
+        ffmpeg -f lavfi -i "testsrc2=s=160x120:r=25:d=2" -f lavfi -i "sine=1000:d=2" \
+            -map 0 -map 1 -pix_fmt yuv420p -c:v mpeg4 -qscale:v 10 -c:a pcm_s16le \
+            -fflags +bitexact -flags +bitexact -f tee -write_threads $t \
+            "[f=nut]$(target_path $base.nut)|[f=framecrc]$(target_path $base.framecrc)|[select=a:f=wav]$(target_path $base.wav)" ||
+            return
+    done
+
+    for ext in nut framecrc wav; do
+        cmp "${outdir}/${test}-0.$ext" "${outdir}/${test}-$write_threads.$ext" || return
+    done
+    cat "${outdir}/${test}-$write_threads.framecrc"
+}
+
+shm_protocol(){
+    name="/fate-${test}-$$"
+
+    ffmpeg -f lavfi -i "testsrc2=s=160x120:r=25:d=2" -c:v rawvideo -fflags +bitexact -flags +bitexact \
+        -buffer_size 65536 -f nut "shm:$name" &
+    writer=$!
+    ffmpeg -i "shm:$name" "$@" -c copy -fflags +bitexact -f framecrc -
+    wait $writer
+    test $? = 0 || echo "writer failed"
+}
+
 venc_data(){
     file=$1
     stream=$2
@@ -19,9 +19,19 @@ $(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-simpl
 $(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-simple2-lavf-$(D): CMD = concat $(SRC_PATH)/tests/simple2.ffconcat ../lavf/lavf.$(D)))
 FATE_CONCAT_DEMUXER += $(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF:%=fate-concat-demuxer-simple2-lavf-%)
 
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-prefetch-lavf-$(D): fate-lavf-$(D)))
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-prefetch-lavf-$(D): CMD = concat $(SRC_PATH)/tests/simple2.ffconcat ../lavf/lavf.$(D) "" "-prefetch 1"))
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-prefetch-lavf-$(D): REF = $(SRC_PATH)/tests/ref/fate/concat-demuxer-simple2-lavf-$(D)))
+FATE_CONCAT_DEMUXER-$(HAVE_THREADS) += $(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF:%=fate-concat-demuxer-prefetch-lavf-%)
+
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-reuse-probe-lavf-$(D): fate-lavf-$(D)))
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-reuse-probe-lavf-$(D): CMD = concat $(SRC_PATH)/tests/simple2.ffconcat ../lavf/lavf.$(D) "" "-reuse_probe 1"))
+$(foreach D,$(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF),$(eval fate-concat-demuxer-reuse-probe-lavf-$(D): REF = $(SRC_PATH)/tests/ref/fate/concat-demuxer-simple2-lavf-$(D)))
+FATE_CONCAT_DEMUXER += $(FATE_CONCAT_DEMUXER_SIMPLE2_LAVF:%=fate-concat-demuxer-reuse-probe-lavf-%)
+
 $(foreach D,$(FATE_CONCAT_DEMUXER_EXTENDED_LAVF),$(eval fate-concat-demuxer-extended-lavf-$(D): fate-lavf-$(D)))
 $(foreach D,$(FATE_CONCAT_DEMUXER_EXTENDED_LAVF),$(eval fate-concat-demuxer-extended-lavf-$(D): CMD = concat $(SRC_PATH)/tests/extended.ffconcat ../lavf/lavf.$(D) md5))
 FATE_CONCAT_DEMUXER += $(FATE_CONCAT_DEMUXER_EXTENDED_LAVF:%=fate-concat-demuxer-extended-lavf-%)
 
-FATE_CONCAT_DEMUXER := $(if $(CONFIG_CONCAT_DEMUXER), $(FATE_CONCAT_DEMUXER))
+FATE_CONCAT_DEMUXER := $(if $(CONFIG_CONCAT_DEMUXER), $(FATE_CONCAT_DEMUXER) $(FATE_CONCAT_DEMUXER-yes))
 FATE_FFPROBE += $(FATE_CONCAT_DEMUXER)
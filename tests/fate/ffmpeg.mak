@@ -26,6 +26,16 @@ fate-mapchan: $(FATE_MAPCHAN)
 FATE_FFMPEG-$(call FILTERFRAMECRC, COLOR) += fate-ffmpeg-filter_complex
 fate-ffmpeg-filter_complex: CMD = framecrc -filter_complex color=d=1:r=5 -fflags +bitexact
 
+FATE_FFMPEG-$(call FILTERFRAMECRC, COLOR SPLIT HFLIP VFLIP NEGATE) += fate-ffmpeg-filter_complex-frame-threads
+fate-ffmpeg-filter_complex-frame-threads: CMD = framecrc -filter_complex_threads 4 -filter_complex_thread_type slice+frame \
+  -filter_complex "color=d=1:r=5,split=3[a][b][c];[a]hflip[o1];[b]vflip[o2];[c]negate[o3]" \
+  -map "[o1]" -map "[o2]" -map "[o3]" -fflags +bitexact
+
+FATE_FFMPEG-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT PAD SETSAR) += fate-ffmpeg-fuse_filters
+fate-ffmpeg-fuse_filters: CMD = framecrc -fuse_filters \
+  -filter_complex "testsrc2=s=352x288:d=0.2,scale=320:180:flags=bicubic+accurate_rnd+bitexact,format=yuv420p,pad=352:288:-1:-1:red,setsar=1" \
+  -fflags +bitexact
+
 # Ticket 6603
 FATE_FFMPEG-$(call FILTERFRAMECRC, AEVALSRC ASETNSAMPLES ARESAMPLE, AC3_FIXED_ENCODER) += fate-ffmpeg-filter_complex_audio
 fate-ffmpeg-filter_complex_audio: CMD = framecrc -auto_conversion_filters -filter_complex "aevalsrc=0:d=0.1,asetnsamples=1537" -c ac3_fixed
@@ -41,6 +51,10 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -auto_conversion_filters -idct simpl
 FATE_FFMPEG-$(call FILTERFRAMECRC, COLOR) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+FATE_FFMPEG-$(call FILTERFRAMECRC, COLOR) += fate-ffmpeg-lavfi-hash-threads
+fate-ffmpeg-lavfi-hash-threads: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact -hash_threads 4
+fate-ffmpeg-lavfi-hash-threads: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-lavfi
+
 FATE_SAMPLES_FFMPEG-$(call ENCDEC2, MPEG4, RAWVIDEO, AVI, RAWVIDEO_DEMUXER FRAMECRC_MUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
@@ -224,3 +238,108 @@ FATE_TIME_BASE-$(call PARSERDEMDEC, MPEGVIDEO, MPEGPS, MPEG2VIDEO, MPEGVIDEO_DEM
 fate-time_base: CMD = md5 -i $(TARGET_SAMPLES)/mpeg2/dvd_single_frame.vob -an -sn -c:v copy -r 25 -time_base 1001:30000 -fflags +bitexact -f mxf
 
 FATE_SAMPLES_FFMPEG-yes += $(FATE_TIME_BASE-yes)
+
+# Round trip through the read-ahead and write-behind thread of the file
+# protocol; faststart makes the muxer seek back and move the written data.
+tests/data/file_%.mov: TAG = GEN
+tests/data/file_%.mov: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "testsrc2=s=160x120:r=25:d=4" -f lavfi -i "sine=1000:d=4" \
+        -c:v rawvideo -c:a pcm_s16le -movflags +faststart -fflags +bitexact -flags +bitexact \
+        $(if $(filter async,$*),-async_blocks 3 -async_block_size 4096) \
+        -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_FILE_ASYNC-$(call ALLYES, TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV RAWVIDEO_ENCODER PCM_S16LE_ENCODER \
+                               MOV_MUXER MOV_DEMUXER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-async fate-file-async-sync
+fate-file-async: tests/data/file_async.mov
+fate-file-async: CMD = framemd5 -async_blocks 3 -async_block_size 4096 -i $(TARGET_PATH)/tests/data/file_async.mov -c copy
+fate-file-async-sync: tests/data/file_sync.mov
+fate-file-async-sync: CMD = framemd5 -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy
+fate-file-async-sync: REF = $(SRC_PATH)/tests/ref/fate/file-async
+
+# Hashing on threads must give the same output as in the muxing thread.
+FATE_FILE_ASYNC-$(call ALLYES, TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV RAWVIDEO_ENCODER PCM_S16LE_ENCODER \
+                               MOV_MUXER MOV_DEMUXER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-async-hash-threads
+fate-file-async-hash-threads: tests/data/file_sync.mov
+fate-file-async-hash-threads: CMD = framemd5 -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy -hash_threads 3
+fate-file-async-hash-threads: REF = $(SRC_PATH)/tests/ref/fate/file-async
+
+FATE_FILE_ASYNC-$(call ALLYES, TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV RAWVIDEO_ENCODER PCM_S16LE_ENCODER \
+                               MOV_MUXER MOV_DEMUXER STREAMHASH_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-streamhash fate-file-streamhash-threads
+fate-file-streamhash fate-file-streamhash-threads: tests/data/file_sync.mov
+fate-file-streamhash: CMD = fmtstdout streamhash -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy
+fate-file-streamhash-threads: CMD = fmtstdout streamhash -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy -hash_threads 2
+fate-file-streamhash-threads: REF = $(SRC_PATH)/tests/ref/fate/file-streamhash
+
+FATE_FILE_ASYNC-$(call ALLYES, TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV RAWVIDEO_ENCODER PCM_S16LE_ENCODER \
+                               MOV_MUXER MOV_DEMUXER MD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-md5 fate-file-md5-threads
+fate-file-md5 fate-file-md5-threads: tests/data/file_sync.mov
+fate-file-md5: CMD = fmtstdout md5 -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy
+fate-file-md5-threads: CMD = fmtstdout md5 -i $(TARGET_PATH)/tests/data/file_sync.mov -c copy -hash_threads 2
+fate-file-md5-threads: REF = $(SRC_PATH)/tests/ref/fate/file-md5
+
+FATE_FFMPEG += $(FATE_FILE_ASYNC-yes)
+
+# Packets referencing a memory mapped input must decode like copied ones;
+# b64a is converted in place by the decoder.
+tests/data/file_mmap.mov: TAG = GEN
+tests/data/file_mmap.mov: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "testsrc2=s=64x48:r=25:d=1" -f lavfi -i "sine=1000:d=1" \
+        -sws_flags +accurate_rnd+bitexact -pix_fmt rgba64be -c:v rawvideo -tag:v b64a -c:a pcm_s16le \
+        -fflags +bitexact -flags +bitexact -y $(TARGET_PATH)/$@ 2>/dev/null
+
+tests/data/file_mmap.yuv: TAG = GEN
+tests/data/file_mmap.yuv: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "testsrc2=s=64x48:r=25:d=1" -pix_fmt yuv420p -f rawvideo -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_FILE_MMAP-$(call ALLYES, TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV RAWVIDEO_ENCODER RAWVIDEO_DECODER \
+                              PCM_S16LE_ENCODER PCM_S16LE_DECODER MOV_MUXER MOV_DEMUXER \
+                              FRAMECRC_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-mmap-mov fate-file-mmap-mov-nommap
+fate-file-mmap-mov fate-file-mmap-mov-nommap: tests/data/file_mmap.mov
+fate-file-mmap-mov: CMD = framecrc -mmap 1 -i $(TARGET_PATH)/tests/data/file_mmap.mov
+fate-file-mmap-mov-nommap: CMD = framecrc -i $(TARGET_PATH)/tests/data/file_mmap.mov
+fate-file-mmap-mov-nommap: REF = $(SRC_PATH)/tests/ref/fate/file-mmap-mov
+
+FATE_FILE_MMAP-$(call ALLYES, TESTSRC2_FILTER LAVFI_INDEV RAWVIDEO_ENCODER RAWVIDEO_DECODER \
+                              RAWVIDEO_MUXER RAWVIDEO_DEMUXER FRAMECRC_MUXER \
+                              FILE_PROTOCOL PIPE_PROTOCOL) += fate-file-mmap-rawvideo fate-file-mmap-rawvideo-nommap
+fate-file-mmap-rawvideo fate-file-mmap-rawvideo-nommap: tests/data/file_mmap.yuv
+fate-file-mmap-rawvideo: CMD = framecrc -mmap 1 -f rawvideo -pix_fmt yuv420p -s 64x48 -i $(TARGET_PATH)/tests/data/file_mmap.yuv
+fate-file-mmap-rawvideo-nommap: CMD = framecrc -f rawvideo -pix_fmt yuv420p -s 64x48 -i $(TARGET_PATH)/tests/data/file_mmap.yuv
+fate-file-mmap-rawvideo-nommap: REF = $(SRC_PATH)/tests/ref/fate/file-mmap-rawvideo
+
+FATE_FFMPEG += $(FATE_FILE_MMAP-yes)
+
+# Frames larger than the I/O buffer are read into pooled buffers and written
+# past the buffer; the copy must be identical to the input.
+tests/data/file_pool.yuv: TAG = GEN
+tests/data/file_pool.yuv: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "testsrc2=s=320x240:r=10:d=1" -pix_fmt yuv420p -f rawvideo -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_FILE_POOL-$(call ALLYES, TESTSRC2_FILTER LAVFI_INDEV RAWVIDEO_ENCODER \
+                              RAWVIDEO_MUXER RAWVIDEO_DEMUXER FILE_PROTOCOL) += fate-file-pool-rawvideo fate-file-pool-rawvideo-mmap
+fate-file-pool-rawvideo fate-file-pool-rawvideo-mmap: tests/data/file_pool.yuv
+fate-file-pool-rawvideo: CMD = md5 -f rawvideo -pix_fmt yuv420p -s 320x240 -i $(TARGET_PATH)/tests/data/file_pool.yuv -c copy -f rawvideo
+fate-file-pool-rawvideo-mmap: CMD = md5 -mmap 1 -f rawvideo -pix_fmt yuv420p -s 320x240 -i $(TARGET_PATH)/tests/data/file_pool.yuv -c copy -f rawvideo
+fate-file-pool-rawvideo-mmap: REF = $(SRC_PATH)/tests/ref/fate/file-pool-rawvideo
+
+FATE_FFMPEG += $(FATE_FILE_POOL-yes)
+
+# Packets read ahead by the demuxing thread must match those read on demand.
+FATE_PREFETCH-$(call DEMMUX, WAV, FRAMECRC, PIPE_PROTOCOL) += fate-prefetch-wav fate-prefetch-wav-sync
+fate-prefetch-wav fate-prefetch-wav-sync: tests/data/asynth-44100-2.wav
+fate-prefetch-wav: CMD = framecrc -prefetch_size 4096 -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -c copy
+fate-prefetch-wav-sync: CMD = framecrc -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -c copy
+fate-prefetch-wav-sync: REF = $(SRC_PATH)/tests/ref/fate/prefetch-wav
+
+FATE_PREFETCH-$(call ALLYES, TESTSRC2_FILTER LAVFI_INDEV RAWVIDEO_ENCODER RAWVIDEO_DECODER \
+                             RAWVIDEO_MUXER RAWVIDEO_DEMUXER FRAMECRC_MUXER \
+                             FILE_PROTOCOL PIPE_PROTOCOL) += fate-prefetch-rawvideo
+fate-prefetch-rawvideo: tests/data/file_mmap.yuv
+fate-prefetch-rawvideo: CMD = framecrc -prefetch_size 1 -f rawvideo -pix_fmt yuv420p -s 64x48 -i $(TARGET_PATH)/tests/data/file_mmap.yuv
+fate-prefetch-rawvideo: REF = $(SRC_PATH)/tests/ref/fate/file-mmap-rawvideo
+
+FATE_FFMPEG += $(FATE_PREFETCH-yes)
@@ -29,6 +29,14 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_headerprobe
+fate-ffprobe_headerprobe: $(FFPROBE_TEST_FILE)
+fate-ffprobe_headerprobe: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -fflags +headerprobe -show_streams -bitexact $(TARGET_PATH)/$(FFPROBE_TEST_FILE) -of compact
+
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_frames_at
+fate-ffprobe_frames_at: $(FFPROBE_TEST_FILE)
+fate-ffprobe_frames_at: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -frames_at 0.1,0,0.05 -show_frames -show_entries frame=stream_index,pts,pkt_size -bitexact $(TARGET_PATH)/$(FFPROBE_TEST_FILE) -of compact
+
 FATE_FFPROBE_SCHEMA-$(CONFIG_AVDEVICE) += fate-ffprobe_xsd
 fate-ffprobe_xsd: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xsd: CMD = run $(FFPROBE_COMMAND) -noprivate -of xml=q=1:x=1 | \
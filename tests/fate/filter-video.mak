@@ -20,6 +20,9 @@ fate-filter-bwdif10: CMD = framecrc -ec 0 -flags bitexact -idct simple -i $(TARG
 
 FATE_FILTER_SAMPLES-yes += $(FATE_BWDIF-yes)
 
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 BWDIF) += $(addprefix fate-filter-bwdif-testsrc2-, yuv420p yuv422p10le)
+fate-filter-bwdif-testsrc2-%: CMD = framecrc -lavfi testsrc2=r=7:d=2,bwdif=send_field -pix_fmt $(word 5, $(subst -, ,$(@)))
+
 FATE_YADIF-$(call FILTERDEMDEC, YADIF, MPEGTS, MPEG2VIDEO) += fate-filter-yadif-mode0 fate-filter-yadif-mode1
 fate-filter-yadif-mode0: CMD = framecrc -ec 0 -flags bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg2/mpeg2_field_encoding.ts -frames:v 30 -vf yadif=0
 fate-filter-yadif-mode1: CMD = framecrc -ec 0 -flags bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg2/mpeg2_field_encoding.ts -frames:v 59 -vf yadif=1
@@ -30,6 +33,9 @@ fate-filter-yadif16: CMD = framecrc -ec 0 -flags bitexact -idct simple -i $(TARG
 
 FATE_FILTER_SAMPLES-yes += $(FATE_YADIF-yes)
 
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 YADIF) += $(addprefix fate-filter-yadif-testsrc2-, yuv420p yuv422p10le)
+fate-filter-yadif-testsrc2-%: CMD = framecrc -lavfi testsrc2=r=7:d=2,yadif=send_field -pix_fmt $(word 5, $(subst -, ,$(@)))
+
 FATE_W3FDIF += fate-filter-w3fdif-simple
 fate-filter-w3fdif-simple: CMD = framecrc -flags bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg2/mpeg2_field_encoding.ts -frames:v 30 -vf w3fdif=0
 
@@ -424,6 +430,25 @@ FATE_FILTER_VSYNTH-$(call ALLYES, TESTSRC_FILTER SCALE2REF_FILTER NULLSINK_FILTE
 fate-filter-scale2ref_keep_aspect: tests/data/filtergraphs/scale2ref_keep_aspect
 fate-filter-scale2ref_keep_aspect: CMD = framemd5 -frames:v 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale2ref_keep_aspect -map "[main]"
 
+FATE_FILTER_VSYNTH-$(call ALLYES, TESTSRC_FILTER SCALE_MULTI_FILTER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-filter-scale_multi
+fate-filter-scale_multi: tests/data/filtergraphs/scale_multi
+fate-filter-scale_multi: CMD = framemd5 -frames:v 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale_multi -map "[a]" -map "[b]" -map "[c]" -map "[d]"
+
+FATE_FILTER_VSYNTH-$(call ALLYES, TESTSRC2_FILTER SCALE_FILTER SETPARAMS_FILTER SCALE_MULTI_FILTER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-filter-scale_multi-reinit
+fate-filter-scale_multi-reinit: tests/data/filtergraphs/scale_multi-reinit
+fate-filter-scale_multi-reinit: CMD = framemd5 -frames:v 6 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale_multi-reinit -map "[a]" -map "[b]" -map "[c]"
+
+FATE_FILTER_FFPROBE-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER SCALE_FILTER SETPARAMS_FILTER SCALE_MULTI_FILTER) += fate-filter-scale_multi-props
+fate-filter-scale_multi-props: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -of compact=p=0 -bitexact -show_entries frame=stream_index,width,height,color_range,color_space,color_primaries,color_transfer -f lavfi "sws_flags=bicubic+accurate_rnd+bitexact;testsrc2=s=64x48:r=5:d=1,scale=w=64-16*floor(n/3):h=48-12*floor(n/3):eval=frame,setparams=range=pc:color_primaries=bt709:color_trc=bt709:colorspace=bt709,scale_multi=sizes=32x24|16x12:format=rgb24:flags=bicubic+accurate_rnd+bitexact[out0][out1]"
+
+FATE_FILTER_VSYNTH-$(call ALLYES, TESTSRC_FILTER TESTSRC2_FILTER COLOR_FILTER FORMAT_FILTER MOSAIC_FILTER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-filter-mosaic
+fate-filter-mosaic: tests/data/filtergraphs/mosaic
+fate-filter-mosaic: CMD = framemd5 -frames:v 10 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/mosaic -map "[out]"
+
+FATE_FILTER_VSYNTH-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER OVERLAY_FILTER FRAMEMD5_MUXER FILE_PROTOCOL PIPE_PROTOCOL) += fate-filter-overlay-lookahead
+fate-filter-overlay-lookahead: tests/data/filtergraphs/overlay_lookahead
+fate-filter-overlay-lookahead: CMD = framemd5 -frames:v 10 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_lookahead -map "[out]"
+
 FATE_FILTER_VSYNTH-$(call FILTERDEMDEC, SCALE, RAWVIDEO, RAWVIDEO) += fate-filter-scalechroma
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_v_chr_pos=33:out_h_chr_pos=151
@@ -732,7 +757,58 @@ FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER AVGBLUR_FILTER        \
                            METADATA_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER \
                            PIPE_PROTOCOL) += $(FATE_FILTER_REFCMP_METADATA-yes)
 
+FATE_FILTER-$(call ALLYES, NULLSRC_FILTER SPLIT_FILTER NULL_FILTER) += fate-filter-graphsched
+fate-filter-graphsched: libavfilter/tests/graphsched$(EXESUF)
+fate-filter-graphsched: CMD = run libavfilter/tests/graphsched$(EXESUF)
+
+# The frames output by loop are not writable: the filters process them into
+# new frames, and in place the ones written by copy. Neutral settings pass
+# the frames through untouched.
+INPLACE_SRC = testsrc2=s=64x48:r=5:d=0.6,format=$(1),loop=loop=1:size=3
+
+define FATE_FILTER_INPLACE
+FATE_FILTER_INPLACE-$(call ALLYES, $(3)_FILTER) += fate-filter-inplace-$(1) fate-filter-inplace-$(1)-copy
+fate-filter-inplace-$(1): CMD = framecrc -lavfi $(call INPLACE_SRC,$(2)),copy,$(4)
+fate-filter-inplace-$(1)-copy: CMD = framecrc -lavfi $(call INPLACE_SRC,$(2)),$(4)
+fate-filter-inplace-$(1)-copy: REF = $(SRC_PATH)/tests/ref/fate/filter-inplace-$(1)
+endef
+
+$(eval $(call FATE_FILTER_INPLACE,eq,yuv420p,EQ,eq=contrast=1.5:brightness=0.1:saturation=1.5:gamma=1.2))
+$(eval $(call FATE_FILTER_INPLACE,hue,yuv420p,HUE,hue=h=90:s=1.5))
+$(eval $(call FATE_FILTER_INPLACE,lutyuv,yuv420p,LUTYUV,lutyuv=y=negval:u=val/2))
+$(eval $(call FATE_FILTER_INPLACE,lutrgb,rgb24,LUTRGB,lutrgb=r=negval:b=val/2))
+$(eval $(call FATE_FILTER_INPLACE,colorbalance,rgb24,COLORBALANCE,colorbalance=rs=0.3:bm=-0.2))
+$(eval $(call FATE_FILTER_INPLACE,curves,rgb24,CURVES,curves=preset=vintage))
+
+FATE_FILTER_INPLACE-$(call ALLYES, EQ_FILTER HUE_FILTER LUTYUV_FILTER) += fate-filter-inplace-passthrough-yuv
+fate-filter-inplace-passthrough-yuv: CMD = framecrc -lavfi $(call INPLACE_SRC,yuv420p),eq,hue,lutyuv
+fate-filter-inplace-passthrough-yuv: REF = $(SRC_PATH)/tests/ref/fate/filter-inplace-source-yuv
+
+FATE_FILTER_INPLACE-$(call ALLYES, LUTRGB_FILTER COLORBALANCE_FILTER CURVES_FILTER) += fate-filter-inplace-passthrough-rgb
+fate-filter-inplace-passthrough-rgb: CMD = framecrc -lavfi $(call INPLACE_SRC,rgb24),lutrgb,colorbalance,curves
+fate-filter-inplace-passthrough-rgb: REF = $(SRC_PATH)/tests/ref/fate/filter-inplace-source-rgb
+
+FATE_FILTER_INPLACE-yes += fate-filter-inplace-source-yuv fate-filter-inplace-source-rgb
+fate-filter-inplace-source-yuv: CMD = framecrc -lavfi $(call INPLACE_SRC,yuv420p)
+fate-filter-inplace-source-rgb: CMD = framecrc -lavfi $(call INPLACE_SRC,rgb24)
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER LOOP_FILTER COPY_FILTER) += $(FATE_FILTER_INPLACE-yes)
+fate-filter-inplace: $(FATE_FILTER_INPLACE-yes)
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER HFLIP_FILTER SCALE_FILTER) += fate-filter-framepool
+fate-filter-framepool: libavfilter/tests/framepool$(EXESUF)
+fate-filter-framepool: CMD = run libavfilter/tests/framepool$(EXESUF)
+
+FATE_FILTER-$(CONFIG_OVERLAY_FILTER) += fate-filter-framesync-timeout
+fate-filter-framesync-timeout: libavfilter/tests/framesync$(EXESUF)
+fate-filter-framesync-timeout: CMD = run libavfilter/tests/framesync$(EXESUF)
+
+FATE_FILTER-$(CONFIG_MOSAIC_FILTER) += fate-filter-mosaic-latest
+fate-filter-mosaic-latest: libavfilter/tests/mosaic$(EXESUF)
+fate-filter-mosaic-latest: CMD = run libavfilter/tests/mosaic$(EXESUF)
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
+FATE_FFPROBE += $(FATE_FILTER_FFPROBE-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
 
@@ -97,6 +97,30 @@ FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILT
 fate-hls-fmp4: tests/data/hls_fmp4.m3u8
 fate-hls-fmp4: CMD = framecrc -auto_conversion_filters -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_fmp4.m3u8 -vf setpts=N*23
 
+tests/data/hls_fmp4_part.m3u8: TAG = GEN
+tests/data/hls_fmp4_part.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+	-f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=5" -map 0 -codec:a mp2fixed \
+	-hls_segment_type fmp4 -hls_fmp4_init_filename hls_fmp4_part_init.mp4 -hls_list_size 0 \
+	-hls_time 2 -hls_part_time 0.5 -hls_segment_filename "$(TARGET_PATH)/tests/data/hls_fmp4_part_%d.m4s" \
+	$(TARGET_PATH)/tests/data/hls_fmp4_part.m3u8 2>/dev/null
+
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MOV_MUXER MOV_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-fmp4-part
+fate-hls-fmp4-part: tests/data/hls_fmp4_part.m3u8
+fate-hls-fmp4-part: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_fmp4_part.m3u8 -c:a copy
+
+tests/data/hls_fmp4_part_live.m3u8: TAG = GEN
+tests/data/hls_fmp4_part_live.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+	-f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=5" -map 0 -codec:a mp2fixed -flags +bitexact -fflags +bitexact \
+	-hls_segment_type fmp4 -hls_fmp4_init_filename hls_fmp4_part_live_init.mp4 -hls_list_size 0 -hls_flags omit_endlist \
+	-hls_time 2 -hls_part_time 0.5 -hls_segment_filename "$(TARGET_PATH)/tests/data/hls_fmp4_part_live_%d.m4s" \
+	$(TARGET_PATH)/tests/data/hls_fmp4_part_live.m3u8 2>/dev/null
+
+FATE_HLSENC-$(call ALLYES, HLS_MUXER MOV_MUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-fmp4-part-playlist
+fate-hls-fmp4-part-playlist: tests/data/hls_fmp4_part_live.m3u8
+fate-hls-fmp4-part-playlist: CMD = cat $(TARGET_PATH)/tests/data/hls_fmp4_part_live.m3u8
+
 tests/data/hls_fmp4_ac3.m3u8: TAG = GEN
 tests/data/hls_fmp4_ac3.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
@@ -198,6 +198,27 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# Matroska without Cues: the muxer cannot write them to a pipe
+tests/data/mkv-nocues.mkv: TAG = GEN
+tests/data/mkv-nocues.mkv: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+	-f lavfi -i "testsrc2=s=160x120:r=25:d=10" -c:v mpeg4 -g 25 -qscale:v 10 \
+	-cluster_time_limit 400 -flags +bitexact -fflags +bitexact -f matroska pipe: \
+	> $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_SEEK_MKV_NOCUES-$(call ALLYES, MATROSKA_MUXER MATROSKA_DEMUXER MPEG4_ENCODER TESTSRC2_FILTER LAVFI_INDEV PIPE_PROTOCOL) += fate-seek-mkv-nocues fate-seek-mkv-nocues-noindex
+fate-seek-mkv-nocues: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/mkv-nocues.mkv -duration 10 -frames 2
+fate-seek-mkv-nocues-noindex: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/mkv-nocues.mkv -duration 10 -frames 2 -cluster_index 0
+$(FATE_SEEK_MKV_NOCUES-yes): tests/data/mkv-nocues.mkv libavformat/tests/seek$(EXESUF)
+FATE_FFMPEG += $(FATE_SEEK_MKV_NOCUES-yes)
+
+# seeking stops the demuxing thread, which must not change the result
+FATE_SEEK_PREFETCH := $(if $(filter fate-seek-lavf-wav, $(FATE_SEEK_LAVF_AUDIO)), fate-seek-lavf-wav-prefetch)
+fate-seek-lavf-wav-prefetch: fate-lavf-wav libavformat/tests/seek$(EXESUF)
+fate-seek-lavf-wav-prefetch: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.wav -prefetch_size 1
+fate-seek-lavf-wav-prefetch: REF = $(SRC_PATH)/tests/ref/seek/lavf-wav
+FATE_AVCONV += $(FATE_SEEK_PREFETCH)
+
 
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
@@ -207,4 +228,4 @@ fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
 FATE_AVCONV += $(FATE_SEEK)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_MKV_NOCUES-yes) $(FATE_SEEK_PREFETCH)
@@ -0,0 +1,10 @@
+# A writer and a reader process connected through the shm protocol. When
+# the reader stops early, the writer blocked on the full ring must fail.
+FATE_SHM-$(call ALLYES, SHM_PROTOCOL PIPE_PROTOCOL TESTSRC2_FILTER LAVFI_INDEV \
+                        RAWVIDEO_ENCODER NUT_MUXER NUT_DEMUXER FRAMECRC_MUXER) \
+                        += fate-shm-roundtrip fate-shm-reader-close
+fate-shm-roundtrip: CMD = shm_protocol
+fate-shm-reader-close: CMD = shm_protocol -frames:v 5
+
+FATE_FFMPEG += $(FATE_SHM-yes)
+fate-shm: $(FATE_SHM-yes)
@@ -0,0 +1,10 @@
+# Writing the slaves from a thread pool must produce the same files as
+# writing them from the muxing thread.
+FATE_TEE_MUXER-$(call ALLYES, TEE_MUXER NUT_MUXER FRAMECRC_MUXER WAV_MUXER   \
+                              TESTSRC2_FILTER SINE_FILTER LAVFI_INDEV     \
+                              MPEG4_ENCODER PCM_S16LE_ENCODER FILE_PROTOCOL) \
+                              += fate-tee-muxer-write-threads
+fate-tee-muxer-write-threads: CMD = tee_write_threads 3
+
+FATE_FFMPEG += $(FATE_TEE_MUXER-yes)
+fate-tee-muxer: $(FATE_TEE_MUXER-yes)